@@ -0,0 +1,408 @@
+#include <pel/pe_brute_force.h>
+#include <pel/pe_progressive_bisection.h>
+#include <pel/database/database_creator.h>
+#include <pel/database/database_io.h>
+#include <pel/database/database.h>
+#include <pel/database/database_generator.h>
+#include <pcl/console/parse.h>
+#include <pcl/common/time.h>
+#include <pcl/io/pcd_io.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+using namespace pcl::console;
+using pel::Pt;
+using pel::PtC;
+
+unsigned int seed(42), reps(10), objects(3), views(24), points(1500), threads(1);
+float tolerance(0.1f);
+std::string json_out, baseline_in;
+
+void
+show_help(char* prog_name)
+{
+  //trim and split program name string
+  std::string pn = prog_name;
+  boost::trim(pn);
+  std::vector<std::string> vst;
+  boost::split (vst, pn, boost::is_any_of("/\\.."), boost::token_compress_on);
+  pn = vst.at( vst.size() -1);
+  print_highlight ("%s runs reproducible benchmarks of PEL hot paths over a synthetic Database, reporting latency percentiles and throughput.\n", pn.c_str());
+  print_highlight ("Usage:\t%s [Options]\n", pn.c_str());
+  print_highlight ("Options are:\n");
+  print_value ("\t-h, --help");
+  print_info (":\t\tShow this help screen and quit.\n");
+  print_value ("\t--seed <uint>");
+  print_info (":\t\tSeed of synthetic data generation. (Default 42)\n");
+  print_value ("\t--reps <uint>");
+  print_info (":\t\tMeasured repetitions of each benchmark, after one warm up run. (Default 10)\n");
+  print_value ("\t--objects <uint>");
+  print_info (":\tNumber of synthetic objects in the Database. (Default 3)\n");
+  print_value ("\t--views <uint>");
+  print_info (":\t\tNumber of poses of each object. (Default 24)\n");
+  print_value ("\t--points <uint>");
+  print_info (":\tNumber of points of each pose. (Default 1500)\n");
+  print_value ("\t--threads <uint>");
+  print_info (":\tThreads used by estimators, Database creation and loading, 0 means automatic. (Default 1)\n");
+  print_value ("\t--json <file>");
+  print_info (":\t\tWrite results as JSON into <file>, it can be used as a baseline later.\n");
+  print_value ("\t--baseline <file>");
+  print_info (":\tCompare median latencies against a JSON baseline, exit with failure on regressions.\n");
+  print_value ("\t--tolerance <float>");
+  print_info (":\tAllowed relative slowdown over the baseline. (Default 0.1)\n");
+}
+
+void
+parse_command_line(int argc, char* argv[])
+{
+  if (find_switch (argc, argv, "-h") || find_switch (argc, argv, "--help"))
+  {
+    show_help(argv[0]);
+    exit(0);
+  }
+  parse_argument (argc, argv, "--seed", seed);
+  parse_argument (argc, argv, "--reps", reps);
+  parse_argument (argc, argv, "--objects", objects);
+  parse_argument (argc, argv, "--views", views);
+  parse_argument (argc, argv, "--points", points);
+  parse_argument (argc, argv, "--threads", threads);
+  parse_argument (argc, argv, "--json", json_out);
+  parse_argument (argc, argv, "--baseline", baseline_in);
+  parse_argument (argc, argv, "--tolerance", tolerance);
+  if (reps == 0)
+  {
+    print_warn("Invalid value for --reps option, resetting to default!\n");
+    reps = 10;
+  }
+  if (objects == 0 || views == 0 || points == 0)
+  {
+    print_warn("Invalid synthetic Database size, resetting to default!\n");
+    objects = 3;
+    views = 24;
+    points = 1500;
+  }
+  if (tolerance < 0)
+  {
+    print_warn("Invalid negative value for --tolerance option, resetting to default!\n");
+    tolerance = 0.1f;
+  }
+}
+
+////////////////////////////////////////////////////
+/////////////////  Harness  ////////////////////////
+////////////////////////////////////////////////////
+//Estimator exposing the protected stages we want to measure on their own
+class BenchEstimator : public pel::interface::PEBruteForce
+{
+  public:
+    using pel::PoseEstimationBase::initTarget;
+    using pel::PoseEstimationBase::generateLists;
+    using pel::Database::computeDistFromClusters;
+    pcl::PointCloud<pcl::VFHSignature308>::Ptr
+    getTargetCVFH() const
+    {
+      return (target_cvfh.makeShared());
+    }
+    pcl::PointCloud<pcl::VFHSignature308>::Ptr
+    getTargetOURCVFH() const
+    {
+      return (target_ourcvfh.makeShared());
+    }
+};
+
+struct Result
+{
+  std::string name;
+  //how many items (histograms, poses, Targets) each repetition processes
+  double items;
+  //latency of each repetition in ms
+  std::vector<double> ms;
+};
+
+//Nearest rank percentile of sorted samples
+double
+percentile(const std::vector<double>& sorted, const double p)
+{
+  const size_t rank = std::ceil(p/100 * sorted.size());
+  return (sorted.at(std::max<size_t>(rank, 1) -1));
+}
+
+//Run one warm up plus reps repetitions of body, which returns the time (ms) it measured
+Result
+run(const std::string& name, const double items, std::function<double()> body)
+{
+  Result r;
+  r.name = name;
+  r.items = items;
+  //libc rand() is used by some PCL features (ESF), reseed it so every benchmark sees the same sequence
+  std::srand(seed);
+  body();
+  for (unsigned int i=0; i<reps; ++i)
+    r.ms.push_back(body());
+  std::sort(r.ms.begin(), r.ms.end());
+  double mean (0);
+  for (const double x: r.ms)
+    mean += x;
+  mean /= r.ms.size();
+  std::printf("%-34s p50 %10.4f ms  p90 %10.4f ms  p99 %10.4f ms  %12.1f items/s\n", name.c_str(),
+      percentile(r.ms, 50), percentile(r.ms, 90), percentile(r.ms, 99), mean > 0 ? 1000*items/mean : 0.0);
+  std::fflush(stdout);
+  return (r);
+}
+
+std::string
+toJSON(const std::vector<Result>& results)
+{
+  std::string js;
+  char buf[512];
+  std::snprintf(buf, sizeof(buf), "{\"seed\":%u,\"reps\":%u,\"objects\":%u,\"views\":%u,\"points\":%u,\"threads\":%u,"
+      "\"kernel\":\"%s\",\"results\":[", seed, reps, objects, views, points, threads, pel::getMinMaxDistanceKernel());
+  js += buf;
+  for (size_t i=0; i<results.size(); ++i)
+  {
+    const Result& r = results[i];
+    double mean (0);
+    for (const double x: r.ms)
+      mean += x;
+    mean /= r.ms.size();
+    std::snprintf(buf, sizeof(buf), "%s{\"name\":\"%s\",\"items\":%g,\"min_ms\":%g,\"p50_ms\":%g,\"p90_ms\":%g,"
+        "\"p99_ms\":%g,\"max_ms\":%g,\"mean_ms\":%g,\"throughput\":%g}", i ? "," : "", r.name.c_str(), r.items,
+        r.ms.front(), percentile(r.ms, 50), percentile(r.ms, 90), percentile(r.ms, 99), r.ms.back(), mean,
+        mean > 0 ? 1000*r.items/mean : 0.0);
+    js += buf;
+  }
+  js += "]}\n";
+  return (js);
+}
+
+//Compare medians with a baseline written by --json, returns the number of regressions
+int
+compareWithBaseline(const std::vector<Result>& results)
+{
+  boost::property_tree::ptree base;
+  try
+  {
+    boost::property_tree::read_json(baseline_in, base);
+  }
+  catch (const boost::property_tree::json_parser_error& e)
+  {
+    print_error("Cannot read baseline %s: %s\n", baseline_in.c_str(), e.what());
+    return (1);
+  }
+  boost::optional<boost::property_tree::ptree&> entries = base.get_child_optional("results");
+  if (!entries)
+  {
+    print_error("Baseline %s has no results, it must be written by --json\n", baseline_in.c_str());
+    return (1);
+  }
+  std::map<std::string, double> medians;
+  for (const auto& b: *entries)
+  {
+    boost::optional<std::string> name = b.second.get_optional<std::string>("name");
+    boost::optional<double> median = b.second.get_optional<double>("p50_ms");
+    if (name && median)
+      medians[*name] = *median;
+  }
+  if (base.get<unsigned int>("seed", seed) != seed || base.get<unsigned int>("objects", objects) != objects ||
+      base.get<unsigned int>("views", views) != views || base.get<unsigned int>("points", points) != points ||
+      base.get<unsigned int>("threads", threads) != threads)
+    print_warn("Baseline was recorded with different options, comparison may not be meaningful\n");
+  int regressions (0);
+  std::printf("\nComparison with baseline %s (tolerance %g%%):\n", baseline_in.c_str(), tolerance*100);
+  for (const auto& r: results)
+  {
+    auto it = medians.find(r.name);
+    if (it == medians.end() || it->second <= 0)
+    {
+      std::printf("%-34s not in baseline\n", r.name.c_str());
+      continue;
+    }
+    const double ratio = percentile(r.ms, 50) / it->second;
+    const bool slower = ratio > 1 + tolerance;
+    regressions += slower;
+    std::printf("%-34s %+7.1f%% %s\n", r.name.c_str(), (ratio -1)*100, slower ? "REGRESSION" : "ok");
+  }
+  return (regressions);
+}
+
+////////////////////////////////////////////////////
+//////////////////  Main  //////////////////////////
+////////////////////////////////////////////////////
+int
+main (int argc, char *argv[])
+{
+  parse_command_line (argc, argv);
+  setVerbosityLevel(L_WARN);
+  boost::filesystem::path work = boost::filesystem::temp_directory_path() /
+    boost::filesystem::unique_path("pel_benchmarks_%%%%-%%%%-%%%%");
+  boost::filesystem::path poses_dir = work / "poses", db_dir = work / "db";
+  //partial views of parametric shapes, DatabaseCreator turns them into a Database
+  pel::DatabaseGenerator generator;
+  generator.setSeed(seed);
+  generator.setNumberOfObjects(objects);
+  generator.setViewsPerObject(views);
+  generator.setPointsPerView(points);
+  if (!generator.writePoses(poses_dir))
+  {
+    print_error("Cannot write synthetic poses, aborting...\n");
+    boost::filesystem::remove_all(work);
+    return (1);
+  }
+  //Targets are seen from viewpoints close to the ones of poses, never identical
+  std::vector<PtC::Ptr> targets;
+  for (unsigned int o=0; o<objects; ++o)
+    for (unsigned int v=0; v<views; v+=std::max(1u, views/2))
+      targets.push_back(generator.generateTarget(o, v));
+  const unsigned int nr_poses = objects * views;
+  std::printf("Synthetic Database of %u poses (%u objects, %u views, %u points), seed %u, %u thread(s)\n\n",
+      nr_poses, objects, views, points, seed, threads);
+  std::vector<Result> results;
+
+  //getMinMaxDistance over random histograms
+  {
+    std::mt19937 rng (seed);
+    std::uniform_real_distribution<float> u (0, 100);
+    const int pairs (10000);
+    std::vector<float> hists (2*pairs*308);
+    for (auto& x: hists)
+      x = u(rng);
+    volatile float sink (0);
+    results.push_back(run("getMinMaxDistance", pairs, [&]()
+          {
+            pcl::StopWatch t;
+            float acc (0);
+            for (int i=0; i<pairs; ++i)
+              acc += pel::getMinMaxDistance(&hists[2*i*308], &hists[(2*i+1)*308]);
+            sink = acc;
+            return (t.getTime());
+          }));
+  }
+
+  //Database creation, saving and loading
+  pel::Database db;
+  {
+    pel::DatabaseCreator creator;
+    creator.setParam("verbosity", 0);
+    creator.setNumberOfThreads(threads);
+    results.push_back(run("DatabaseCreator::create", nr_poses, [&]()
+          {
+            pcl::StopWatch t;
+            db = creator.create(poses_dir);
+            return (t.getTime());
+          }));
+    pel::DatabaseWriter writer;
+    if (db.isEmpty() || !writer.save(db_dir, db, true))
+    {
+      print_error("Cannot create the synthetic Database, aborting...\n");
+      boost::filesystem::remove_all(work);
+      return (1);
+    }
+    pel::DatabaseReader reader;
+    reader.setNumberOfThreads(threads);
+    results.push_back(run("DatabaseReader::load", nr_poses, [&]()
+          {
+            pel::Database loaded;
+            pcl::StopWatch t;
+            reader.load(db_dir, loaded);
+            return (t.getTime());
+          }));
+  }
+
+  //Target initialization and retrieval
+  {
+    BenchEstimator pe;
+    pe.setParam("verbosity", 0);
+    pe.setParam("lists_size", std::min(20u, nr_poses));
+    pe.setDatabase(db);
+    size_t next (0);
+    results.push_back(run("initTarget", 1, [&]()
+          {
+            //setTarget initializes too, measure a second initialization of the same cloud
+            pe.setTarget(targets[next++ % targets.size()], "target");
+            pcl::StopWatch t;
+            pe.initTarget();
+            return (t.getTime());
+          }));
+    results.push_back(run("generateLists", 1, [&]()
+          {
+            pe.setTarget(targets[next++ % targets.size()], "target");
+            pcl::StopWatch t;
+            pe.generateLists();
+            return (t.getTime());
+          }));
+    std::vector<std::pair<float, int> > dists;
+    results.push_back(run("computeDistFromClusters CVFH", nr_poses, [&]()
+          {
+            pe.setTarget(targets[next++ % targets.size()], "target");
+            pcl::PointCloud<pcl::VFHSignature308>::Ptr cvfh = pe.getTargetCVFH();
+            pcl::StopWatch t;
+            pe.computeDistFromClusters(cvfh, pel::ListType::cvfh, dists);
+            return (t.getTime());
+          }));
+    results.push_back(run("computeDistFromClusters OURCVFH", nr_poses, [&]()
+          {
+            pe.setTarget(targets[next++ % targets.size()], "target");
+            pcl::PointCloud<pcl::VFHSignature308>::Ptr ourcvfh = pe.getTargetOURCVFH();
+            pcl::StopWatch t;
+            pe.computeDistFromClusters(ourcvfh, pel::ListType::ourcvfh, dists);
+            return (t.getTime());
+          }));
+  }
+
+  //Complete estimations, Targets are cycled so every repetition does the same work
+  {
+    pel::interface::PEBruteForce bf;
+    bf.setParam("verbosity", 0);
+    bf.setParam("lists_size", std::min(20u, nr_poses));
+    bf.setNumberOfThreads(threads);
+    bf.setDatabase(db);
+    size_t next (0);
+    results.push_back(run("PEBruteForce::estimate", 1, [&]()
+          {
+            bf.setTarget(targets[next++ % targets.size()], "target");
+            pel::Candidate est;
+            pcl::StopWatch t;
+            bf.estimate(est);
+            return (t.getTime());
+          }));
+    pel::interface::PEProgressiveBisection pb;
+    pb.setParam("verbosity", 0);
+    pb.setParam("lists_size", std::min(20u, nr_poses));
+    pb.setNumberOfThreads(threads);
+    pb.setDatabase(db);
+    next = 0;
+    results.push_back(run("PEProgressiveBisection::estimate", 1, [&]()
+          {
+            pb.setTarget(targets[next++ % targets.size()], "target");
+            pel::Candidate est;
+            pcl::StopWatch t;
+            pb.estimate(est);
+            return (t.getTime());
+          }));
+  }
+  boost::filesystem::remove_all(work);
+
+  if (!json_out.empty())
+  {
+    std::ofstream file (json_out.c_str());
+    file << toJSON(results);
+    if (!file)
+      print_error("Cannot write results into %s\n", json_out.c_str());
+  }
+  if (!baseline_in.empty())
+    return (compareWithBaseline(results) > 0 ? 1 : 0);
+  return (0);
+}
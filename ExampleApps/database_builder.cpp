@@ -10,7 +10,8 @@
 
 using namespace pcl::console;
 
-bool load(false), overwrite(false);
+bool load(false), overwrite(false), single(false);
+unsigned int threads(1);
 boost::filesystem::path in_path, out_path;
 boost::filesystem::path p_path;
 
@@ -30,8 +31,12 @@ show_help(char* prog_name)
   print_info (":\t\tShow this help screen and quit.\n");
   print_value ("\t--load <path>");
   print_info (":\t\tLoad a set of configuration parameters from a yaml file in <path>\n");
+  print_value ("\t--threads <uint>");
+  print_info (":\tNumber of threads to use, 0 means one per core. (Default 1)\n");
   print_value ("\t-w");
   print_info (":\t\t\tOverwrite <OutputDir> even if it already exists.\n");
+  print_value ("\t-s");
+  print_info (":\t\t\tSave Database as a single memory mappable file named <OutputDir>, instead of a directory.\n");
 }
 
 void
@@ -44,6 +49,9 @@ parse_command_line(int argc, char* argv[])
   }
   if (find_switch (argc, argv, "-w"))
     overwrite = true;
+  if (find_switch (argc, argv, "-s"))
+    single = true;
+  parse_argument (argc, argv, "--threads", threads);
   std::string param_path;
   parse_argument (argc, argv, "--load", param_path);
   p_path = param_path;
@@ -90,6 +98,7 @@ main (int argc, char *argv[])
   }
   //be verbose
   creator.setParam("verbosity", 2);
+  creator.setNumberOfThreads(threads);
   //inform user what parameters we are going to use
   creator.printAllParams();
 
@@ -103,7 +112,10 @@ main (int argc, char *argv[])
     //Writer object
     pel::DatabaseWriter writer;
     //write it!
-    writer.save(out_path, db, overwrite);
+    if (single)
+      writer.saveSingleFile(out_path, db, overwrite);
+    else
+      writer.save(out_path, db, overwrite);
   }
   else
   {
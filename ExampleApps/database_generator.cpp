@@ -0,0 +1,171 @@
+#include <pel/database/database_generator.h>
+#include <pel/database/database_creator.h>
+#include <pel/database/database_io.h>
+#include <pel/database/database.h>
+#include <pcl/console/parse.h>
+#include <string>
+#include <vector>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/filesystem/path.hpp>
+
+using namespace pcl::console;
+
+bool load(false), overwrite(false), single(false), descriptors_only(false), poses_only(false);
+unsigned int seed(42), objects(10), views(24), points(1500), poses(0), threads(0);
+boost::filesystem::path out_path;
+boost::filesystem::path p_path;
+
+void
+show_help(char* prog_name)
+{
+  //trim and split program name string
+  std::string pn = prog_name;
+  boost::trim(pn);
+  std::vector<std::string> vst;
+  boost::split (vst, pn, boost::is_any_of("/\\.."), boost::token_compress_on);
+  pn = vst.at( vst.size() -1);
+  print_highlight ("%s generates a synthetic PEL Database of parametric shapes seen from sampled viewpoints, for load testing.\n", pn.c_str());
+  print_highlight ("Usage:\t%s [OutputDir] [Options]\n", pn.c_str());
+  print_highlight ("Options are:\n");
+  print_value ("\t-h, --help");
+  print_info (":\t\tShow this help screen and quit.\n");
+  print_value ("\t--objects <uint>");
+  print_info (":\tNumber of objects to generate. (Default 10)\n");
+  print_value ("\t--views <uint>");
+  print_info (":\t\tNumber of views of each object. (Default 24)\n");
+  print_value ("\t--poses <uint>");
+  print_info (":\t\tTotal number of poses, overrides --objects with enough objects of --views views each.\n");
+  print_value ("\t--points <uint>");
+  print_info (":\tNumber of points of each view. (Default 1500)\n");
+  print_value ("\t--seed <uint>");
+  print_info (":\t\tSeed of generation, the same seed always gives the same Database. (Default 42)\n");
+  print_value ("\t--threads <uint>");
+  print_info (":\tNumber of threads to use, 0 means one per core. (Default 0)\n");
+  print_value ("\t--descriptors-only");
+  print_info (":\tGenerate histograms directly, without clouds and feature estimation. Scales to millions of poses, for retrieval stress tests.\n");
+  print_value ("\t--poses-only");
+  print_info (":\t\tOnly write poses as pcd files into <OutputDir>, they can be fed to pel_db_creator later.\n");
+  print_value ("\t--load <path>");
+  print_info (":\t\tLoad a set of configuration parameters for Database creation from a yaml file in <path>\n");
+  print_value ("\t-w");
+  print_info (":\t\t\tOverwrite <OutputDir> even if it already exists.\n");
+  print_value ("\t-s");
+  print_info (":\t\t\tSave Database as a single memory mappable file named <OutputDir>, instead of a directory.\n");
+}
+
+void
+parse_command_line(int argc, char* argv[])
+{
+  if (find_switch (argc, argv, "-h") || find_switch (argc, argv, "--help"))
+  {
+    show_help(argv[0]);
+    exit(0);
+  }
+  if (find_switch (argc, argv, "-w"))
+    overwrite = true;
+  if (find_switch (argc, argv, "-s"))
+    single = true;
+  if (find_switch (argc, argv, "--descriptors-only"))
+    descriptors_only = true;
+  if (find_switch (argc, argv, "--poses-only"))
+    poses_only = true;
+  parse_argument (argc, argv, "--objects", objects);
+  parse_argument (argc, argv, "--views", views);
+  parse_argument (argc, argv, "--poses", poses);
+  parse_argument (argc, argv, "--points", points);
+  parse_argument (argc, argv, "--seed", seed);
+  parse_argument (argc, argv, "--threads", threads);
+  if (views == 0)
+  {
+    print_warn("Invalid value for --views option, resetting to default!\n");
+    views = 24;
+  }
+  if (poses > 0)
+    objects = (poses + views -1) / views;
+  if (objects == 0 || points == 0)
+  {
+    print_error("Nothing to generate, number of objects and points must be positive.\n");
+    exit(0);
+  }
+  if (descriptors_only && poses_only)
+  {
+    print_error("--descriptors-only and --poses-only cannot be used together.\n");
+    exit(0);
+  }
+  std::string param_path;
+  parse_argument (argc, argv, "--load", param_path);
+  p_path = param_path;
+  if (!param_path.empty())
+  {
+    if (!boost::filesystem::exists(p_path) || !boost::filesystem::is_regular_file(p_path))
+      print_warn("Invalid path for parameters loading! Ignoring...\n");
+    else
+      load = true;
+  }
+  out_path = argv[1];
+}
+
+////////////////////////////////////////////////////
+//////////////////  Main  //////////////////////////
+////////////////////////////////////////////////////
+int
+main (int argc, char *argv[])
+{
+  //take care of command line...
+  if (argc <2)
+  {
+    print_error("Need at least 1 parameter: [OutputDir].\n");
+    show_help(argv[0]);
+    return(0);
+  }
+  parse_command_line(argc, argv);
+
+  pel::DatabaseGenerator generator;
+  generator.setSeed(seed);
+  generator.setNumberOfObjects(objects);
+  generator.setViewsPerObject(views);
+  generator.setPointsPerView(points);
+  generator.setNumberOfThreads(threads);
+  print_info("Generating %zu poses: %u objects with %u views of %u points each, seed %u\n",
+      generator.getNumberOfPoses(), objects, views, points, seed);
+  if (poses_only)
+  {
+    if (boost::filesystem::exists(out_path) && !boost::filesystem::is_empty(out_path) && !overwrite)
+    {
+      print_error("%s is not empty, use -w to write into it anyway.\n", out_path.c_str());
+      return (0);
+    }
+    return (generator.writePoses(out_path) ? 1 : 0);
+  }
+  pel::Database db;
+  if (descriptors_only)
+    db = generator.createDescriptorsOnly();
+  else
+  {
+    pel::DatabaseCreator creator;
+    if (load)
+    {
+      //load provided parameters instead of default ones
+      creator.loadParamsFromFile(p_path);
+    }
+    creator.setNumberOfThreads(threads);
+    creator.printAllParams();
+    db = generator.create(creator);
+  }
+  if (!db.isEmpty())
+  {
+    pel::DatabaseWriter writer;
+    if (single)
+      writer.saveSingleFile(out_path, db, overwrite);
+    else
+      writer.save(out_path, db, overwrite);
+  }
+  else
+  {
+    print_error("Something went wrong with Database generation, not saving it...\n");
+    return (0);
+  }
+  //bye
+  return (1);
+}
@@ -0,0 +1,63 @@
+#include <pel/database/database_creator.h>
+#include <pel/database/database_generator.h>
+#include <pel/database/database.h>
+#include <pcl/console/print.h>
+#include <cstring>
+#include <string>
+
+using namespace pcl::console;
+
+//Tell if two histograms matrices hold the same bytes
+bool
+sameHistograms (const pel::histograms& a, const pel::histograms& b, const char* what)
+{
+  bool same (a.rows == b.rows && a.cols == b.cols);
+  for (size_t i=0; same && i<a.rows; ++i)
+    same = std::memcmp(a[i], b[i], a.cols*sizeof(float)) == 0;
+  if (!same)
+    print_error("%s histograms differ between serial and parallel creation\n", what);
+  return (same);
+}
+
+////////////////////////////////////////////////////
+//////////////////  Main  //////////////////////////
+////////////////////////////////////////////////////
+//Create the same synthetic Database with one and with four threads, every histogram must be identical
+int
+main ()
+{
+  pel::DatabaseGenerator generator;
+  generator.setSeed(7);
+  generator.setNumberOfObjects(3);
+  generator.setViewsPerObject(4);
+  generator.setPointsPerView(800);
+  pel::DatabaseCreator creator;
+  creator.setNumberOfThreads(1);
+  pel::Database serial = generator.create(creator);
+  creator.setNumberOfThreads(4);
+  pel::Database parallel = generator.create(creator);
+  if (serial.isEmpty() || parallel.isEmpty())
+  {
+    print_error("Database creation failed\n");
+    return (1);
+  }
+  bool same (true);
+  if (serial.getDatabaseNames() != parallel.getDatabaseNames())
+  {
+    print_error("Names differ between serial and parallel creation\n");
+    same = false;
+  }
+  if (serial.getDatabaseOffsetsCVFH() != parallel.getDatabaseOffsetsCVFH() ||
+      serial.getDatabaseOffsetsOURCVFH() != parallel.getDatabaseOffsetsOURCVFH())
+  {
+    print_error("Cluster offsets differ between serial and parallel creation\n");
+    same = false;
+  }
+  same = sameHistograms(*serial.getDatabaseVFH(), *parallel.getDatabaseVFH(), "VFH") && same;
+  same = sameHistograms(*serial.getDatabaseESF(), *parallel.getDatabaseESF(), "ESF") && same;
+  same = sameHistograms(*serial.getDatabaseCVFH(), *parallel.getDatabaseCVFH(), "CVFH") && same;
+  same = sameHistograms(*serial.getDatabaseOURCVFH(), *parallel.getDatabaseOURCVFH(), "OURCVFH") && same;
+  if (same)
+    print_info("Serial and parallel creation of %zu poses are identical\n", serial.getDatabaseNames().size());
+  return (same ? 0 : 1);
+}
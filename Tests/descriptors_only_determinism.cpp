@@ -0,0 +1,129 @@
+#include <pel/database/database_creator.h>
+#include <pel/database/database_generator.h>
+#include <pel/database/database.h>
+#include <pcl/console/print.h>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace pcl::console;
+
+//Tell if the first rows of two histograms matrices hold the same bytes
+bool
+sameRows (const pel::histograms& a, const pel::histograms& b, const size_t rows, const char* what, const char* how)
+{
+  bool same (a.rows >= rows && b.rows >= rows && a.cols == b.cols);
+  for (size_t i=0; same && i<rows; ++i)
+    same = std::memcmp(a[i], b[i], a.cols*sizeof(float)) == 0;
+  if (!same)
+    print_error("%s histograms differ %s\n", what, how);
+  return (same);
+}
+
+//Tell if offsets are a valid CSR index of rows clusters for n poses, and if the expanded cluster names agree
+//with them
+bool
+validOffsets (const std::vector<size_t>& offsets, const size_t rows, const std::vector<std::string>& names,
+    const std::vector<std::string>& cluster_names, const char* what)
+{
+  bool valid (offsets.size() == names.size()+1 && offsets.front() == 0 && offsets.back() == rows &&
+      cluster_names.size() == rows);
+  for (size_t i=0; valid && i<names.size(); ++i)
+  {
+    valid = offsets[i] <= offsets[i+1];
+    for (size_t c=offsets[i]; valid && c<offsets[i+1]; ++c)
+      valid = cluster_names[c] == names[i];
+  }
+  if (!valid)
+    print_error("%s offsets are not a valid index of clusters\n", what);
+  return (valid);
+}
+
+////////////////////////////////////////////////////
+//////////////////  Main  //////////////////////////
+////////////////////////////////////////////////////
+//createDescriptorsOnly must give the same histograms with any number of threads, and each pose must get the
+//same ones regardless of how many objects follow it. Names and offsets must be laid out like the ones of create()
+int
+main ()
+{
+  pel::DatabaseGenerator generator;
+  generator.setSeed(7);
+  generator.setNumberOfObjects(5);
+  generator.setViewsPerObject(4);
+  generator.setPointsPerView(400);
+  generator.setNumberOfThreads(1);
+  pel::Database serial = generator.createDescriptorsOnly();
+  generator.setNumberOfThreads(4);
+  pel::Database parallel = generator.createDescriptorsOnly();
+  generator.setNumberOfObjects(3);
+  pel::Database fewer = generator.createDescriptorsOnly();
+  pel::DatabaseCreator creator;
+  pel::Database complete = generator.create(creator);
+  if (serial.isEmpty() || parallel.isEmpty() || fewer.isEmpty() || complete.isEmpty())
+  {
+    print_error("Database creation failed\n");
+    return (1);
+  }
+  bool ok (true);
+  //threads
+  if (serial.getDatabaseNames() != parallel.getDatabaseNames() ||
+      serial.getDatabaseOffsetsCVFH() != parallel.getDatabaseOffsetsCVFH() ||
+      serial.getDatabaseOffsetsOURCVFH() != parallel.getDatabaseOffsetsOURCVFH())
+  {
+    print_error("Names or cluster offsets differ between serial and parallel generation\n");
+    ok = false;
+  }
+  const char* threads ("between serial and parallel generation");
+  const size_t n = serial.getDatabaseNames().size();
+  ok = sameRows(*serial.getDatabaseVFH(), *parallel.getDatabaseVFH(), n, "VFH", threads) && ok;
+  ok = sameRows(*serial.getDatabaseESF(), *parallel.getDatabaseESF(), n, "ESF", threads) && ok;
+  ok = sameRows(*serial.getDatabaseCVFH(), *parallel.getDatabaseCVFH(), serial.getDatabaseOffsetsCVFH().back(),
+      "CVFH", threads) && ok;
+  ok = sameRows(*serial.getDatabaseOURCVFH(), *parallel.getDatabaseOURCVFH(),
+      serial.getDatabaseOffsetsOURCVFH().back(), "OURCVFH", threads) && ok;
+  ok = sameRows(*serial.getDatabaseFrames(), *parallel.getDatabaseFrames(), n, "Frames", threads) && ok;
+  //order: poses of the first objects do not depend on the ones generated after them
+  const size_t m = fewer.getDatabaseNames().size();
+  const std::vector<std::string> names (serial.getDatabaseNames());
+  const std::vector<size_t> cvfh_prefix (serial.getDatabaseOffsetsCVFH().begin(),
+      serial.getDatabaseOffsetsCVFH().begin() + m + 1);
+  const std::vector<size_t> ourcvfh_prefix (serial.getDatabaseOffsetsOURCVFH().begin(),
+      serial.getDatabaseOffsetsOURCVFH().begin() + m + 1);
+  if (std::vector<std::string>(names.begin(), names.begin() + m) != fewer.getDatabaseNames() ||
+      cvfh_prefix != fewer.getDatabaseOffsetsCVFH() || ourcvfh_prefix != fewer.getDatabaseOffsetsOURCVFH())
+  {
+    print_error("Names or cluster offsets of the first poses change with the number of objects\n");
+    ok = false;
+  }
+  const char* order ("when fewer objects are generated");
+  ok = sameRows(*serial.getDatabaseVFH(), *fewer.getDatabaseVFH(), m, "VFH", order) && ok;
+  ok = sameRows(*serial.getDatabaseESF(), *fewer.getDatabaseESF(), m, "ESF", order) && ok;
+  ok = sameRows(*serial.getDatabaseCVFH(), *fewer.getDatabaseCVFH(), cvfh_prefix.back(), "CVFH", order) && ok;
+  ok = sameRows(*serial.getDatabaseOURCVFH(), *fewer.getDatabaseOURCVFH(), ourcvfh_prefix.back(), "OURCVFH",
+      order) && ok;
+  //layout, against the complete Database of the same poses
+  if (fewer.getDatabaseNames() != complete.getDatabaseNames())
+  {
+    print_error("Names differ from the ones of create()\n");
+    ok = false;
+  }
+  ok = validOffsets(fewer.getDatabaseOffsetsCVFH(), fewer.getDatabaseCVFH()->rows, fewer.getDatabaseNames(),
+      fewer.getDatabaseNamesCVFH(), "Generated CVFH") && ok;
+  ok = validOffsets(fewer.getDatabaseOffsetsOURCVFH(), fewer.getDatabaseOURCVFH()->rows, fewer.getDatabaseNames(),
+      fewer.getDatabaseNamesOURCVFH(), "Generated OURCVFH") && ok;
+  ok = validOffsets(complete.getDatabaseOffsetsCVFH(), complete.getDatabaseCVFH()->rows, complete.getDatabaseNames(),
+      complete.getDatabaseNamesCVFH(), "Created CVFH") && ok;
+  ok = validOffsets(complete.getDatabaseOffsetsOURCVFH(), complete.getDatabaseOURCVFH()->rows,
+      complete.getDatabaseNames(), complete.getDatabaseNamesOURCVFH(), "Created OURCVFH") && ok;
+  if (fewer.getDatabaseVFH()->rows != complete.getDatabaseVFH()->rows ||
+      fewer.getDatabaseESF()->rows != complete.getDatabaseESF()->rows ||
+      fewer.getDatabaseFrames()->rows != complete.getDatabaseFrames()->rows)
+  {
+    print_error("Number of VFH, ESF or frame rows differs from the one of create()\n");
+    ok = false;
+  }
+  if (ok)
+    print_info("Descriptors only generation of %zu poses is thread and order independent\n", n);
+  return (ok ? 0 : 1);
+}
@@ -0,0 +1,49 @@
+#include <pel/common.h>
+#include <pcl/console/print.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace pcl::console;
+
+////////////////////////////////////////////////////
+//////////////////  Main  //////////////////////////
+////////////////////////////////////////////////////
+//Every getMinMaxDistance kernel supported by the CPU must agree with the scalar one, up to float rounding,
+//also on sizes that are not a multiple of its vector width
+int
+main ()
+{
+  const int sizes[] = {0, 1, 3, 4, 5, 7, 8, 9, 15, 16, 17, 24, 31, 32, 33, 63, 64, 65, 307, 308, 309, 640};
+  const int max_size = *std::max_element(std::begin(sizes), std::end(sizes));
+  std::mt19937 rng (42);
+  std::uniform_real_distribution<float> value (0.0f, 100.0f);
+  std::bernoulli_distribution empty (0.2);
+  //histograms with some empty bins, like real ones
+  std::vector<float> a (max_size), b (max_size);
+  const std::vector<std::string> kernels = pel::getMinMaxDistanceKernels();
+  int failures (0);
+  for (const auto& kernel : kernels)
+  {
+    for (const int size : sizes)
+      for (int r=0; r<20; ++r)
+      {
+        for (int i=0; i<size; ++i)
+        {
+          a[i] = empty(rng) ? 0.0f : value(rng);
+          b[i] = empty(rng) ? 0.0f : value(rng);
+        }
+        const float expected = pel::getMinMaxDistanceScalar(a.data(), b.data(), size);
+        const float got = pel::getMinMaxDistance(kernel, a.data(), b.data(), size);
+        if (!(std::fabs(got - expected) <= 1e-5f * std::max(1.0f, std::fabs(expected))))
+        {
+          print_error("Kernel %s with size %d gives %.9g, scalar gives %.9g\n", kernel.c_str(), size, got, expected);
+          ++failures;
+        }
+      }
+    print_info("Kernel %s checked\n", kernel.c_str());
+  }
+  return (failures == 0 ? 0 : 1);
+}
@@ -0,0 +1,137 @@
+#include <pel/pipeline_stats.h>
+#include <pcl/console/print.h>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <limits>
+#include <sstream>
+#include <string>
+
+using namespace pcl::console;
+
+//Tell if the parsed tree has a value at path equal to expected
+bool
+check (const boost::property_tree::ptree& tree, const std::string& path, const std::string& expected)
+{
+  boost::optional<std::string> value = tree.get_optional<std::string>(path);
+  if (!value)
+  {
+    print_error("Missing %s\n", path.c_str());
+    return (false);
+  }
+  if (*value != expected)
+  {
+    print_error("%s is '%s', expected '%s'\n", path.c_str(), value->c_str(), expected.c_str());
+    return (false);
+  }
+  return (true);
+}
+
+////////////////////////////////////////////////////
+//////////////////  Main  //////////////////////////
+////////////////////////////////////////////////////
+//Export a filled PipelineStats and parse it back with a JSON parser: every stage must be there with its counts,
+//and names with quotes, backslashes or control characters must survive the round trip
+int
+main ()
+{
+  const std::string target_name ("shelf \"left\"\\bin\t2\n\x01");
+  const std::string candidate_names[] = {"mug \"red\"", "box\\small", "can\r\n\x1f"};
+  pel::PipelineStats stats;
+  stats.target_name = target_name;
+  stats.points.input = 5000;
+  stats.points.filter = 4800;
+  stats.points.upsampling = 4800;
+  stats.points.downsampling = 1200;
+  stats.target.esf = 2.5;
+  stats.target.total = 10;
+  stats.lists.vfh = 0.5;
+  stats.lists.cascade_exit = true;
+  stats.pyramid = 1.5;
+  stats.estimation = 42;
+  stats.success = true;
+  for (unsigned int l=0; l<2; ++l)
+  {
+    pel::PipelineStats::ICPStep step;
+    step.level = 1 - l;
+    step.candidates = 3 - l;
+    step.time = 7;
+    stats.icp_steps.push_back(step);
+  }
+  for (unsigned int i=0; i<3; ++i)
+  {
+    pel::PipelineStats::CandidateICP st;
+    st.name = candidate_names[i];
+    st.iterations = 10*(i+1);
+    st.rmse = 0.25;
+    st.time = 3;
+    stats.icp.push_back(st);
+  }
+  stats.icp[2].cancelled = true;
+  stats.icp[2].rmse = std::numeric_limits<float>::quiet_NaN();
+
+  boost::property_tree::ptree tree;
+  std::istringstream js (stats.toJSON());
+  try
+  {
+    boost::property_tree::read_json(js, tree);
+  }
+  catch (const boost::property_tree::json_parser_error& e)
+  {
+    print_error("Exported statistics are not valid JSON: %s\n", e.what());
+    return (1);
+  }
+  bool ok (true);
+  ok = check(tree, "target.name", target_name) && ok;
+  ok = check(tree, "target.points.input", "5000") && ok;
+  ok = check(tree, "target.points.filter", "4800") && ok;
+  ok = check(tree, "target.points.upsampling", "4800") && ok;
+  ok = check(tree, "target.points.downsampling", "1200") && ok;
+  const char* target_stages[] = {"filter", "upsampling", "downsampling", "tree", "esf", "normals", "vfh", "cvfh",
+    "ourcvfh", "composite", "total"};
+  for (const char* s: target_stages)
+    ok = check(tree, std::string("target.time.") + s, s == std::string("esf") ? "2.5" :
+        (s == std::string("total") ? "10" : "0")) && ok;
+  const char* list_stages[] = {"vfh", "esf", "cvfh", "ourcvfh", "composite", "total"};
+  for (const char* s: list_stages)
+    ok = check(tree, std::string("lists.") + s, s == std::string("vfh") ? "0.5" : "0") && ok;
+  ok = check(tree, "lists.cascade_exit", "true") && ok;
+  ok = check(tree, "estimation.time", "42") && ok;
+  ok = check(tree, "estimation.success", "true") && ok;
+  ok = check(tree, "estimation.pyramid", "1.5") && ok;
+  //arrays are children with empty keys
+  const boost::property_tree::ptree& steps = tree.get_child("estimation.steps");
+  if (steps.size() != stats.icp_steps.size())
+  {
+    print_error("Exported %zu ICP steps, expected %zu\n", steps.size(), stats.icp_steps.size());
+    ok = false;
+  }
+  unsigned int i (0);
+  for (const auto& s: steps)
+  {
+    ok = check(s.second, "level", std::to_string(1 - i)) && ok;
+    ok = check(s.second, "candidates", std::to_string(3 - i)) && ok;
+    ok = check(s.second, "time", "7") && ok;
+    ++i;
+  }
+  const boost::property_tree::ptree& icp = tree.get_child("estimation.icp");
+  if (icp.size() != stats.icp.size())
+  {
+    print_error("Exported %zu ICP alignments, expected %zu\n", icp.size(), stats.icp.size());
+    ok = false;
+  }
+  i = 0;
+  for (const auto& c: icp)
+  {
+    if (i >= stats.icp.size())
+      break;
+    ok = check(c.second, "name", candidate_names[i]) && ok;
+    ok = check(c.second, "iterations", std::to_string(10*(i+1))) && ok;
+    //NaN is not JSON, a cancelled alignment has no RMSE
+    ok = check(c.second, "rmse", i < 2 ? "0.25" : "null") && ok;
+    ok = check(c.second, "cancelled", i < 2 ? "false" : "true") && ok;
+    ++i;
+  }
+  if (ok)
+    print_info("Pipeline statistics survive a JSON round trip\n");
+  return (ok ? 0 : 1);
+}
@@ -45,35 +45,37 @@ namespace pel
   {
     public:
       /**\brief Empty constructor */
-      Candidate () : rank_ (0), name_(), distance_(-1), normalized_distance_(-1), rmse_(-1),
+      Candidate () : rank_ (0), pose_id_(-1), name_(), distance_(-1), normalized_distance_(-1), rmse_(-1),
         transformation_(Eigen::Matrix4f::Identity ())
       {}
       /**\brief Constructor with name and cloud pointer
        * \param[in] str The Candidate name
-       * \parma[in] clp Shared pointer to point cloud containing the candidate
+       * \parma[in] clp Shared pointer to point cloud containing the candidate, it is shared not copied
       */
-      Candidate (std::string str, PtC::Ptr clp) : rank_(0), name_(str), distance_(-1),
+      Candidate (std::string str, PtC::ConstPtr clp) : rank_(0), pose_id_(-1), name_(str), distance_(-1),
         normalized_distance_(-1), rmse_(-1), cloud_(clp)
       {}
       /**\brief Destructor */
       virtual ~Candidate () {}
 
-      /**\brief assignment operator
+      /**\brief Copy constructor, the point cloud is shared with other
+       *\param[in] other Candidate to copy from
+       */
+      Candidate (const Candidate& other) = default;
+      /**\brief Move constructor
+       *\param[in] other Candidate to move from
+       */
+      Candidate (Candidate&& other) = default;
+      /**\brief assignment operator, the point cloud is shared with other
        *\param[in] other Candidate to copy from
        */
       Candidate&
-      operator= (const Candidate& other)
-      {
-        rank_ = other.rank_;
-        distance_ = other.distance_;
-        normalized_distance_ = other.normalized_distance_;
-        rmse_ = other.rmse_;
-        transformation_ = other.transformation_;
-        name_ = other.name_;
-        cloud_.reset(new PtC);
-        pcl::copyPointCloud(*other.cloud_, *cloud_);
-        return (*this);
-      }
+      operator= (const Candidate& other) = default;
+      /**\brief move assignment operator
+       *\param[in] other Candidate to move from
+       */
+      Candidate&
+      operator= (Candidate&& other) = default;
       /** \brief Get Candidate Rank from the list of candidates it belongs
        * \return The rank of Candidate (if any) in the list, otherwise returns 0
        *
@@ -85,6 +87,17 @@ namespace pel
         return (rank_);
       }
 
+      /** \brief Get the index of the Database pose this Candidate was built from
+       * \return The pose index in Database (if any), otherwise -1
+       *
+       * \note A Candidate has a pose index only after list(s) of Candidates are built by PoseEstimation
+       */
+      inline int
+      getPoseId () const
+      {
+        return (pose_id_);
+      }
+
       /** \brief Get the distance of Candidate from target point cloud in the metric chosen by the feature
        * \return The distance of candidate from target point cloud (if any), otherwise -1
        *
@@ -131,14 +144,22 @@ namespace pel
         return (transformation_);
       }
 
-      /** \brief Get a copy of the point cloud representing the Candidate
-       * \return Point cloud of the candidate
+      /** \brief Get the point cloud representing the Candidate
+       * \return Const reference to point cloud of the candidate
        */
-      inline PtC
+      inline const PtC&
       getCloud () const
       {
         return (*cloud_);
       }
+      /** \brief Get a shared pointer to the point cloud representing the Candidate
+       * \return Shared pointer to (immutable) point cloud of the candidate
+       */
+      inline PtC::ConstPtr
+      getCloudPtr () const
+      {
+        return (cloud_);
+      }
 
       /** \brief Get Candidate name
        * \return The name of the Candidate
@@ -160,10 +181,11 @@ namespace pel
        *\param[in] cloud Pointer to point cloud to set
         */
       inline void
-      setCloud (const PtC::Ptr& cloud)
+      setCloud (const PtC::ConstPtr& cloud)
       {
-        cloud_.reset(new PtC);
-        pcl::copyPointCloud(*cloud, *cloud_);
+        PtC::Ptr copy (new PtC);
+        pcl::copyPointCloud(*cloud, *copy);
+        cloud_ = copy;
       }
       /**\brief Set Rank of Candidate
        *\param[in] rank Rank to set
@@ -173,6 +195,14 @@ namespace pel
       {
         rank_ = rank;
       }
+      /**\brief Set index of the Database pose this Candidate was built from
+       *\param[in] id Pose index to set
+       */
+      inline void
+      setPoseId (int id)
+      {
+        pose_id_ = id;
+      }
       /**\brief Set Distance of Candidate
        *\param[in] dist Distance to set
       */
@@ -209,8 +239,9 @@ namespace pel
       EIGEN_MAKE_ALIGNED_OPERATOR_NEW
     private:
       std::string name_;
-      PtC::Ptr cloud_;
+      PtC::ConstPtr cloud_;
       int rank_;
+      int pose_id_;
       float distance_;
       float normalized_distance_;
       float rmse_;
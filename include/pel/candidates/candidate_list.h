@@ -85,14 +85,16 @@ namespace pel
        */
       bool
       sortListByNormalizedDistance (ListType type);
-      /**\brief Find a Candidate in the specified list by name, save its distance and remove it from the list
-       * \param[in] list The List of Candidates to modify
-       * \param[in] name The Candidate Name to find
-       * \parma[out] dist Distance found
-       * \returns _True_ if operation succeded, _False_ otherwise
+      /**\brief Fuse lists of Candidates into one, keyed by Database pose index
+       * \param[in] lists The Lists of Candidates to fuse, one for each feature in use
+       * \param[out] fused The fused List, unsorted
+       *
+       * Each Candidate appears once in the fused List, with normalized distance averaged over all lists.
+       * A list that does not contain the Candidate contributes with maximum normalized distance (1).
+       * Rank and distance are the ones from the first list containing the Candidate.
        */
-      bool
-      findAndEraseCandidate(std::vector<Candidate>& list, std::string name, float dist);
+      void
+      fuseLists (const std::vector<const std::vector<Candidate>* >& lists, std::vector<Candidate>& fused) const;
       /**\brief Sort lists based on Minimum RMSE
        * \param[in] list Reference to an external list to sort
        * \returns _True_ if sorting succeded, _False_ otherwise
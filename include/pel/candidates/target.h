@@ -35,6 +35,7 @@
 #define PEL_TARGET_H_
 
 #include <pel/common.h>
+#include <pcl/search/kdtree.h>
 
 namespace pel
 {
@@ -77,6 +78,8 @@ namespace pel
       std::string target_name;
       PtC::Ptr target_cloud;
       PtC::Ptr target_cloud_processed;
+      ///Search tree over target_cloud_processed, built once after preprocessing and shared by every stage
+      pcl::search::KdTree<Pt>::Ptr target_tree;
       ///Container that holds the target VFH feature
       pcl::PointCloud<pcl::VFHSignature308> target_vfh;
       ///Container that holds the target CVFH feature
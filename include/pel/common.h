@@ -91,10 +91,15 @@
  *  when the user constructs one the interface class. The main methods to read and set a parameter are
  *  pel::ParamHandler::getParam(key) and pel::ParamHandler::setParam(key, value), inherited by _interface classes_.
  *  Note that each parameter has minimum and maximum allowable values, even if they are _floats_ internally. Also each method to handle parameters won't let
- *  you set a key that doesn't exist or an out of range value. All available parameters are described in the table below:
+ *  you set a key that doesn't exist or an out of range value. Parameters are validated and take effect on pel::ParamHandler::commit(), which
+ *  is also called by setTarget(), pose estimation and Database creation if some parameter changed. All available parameters are described in the table below:
 
 | key         | Default Value | Range | Description                                                          |
 |:-----------:|:-------------:|:------:|:-----------------------------------------------------------------------|
+| cascade     | 0            | 0 or 1 | (1) Generate lists as a cascade: ESF and VFH lists are searched first and CVFH/OURCVFH are computed and searched only if those lists are ambiguous, see cascade_top, cascade_agreement and cascade_margin. (0) Always compute and search every enabled feature. Relevant only if at least one of ESF/VFH and one of CVFH/OURCVFH are enabled.|
+| cascade_agreement | 0.6    | >=0, <=1 | Fraction of the first cascade_top Candidates that ESF and VFH lists must have in common to skip CVFH/OURCVFH. Relevant only if cascade is enabled.|
+| cascade_margin | 0.1       | >=0, <=1 | Minimum gap in normalized distance between the first and second Candidate of the list fused from ESF and VFH to skip CVFH/OURCVFH. Relevant only if cascade is enabled.|
+| cascade_top | 5            | >=1 | How many of the first Candidates of ESF and VFH lists are compared for agreement. Relevant only if cascade is enabled.|
 | cvfh_ang_thresh | 7.5     |>0 | Set maximum allowable deviation of the normals in degrees, in the region segmentation step of CVFH computation. The value recommended from relative paper is 7.5 degrees. Relevant only if use_cvfh is enabled.<sup>2</sup>|
 | cvfh_curv_thresh  | 0.025 |>0 | Set maximum allowable disparity of curvatures during region segmentation step of CVFH estimation. The value recommended from relative paper is 0.025. Relevant only if use_cvfh is enabled.<sup>2</sup>|
 | cvfh_clus_tol  | 0.01     | >0 | Euclidean clustering tolerance, during CVFH segmentation. Points distant more than this value from each other, will likely be grouped in different clusters. A value of 1 means one meter. Relevant only if use_cvfh is enabled.<sup>2</sup>|
@@ -221,6 +226,7 @@ Notes:
 #include <pcl/point_types.h>
 #include <pcl/point_cloud.h>
 #include <string>
+#include <vector>
 #include <cmath>
 #include <unordered_map>
 #include <Eigen/Dense>
@@ -252,6 +258,8 @@ namespace pel
   typedef boost::posix_time::ptime timestamp;
   ///Enumerator for list of candidates
   enum class ListType {vfh, esf, cvfh, ourcvfh, composite};
+  ///Enumerator for transformation estimation methods used by ICP
+  enum class TransformationType {dq, lm, svd, point_to_plane};
   /// Map that stores configuration parameters in a key=value fashion
   typedef std::unordered_map<std::string,float> parameters;
 
@@ -266,15 +274,67 @@ namespace pel
    *  D = 1 - \frac{1+\sum_i^n{min\left(a_i,b_i\right)}}{1+\sum_i^n{max\left(a_i,b_i\right)}}
    * \f]
    * where n=308 for CVFH/OURCVFH histograms
+   *
+   * \note On x86 CPUs a SIMD implementation (AVX-512, AVX2 or SSE4) is selected at runtime, according
+   * to the features of the running CPU. Results may differ from getMinMaxDistanceScalar() only by float rounding.
    */
   float
   getMinMaxDistance (float* a, float* b, int size=308);
 
+  /**\brief Compute the MinMax distance between two histograms, without SIMD instructions
+   * \param[in] a The first histogram
+   * \param[in] b The second histogram
+   * \param[in] size Size of vectors
+   * \returns The computed distance, see getMinMaxDistance()
+   */
+  float
+  getMinMaxDistanceScalar (float* a, float* b, int size=308);
+
+  /**\brief Get the name of the getMinMaxDistance() implementation selected for the running CPU
+   * \returns One of "avx512", "avx2", "sse4" or "scalar"
+   */
+  const char*
+  getMinMaxDistanceKernel ();
+
+  /**\brief Get the names of all getMinMaxDistance() implementations supported by the running CPU
+   * \returns Names of the implementations, fastest first, "scalar" is always the last one
+   */
+  std::vector<std::string>
+  getMinMaxDistanceKernels ();
+
+  /**\brief Compute the MinMax distance between two histograms with a given implementation, bypassing runtime selection
+   * \param[in] kernel Name of the implementation, one of getMinMaxDistanceKernels()
+   * \param[in] a The first histogram
+   * \param[in] b The second histogram
+   * \param[in] size Size of vectors
+   * \returns The computed distance, see getMinMaxDistance(), or NaN if kernel is not supported by the running CPU
+   */
+  float
+  getMinMaxDistance (const std::string& kernel, float* a, float* b, int size=308);
+
   /**\brief Check if passed path could contain a valid database
    * \param[in] db_path The path to check
    * \returns _True_ if valid, _False_ otherwise
    */
   bool
   isValidDatabasePath (boost::filesystem::path db_path);
+
+  /**\brief Resolve how many threads a parallel section should use
+   * \param[in] requested Number of threads requested by the user, 0 means automatic (one per available core)
+   * \returns Number of threads to use, always at least 1
+   *
+   * \note If PEL is built without OpenMP support this always returns 1.
+   */
+  int
+  resolveNumberOfThreads (unsigned int requested);
+
+  /**\brief Compute the sensor frame of a database pose, used to build the initial guess of ICP
+   * \param[in] cloud Point cloud of the pose in its local reference frame, with sensor_origin_ and sensor_orientation_
+   * set to go back into sensor frame (see \ref guide)
+   * \param[out] transform Transformation from local object frame to sensor frame, as it was during acquisition
+   * \param[out] centroid Centroid of the finite points of cloud, expressed in sensor frame
+   */
+  void
+  computeSensorFrame (const PtC& cloud, Eigen::Matrix4f& transform, Eigen::Vector3f& centroid);
 }
 #endif //PEL_COMMON_H_
@@ -0,0 +1,127 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *   Pose Estimation Library (PEL) - https://bitbucket.org/Tabjones/pose-estimation-library
+ *   Copyright (c) 2014-2015, Federico Spinelli (fspinelli@gmail.com)
+ *   All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder(s) nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef PEL_DATABASE_CLOUD_CACHE_H_
+#define PEL_DATABASE_CLOUD_CACHE_H_
+
+#include <pel/common.h>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <list>
+#include <mutex>
+#include <vector>
+
+namespace pel
+{
+  /**\brief Keeps pose clouds of a Database in memory on demand, within a budget of bytes.
+   *
+   * Clouds are paged in on first use through a loader function (from disk or from a mapped file) and kept
+   * in a Least Recently Used cache, once the budget is exceeded least recently used clouds are evicted.
+   * Returned pointers keep their cloud alive after eviction, so they are always safe to use.
+   * \note All methods are thread safe, loading happens outside of the lock.
+   * \author Federico Spinelli
+   */
+  class CloudCache
+  {
+    public:
+      ///Function that loads the cloud of pose with given index
+      typedef boost::function<PtC::ConstPtr (size_t)> Loader;
+
+      /**\brief Constructor
+       * \param[in] loader Function used to load clouds on cache misses
+       * \param[in] size Number of poses that can be loaded
+       * \param[in] budget Maximum number of bytes of clouds kept resident
+       */
+      CloudCache (const Loader& loader, const size_t size, const size_t budget);
+
+      /**\brief Get the cloud of a pose, loading it if it is not resident.
+       * \param[in] idx Index of the pose
+       * \return Shared pointer to the cloud, empty cloud if idx is out of range
+       */
+      PtC::ConstPtr
+      get (const size_t idx);
+
+      ///\brief Drop all resident clouds, counters are kept
+      void
+      clear ();
+
+      ///\brief Number of poses served by this cache
+      inline size_t
+      size () const
+      {
+        return (slots_.size());
+      }
+      ///\brief Maximum number of bytes of clouds kept resident
+      inline size_t
+      getBudget () const
+      {
+        return (budget_);
+      }
+      ///\brief Function used to load clouds on cache misses, it never changes after construction
+      inline const Loader&
+      getLoader () const
+      {
+        return (loader_);
+      }
+      ///\brief Number of bytes of clouds currently resident
+      size_t
+      getResidentBytes () const;
+      ///\brief Number of requests served by resident clouds
+      size_t
+      getHits () const;
+      ///\brief Number of requests that had to load the cloud
+      size_t
+      getMisses () const;
+      ///\brief Number of clouds evicted to stay within budget
+      size_t
+      getEvictions () const;
+
+    private:
+      ///Resident cloud of a pose, and its position in the LRU list
+      struct Slot
+      {
+        PtC::ConstPtr cloud;
+        std::list<size_t>::iterator lru;
+        size_t bytes;
+      };
+      Loader loader_;
+      size_t budget_;
+      std::vector<Slot> slots_;
+      ///Resident poses, most recently used first
+      std::list<size_t> lru_;
+      size_t resident_bytes_, hits_, misses_, evictions_;
+      mutable std::mutex mutex_;
+  };
+}
+#endif //PEL_DATABASE_CLOUD_CACHE_H_
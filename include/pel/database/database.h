@@ -37,6 +37,10 @@
 #include <pel/common.h>
 #include <pel/database/database_io.h>
 #include <pel/database/database_creator.h>
+#include <pel/database/database_generator.h>
+#include <pel/database/cloud_cache.h>
+#include <pel/database/search_tree_cache.h>
+#include <pel/database/voxel_pyramid_cache.h>
 
 namespace pel
 {
@@ -75,16 +79,47 @@ namespace pel
       boost::shared_ptr<histograms> vfh_, esf_, cvfh_, ourcvfh_;
       ///Names of database clouds
       std::vector<std::string> names_;
-      ///Names of clusters of CVFH and OURCVFH clouds
-      std::vector<std::string> names_cvfh_, names_ourcvfh_;
+      /**\brief Offsets of CVFH and OURCVFH clusters of each pose (compressed row format).
+       * Clusters of pose _i_ are the rows from offsets[i] (included) to offsets[i+1] (excluded) of the relative
+       * histograms, thus offsets have _n+1_ elements, the last one being the total number of clusters.
+       */
+      std::vector<size_t> cvfh_offsets_, ourcvfh_offsets_;
       ///Path to database location on disk
       boost::filesystem::path db_path_;
-      ///Database of point clouds
-      std::vector<PtC> clouds_;
+      ///Database of point clouds, they are never modified once loaded, thus shared among copies and Candidates
+      std::vector<PtC::ConstPtr> clouds_;
+      ///Cache that pages clouds in on demand, if set clouds_ is empty (see DatabaseReader::setLazyClouds)
+      boost::shared_ptr<CloudCache> cloud_cache_;
+      /**\brief Tombstones of poses removed with removePoses(), indexed like names_.
+       * Removed poses keep their histogram rows until compact() is called, but they are never retrieved.
+       * It can be empty, meaning no pose is removed.
+       */
+      std::vector<bool> removed_;
+      ///Number of poses marked in removed_
+      size_t removed_count_;
       ///Flann index for vfh
       boost::shared_ptr<indexVFH> vfh_idx_;
       ///Flann index for esf
       boost::shared_ptr<indexESF> esf_idx_;
+      /**\brief Sensor frame of each pose, one row per pose: the row major 4x4 transformation from local object frame
+       * to sensor frame (as it was during acquisition), followed by the centroid of the pose in sensor frame.
+       * It is empty for databases saved by older versions of PEL, frames are then computed from clouds on demand.
+       */
+      boost::shared_ptr<histograms> frames_;
+      ///Number of columns of frames_
+      static const size_t frame_cols_ = 19;
+      ///Search trees over pose clouds, built on first use and shared among copies
+      boost::shared_ptr<SearchTreeCache> trees_;
+      ///Voxel pyramids over pose clouds, built on first use and shared among copies, empty until setPyramidLeafSize()
+      boost::shared_ptr<VoxelPyramidCache> pyramids_;
+      ///Size in bytes of the tiles of histograms processed at once by computeDistFromClusters (fits in L2 cache)
+      static const size_t tile_bytes_ = 128*1024;
+
+      /**\brief Replace trees_ and pyramids_ with empty caches of the same budget (and leaf size), releasing trees and
+       * coarse levels of poses removed from this database. Copies keep the old caches.
+       */
+      void
+      dropCachedTrees ();
 
       /**\brief Calculates unnormalized distance of objects, based on their cluster distances. This is only used
        * for CVFH and OURCVFH, since other features don't have clusters.
@@ -92,6 +127,10 @@ namespace pel
        * \param[in] feat Enum that indicates from which list the histogram belongs (listType::cvfh or listType::ourcvfh only)
        * \param[out] distIdx Vector of unnormalized distances of objects and their relative index
        * \return _True_ if distances are correctly computed, _false_ otherwise
+       *
+       * \note Database clusters are scanned in cache sized tiles of whole poses, each tile is compared with all
+       * target clusters before moving to the next one, so histograms are read from memory only once per query.
+       * Poses without clusters get an infinite distance.
        */
       bool
         computeDistFromClusters (pcl::PointCloud<pcl::VFHSignature308>::Ptr target, ListType feat, std::vector<std::pair<float, int> >& distIdx);
@@ -99,10 +138,14 @@ namespace pel
     public:
       /** \brief Default empty Constructor
       */
-      Database () {}
+      Database () : removed_count_(0), trees_(new SearchTreeCache) {}
 
       /** \brief Copy constructor
        * \param[in] other Database to copy from
+       *
+       * \note Histograms, FLANN indices and clouds are immutable, thus they are shared with other instead
+       * of being duplicated, copying a Database is cheap and touches no disk. Anything that modifies them
+       * must build new ones and replace the shared pointers.
        */
       Database (const Database& other);
 
@@ -111,7 +154,7 @@ namespace pel
        */
       Database (Database&& other);
 
-      /** \brief Copy assignment operator
+      /** \brief Copy assignment operator, shares histograms, indices and clouds with other
        * \param[in] other Database to copy from
        */
       Database& operator= (const Database& other);
@@ -127,6 +170,58 @@ namespace pel
       void
       clear ();
 
+      /** \brief Add the poses of another database to this one, without recomputing their descriptors.
+       * \param[in] other Database containing the poses to add, for example created by DatabaseCreator from a
+       * directory holding only the new poses
+       * \return _True_ if poses were added, _false_ if other is empty or it contains names already in this
+       * database
+       *
+       * Histograms rows and cluster offsets of other are appended to the ones of this database and added to
+       * FLANN indices with flann::Index::addPoints(), so new poses are immediately queryable. Histograms keep
+       * room for further rows, thus repeated additions neither copy the old rows nor rebuild the indices, the
+       * trees are rebuilt only by FLANN once an index doubled in size and by compact(). Clouds of other are shared.
+       * \note Copies of this database keep seeing the old poses: indices shared with copies are rebuilt
+       * instead of extended, and histograms rows are never overwritten.
+       */
+      bool
+      addPoses (const Database& other);
+
+      /** \brief Remove poses from the database by name
+       * \param[in] names Names of the poses to remove, names not present in database are ignored
+       * \return Number of poses removed
+       *
+       * Removed poses are only marked (tombstoned) and skipped during retrieval, their histograms rows are
+       * dropped by compact(), which is called automatically once more than a quarter of the poses are removed.
+       * Cached search trees and voxel pyramids are dropped, so those of removed poses are released.
+       */
+      size_t
+      removePoses (const std::vector<std::string>& names);
+
+      /** \brief Drop the histograms rows, clouds and names of removed poses and rebuild FLANN indices.
+       * Nothing is done if no pose is removed. Pose indices change after this call.
+       */
+      void
+      compact ();
+
+      /** \brief Tell if a pose was removed with removePoses() and not yet compacted away
+       * \param[in] idx Index of the pose, in [0, n)
+       * \return _True_ if the pose is removed
+       */
+      inline bool
+      isRemoved (const size_t idx) const
+      {
+        return (idx < removed_.size() && removed_[idx]);
+      }
+
+      /** \brief Get the number of poses removed and not yet compacted away
+       * \return Number of removed poses, getDatabaseNames().size() minus this is the number of live poses
+       */
+      inline size_t
+      getNumberOfRemovedPoses () const
+      {
+        return (removed_count_);
+      }
+
       /** \brief Tell if the database is empty
        *\return _True_ if database is not loaded or empty, _False_ otherwise
        */
@@ -181,21 +276,52 @@ namespace pel
       /**\brief get an _m_ lenght vector containing names of poses in database for CVFH descriptor
        *\return vector of names
        _m_ is the number of poses in Database plus the number of clusters of each pose.
+       \note Names are expanded from getDatabaseOffsetsCVFH(), prefer offsets to find clusters of a pose.
        */
-      inline std::vector<std::string>
-      getDatabaseNamesCVFH () const
-      {
-        return (names_cvfh_);
-      }
+      std::vector<std::string>
+      getDatabaseNamesCVFH () const;
       /**\brief get an _p_ lenght vector containing names of poses in database for OURCVFH descriptor
        *\return vector of names
        _p_ is the number of poses in Database plus the number of clusters of each pose.
+       \note Names are expanded from getDatabaseOffsetsOURCVFH(), prefer offsets to find clusters of a pose.
        */
-      inline std::vector<std::string>
-      getDatabaseNamesOURCVFH () const
+      std::vector<std::string>
+      getDatabaseNamesOURCVFH () const;
+      /**\brief get an _n+1_ lenght vector of offsets of CVFH clusters of each pose
+       *\return vector of offsets
+       Clusters of pose _i_ are the rows of getDatabaseCVFH() from offsets[i] to offsets[i+1] (excluded).
+       */
+      inline const std::vector<size_t>&
+      getDatabaseOffsetsCVFH () const
+      {
+        return (cvfh_offsets_);
+      }
+      /**\brief get an _n+1_ lenght vector of offsets of OURCVFH clusters of each pose
+       *\return vector of offsets
+       Clusters of pose _i_ are the rows of getDatabaseOURCVFH() from offsets[i] to offsets[i+1] (excluded).
+       */
+      inline const std::vector<size_t>&
+      getDatabaseOffsetsOURCVFH () const
+      {
+        return (ourcvfh_offsets_);
+      }
+      /**\brief get the sensor frames of poses as pointer to n*19 matrix, see getSensorFrame()
+       *\return Shared pointer to matrix, empty if frames were not precomputed
+       _n_ is the number of poses in Database
+       */
+      inline boost::shared_ptr<histograms>
+      getDatabaseFrames () const
       {
-        return (names_ourcvfh_);
+        return (frames_);
       }
+      /**\brief get the sensor frame of a pose, precomputed at database creation
+       *\param[in] idx Index of the pose, in [0, n)
+       *\param[out] transform Transformation from local object frame to sensor frame, as it was during acquisition
+       *\param[out] centroid Centroid of the pose in sensor frame
+       *\note If frames were not precomputed they are computed from the pose cloud, see computeSensorFrame()
+       */
+      void
+      getSensorFrame (const size_t idx, Eigen::Matrix4f& transform, Eigen::Vector3f& centroid) const;
       /**\brief get a path to Database saved location, if exists.
        *\return path of directory containing Database on disk
        */
@@ -205,14 +331,55 @@ namespace pel
         return (db_path_);
       }
       /**\brief get an _n_ lenght vector containing point clouds of poses in database
-       *\return vector of point clouds
+       *\return vector of shared pointers to (immutable) point clouds
        _n_ is the number of poses in Database
+       \note If clouds are loaded lazily this pages in all of them, use getDatabaseCloud() instead.
+       */
+      std::vector<PtC::ConstPtr>
+      getDatabaseClouds () const;
+      /**\brief get the point cloud of a pose in database, paging it in if clouds are loaded lazily
+       *\param[in] idx Index of the pose, in [0, n)
+       *\return shared pointer to (immutable) point cloud, an empty one if idx is out of range
+       */
+      PtC::ConstPtr
+      getDatabaseCloud (const size_t idx) const;
+      /**\brief get the cache used to page clouds in on demand
+       *\return shared pointer to the cache, or an empty pointer if all clouds are resident
        */
-      inline std::vector<PtC>
-      getDatabaseClouds () const
+      inline boost::shared_ptr<CloudCache>
+      getCloudCache () const
       {
-        return (clouds_);
+        return (cloud_cache_);
       }
+      /**\brief get a search tree over the point cloud of a pose, built on first use and shared among copies
+       *\param[in] idx Index of the pose, in [0, n)
+       *\return shared pointer to the tree, its input cloud is getDatabaseCloud(idx). It must only be searched.
+       *\note Trees are reused by ICP for reciprocal correspondences, see PoseCorrespondenceEstimation
+       */
+      SearchTreeCache::Tree::Ptr
+      getDatabaseSearchTree (const size_t idx) const;
+      /**\brief get a search tree over a level of the voxel pyramid of a pose, see getDatabasePyramidCloud()
+       *\param[in] idx Index of the pose, in [0, n)
+       *\param[in] level Level of the pyramid, 0 is the same as getDatabaseSearchTree(idx)
+       *\return shared pointer to the tree, its input cloud is getDatabasePyramidCloud(idx, level). It must only be searched.
+       */
+      SearchTreeCache::Tree::Ptr
+      getDatabaseSearchTree (const size_t idx, const unsigned int level) const;
+      /**\brief Set the leaf size of the voxel pyramids of poses, see getDatabasePyramidCloud()
+       *\param[in] leaf Leaf size of level 1, each further level doubles it. A value of 1 means one meter.
+       *\note Pyramids already built with a different leaf size are dropped. Not thread safe, call it before
+       * requesting levels concurrently.
+       */
+      void
+      setPyramidLeafSize (const float leaf);
+      /**\brief get a level of the voxel pyramid of a pose, built on first use and shared among copies
+       *\param[in] idx Index of the pose, in [0, n)
+       *\param[in] level Level of the pyramid, 0 is the pose cloud itself, level _l_ is downsampled with a leaf
+       * size of leaf*2^(l-1), see setPyramidLeafSize()
+       *\return shared pointer to (immutable) point cloud, the pose cloud itself if no leaf size was set
+       */
+      PtC::ConstPtr
+      getDatabasePyramidCloud (const size_t idx, const unsigned int level) const;
       /**\brief get a pointer to FLANN index for VFH histograms
        *\return shared pointer of FLANN index
        */
@@ -231,8 +398,11 @@ namespace pel
       }
       ///Friend functions of this class
       friend bool DatabaseReader::load (boost::filesystem::path, Database&);
+      friend bool DatabaseReader::loadSingleFile (boost::filesystem::path, Database&);
       friend bool DatabaseWriter::save (boost::filesystem::path, const Database&, bool);
+      friend bool DatabaseWriter::saveSingleFile (boost::filesystem::path, const Database&, bool);
       friend Database DatabaseCreator::create (boost::filesystem::path path_cloud);
+      friend Database DatabaseGenerator::createDescriptorsOnly () const;
   };
 }
 
@@ -70,10 +70,32 @@ namespace pel
    */
   class DatabaseCreator : public ParamHandler
   {
+    protected:
+      ///Everything computed from a single pose, before merging it into the Database
+      struct PoseData
+      {
+        std::string name;
+        PtC::ConstPtr cloud;
+        pcl::VFHSignature308 vfh;
+        pcl::ESFSignature640 esf;
+        std::vector<pcl::VFHSignature308> cvfh, ourcvfh;
+      };
+      ///Number of threads requested for creation, 0 means automatic
+      unsigned int threads_;
+
+      /**\brief Load a pose, preprocess it and compute all its features.
+       * \param[in] file Path of the pcd file of the pose
+       * \param[out] pose Results of the processing
+       * \param[in] normal_threads Threads used by normal estimation, 0 means automatic
+       * \returns _True_ if pose was processed, _False_ if it must be skipped
+       */
+      bool
+      processPose (const boost::filesystem::path& file, PoseData& pose, const int normal_threads) const;
+
     public:
       /**\brief Empty Constructor
       */
-      DatabaseCreator () {}
+      DatabaseCreator () : threads_(1) {}
 
       /**\brief Empty Destructor.
       */
@@ -93,6 +115,19 @@ namespace pel
       Database
       create (boost::filesystem::path path_clouds);
 
+      /**\brief Set how many threads to use when creating a database.
+       * \param[in] nr_threads Number of threads to use, 0 means automatic (one per available core).
+       *
+       * Each thread processes whole poses, results are then merged in sorted file order, thus the
+       * created Database does not depend on the number of threads.
+       * \note Default is 1, i.e. sequential creation, like the estimators. Has no effect if PEL is built without OpenMP.
+       */
+      inline void
+      setNumberOfThreads (const unsigned int nr_threads = 0)
+      {
+        threads_ = nr_threads;
+      }
+
   };
 
 }
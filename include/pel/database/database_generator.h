@@ -0,0 +1,247 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *   Pose Estimation Library (PEL) - https://bitbucket.org/Tabjones/pose-estimation-library
+ *   Copyright (c) 2014-2015, Federico Spinelli (fspinelli@gmail.com)
+ *   All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder(s) nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PEL_DATABASE_DATABASE_GENERATOR_H_
+#define PEL_DATABASE_DATABASE_GENERATOR_H_
+
+#include <pel/common.h>
+#include <pel/database/database_creator.h>
+#include <boost/filesystem.hpp>
+#include <random>
+
+namespace pel
+{
+  class Database;
+  /**\brief Generates synthetic databases of arbitrary size, for load testing, benchmarks and capacity planning.
+   *
+   * Objects are convex parametric shapes (spheres, boxes and cylinders) of random size, each one seen from
+   * viewpoints evenly spread on a sphere around it. A pose is the partial cloud of the side of the shape facing
+   * the sensor, expressed in the shape reference frame, with sensor_origin_ and sensor_orientation_ set to go
+   * back into sensor frame, exactly like acquired poses. Everything depends only on the seed and on the object
+   * and view indices, so the same pose is generated regardless of order or number of threads.
+   *
+   * Two kinds of databases can be generated:
+   * - create() writes poses as pcd files and feeds them through a DatabaseCreator, the result is a complete
+   *   Database, suited to test the whole pipeline up to a few thousands poses;
+   * - createDescriptorsOnly() skips clouds and feature estimation, it fills histograms directly with random
+   *   ones that are similar among views of the same object. It scales to millions of poses and is meant to
+   *   stress retrieval, all poses share one placeholder cloud.
+   *
+   * Example usage:
+   * \code
+   * #include <pel/database/database_generator.h>
+   * #include <pel/database/database.h>
+   * //...
+   * pel::DatabaseGenerator generator;
+   * generator.setSeed(7);
+   * generator.setNumberOfObjects(1000);
+   * generator.setViewsPerObject(100);
+   * pel::Database db = generator.createDescriptorsOnly(); //100000 poses
+   * //... or a smaller but complete one, with creation parameters of choice
+   * generator.setNumberOfObjects(5);
+   * pel::DatabaseCreator creator;
+   * pel::Database small = generator.create(creator);
+   * \endcode
+   * \author Federico Spinelli
+   */
+  class DatabaseGenerator
+  {
+    protected:
+      ///Seed of every random draw
+      unsigned int seed_;
+      ///Number of objects
+      unsigned int objects_;
+      ///Number of views of each object
+      unsigned int views_;
+      ///Number of points of each view
+      unsigned int points_;
+      ///Distance of viewpoints from the object centre
+      float distance_;
+      ///Standard deviation of the gaussian noise added to points
+      float noise_;
+      ///Maximum displacement of the viewpoint of a Target from the one of its pose, along each axis
+      float jitter_;
+      ///Number of threads used by createDescriptorsOnly(), 0 means automatic
+      unsigned int threads_;
+
+      ///Convex parametric shape centered on its local reference frame
+      struct Shape
+      {
+        ///0 sphere, 1 box, 2 cylinder
+        int type;
+        ///Radius of sphere, half sides of box, radius and half height of cylinder
+        Eigen::Vector3f size;
+      };
+      /**\brief Get the shape of an object
+       * \param[in] object Index of the object
+       */
+      Shape
+      getShape (const unsigned int object) const;
+      /**\brief Random generator of a stream of draws, independent from the other streams
+       * \param[in] object Index of the object
+       * \param[in] view Index of the view
+       * \param[in] stream Purpose of the draws
+       */
+      std::mt19937
+      getGenerator (const unsigned int object, const unsigned int view, const unsigned int stream) const;
+      /**\brief Sample the part of a shape visible from a viewpoint
+       * \param[in] shape Shape to sample
+       * \param[in] eye Viewpoint, the sensor looks at the origin of the shape frame
+       * \param[in] rng Random generator to draw from
+       * \return Cloud in the shape reference frame, with sensor_origin_ and sensor_orientation_ set
+       */
+      PtC::Ptr
+      sampleView (const Shape& shape, const Eigen::Vector3f& eye, std::mt19937& rng) const;
+
+    public:
+      /**\brief Constructor, defaults are 10 objects with 24 views of 1500 points each, seen from 0.6 meters
+       */
+      DatabaseGenerator () : seed_(42), objects_(10), views_(24), points_(1500), distance_(0.6f), noise_(0.0003f),
+        jitter_(0.03f), threads_(1) {}
+
+      ///\brief Set the seed of generation
+      inline void
+      setSeed (const unsigned int seed)
+      {
+        seed_ = seed;
+      }
+      ///\brief Set how many objects to generate
+      inline void
+      setNumberOfObjects (const unsigned int objects)
+      {
+        objects_ = objects;
+      }
+      ///\brief Set how many views of each object to generate, the Database holds objects*views poses
+      inline void
+      setViewsPerObject (const unsigned int views)
+      {
+        views_ = views;
+      }
+      ///\brief Set how many points each view has
+      inline void
+      setPointsPerView (const unsigned int points)
+      {
+        points_ = points;
+      }
+      ///\brief Set the distance of viewpoints from the object centre, in meters
+      inline void
+      setSensorDistance (const float distance)
+      {
+        distance_ = distance;
+      }
+      ///\brief Set the standard deviation of the gaussian noise added to each point coordinate, in meters
+      inline void
+      setNoise (const float noise)
+      {
+        noise_ = noise;
+      }
+      ///\brief Set how far, along each axis, the viewpoint of a Target can be from the one of its pose, in meters
+      inline void
+      setTargetJitter (const float jitter)
+      {
+        jitter_ = jitter;
+      }
+      /**\brief Set how many threads createDescriptorsOnly() uses
+       * \param[in] nr_threads Number of threads to use, 0 means automatic (one per available core).
+       * \note Default is 1.
+       */
+      inline void
+      setNumberOfThreads (const unsigned int nr_threads = 0)
+      {
+        threads_ = nr_threads;
+      }
+      ///\brief Get the number of poses generated, objects times views
+      inline size_t
+      getNumberOfPoses () const
+      {
+        return (static_cast<size_t>(objects_) * views_);
+      }
+
+      /**\brief Get the viewpoint of a view, evenly spread on a sphere around the object (Fibonacci lattice)
+       * \param[in] view Index of the view
+       * \return Position of the sensor in the object reference frame
+       */
+      Eigen::Vector3f
+      getViewpoint (const unsigned int view) const;
+
+      /**\brief Get the name of a pose, names sort in generation order
+       * \param[in] object Index of the object
+       * \param[in] view Index of the view
+       */
+      std::string
+      getPoseName (const unsigned int object, const unsigned int view) const;
+
+      /**\brief Generate a pose
+       * \param[in] object Index of the object
+       * \param[in] view Index of the view
+       * \return Cloud in the object reference frame, with sensor_origin_ and sensor_orientation_ set to go back into
+       * sensor frame, as DatabaseCreator expects
+       */
+      PtC::Ptr
+      generatePose (const unsigned int object, const unsigned int view) const;
+
+      /**\brief Generate a Target, seen from a viewpoint close to the one of a pose but never identical
+       * \param[in] object Index of the object
+       * \param[in] view Index of the view the Target is close to
+       * \return Cloud in sensor frame, ready for PoseEstimationBase::setTarget()
+       */
+      PtC::Ptr
+      generateTarget (const unsigned int object, const unsigned int view) const;
+
+      /**\brief Write all poses as pcd files named after getPoseName()
+       * \param[in] path Directory to write into, it is created if it does not exist
+       * \return _True_ if all poses were written, _False_ otherwise
+       */
+      bool
+      writePoses (boost::filesystem::path path) const;
+
+      /**\brief Create a complete Database from generated poses
+       * \param[in] creator DatabaseCreator to use, with its parameters and threads
+       * \return Created Database, or an empty one if failed
+       * \note Poses are written into a temporary directory, removed before returning.
+       */
+      Database
+      create (DatabaseCreator& creator) const;
+
+      /**\brief Create a Database with synthetic histograms only, skipping clouds and feature estimation
+       * \return Created Database, or an empty one if failed
+       *
+       * Each object has random VFH, ESF, CVFH and OURCVFH prototype histograms, every view perturbs them and has
+       * one to three CVFH and OURCVFH clusters. Names and sensor frames are the ones of the poses of create(),
+       * all poses share one placeholder cloud, so estimators run but their result is meaningless.
+       */
+      Database
+      createDescriptorsOnly () const;
+  };
+}
+#endif //PEL_DATABASE_DATABASE_GENERATOR_H_
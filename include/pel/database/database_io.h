@@ -62,13 +62,36 @@ namespace pel
    */
   class DatabaseReader
   {
-    ///Last succesfully loaded path
-    boost::filesystem::path last_loaded_;
+    public:
+      ///Time spent (ms) in each phase of the last load
+      struct LoadTimings
+      {
+        LoadTimings () : clouds(0), histograms(0), indices(0), lists(0), total(0) {}
+        ///Decoding of all clouds
+        double clouds;
+        ///Loading of histogram matrices
+        double histograms;
+        ///Loading of FLANN indices
+        double indices;
+        ///Loading of names and cluster offsets
+        double lists;
+        ///Wall time of the whole load, phases overlap so this is less than their sum
+        double total;
+      };
+    private:
+      ///Last succesfully loaded path
+      boost::filesystem::path last_loaded_;
+      ///Number of threads requested for loading, 0 means automatic
+      unsigned int threads_;
+      ///Timings of the last load
+      LoadTimings timings_;
+      ///Bytes of clouds kept resident when loading them lazily, 0 means load all of them
+      size_t cloud_budget_;
 
     public:
       /**\brief Empty Constructor
       */
-      DatabaseReader () {last_loaded_.clear();}
+      DatabaseReader () : threads_(1), cloud_budget_(0) {last_loaded_.clear();}
 
       /**\brief Empty Destructor.
       */
@@ -93,6 +116,18 @@ namespace pel
       Database
       load (boost::filesystem::path path);
 
+      /**\brief Load a database saved in a single file by DatabaseWriter::saveSingleFile.
+       * \param[in] path Path to the file on disk containing database to load
+       * \parma[out] target Database object to load into.
+       * \returns _True_ if operation is succesful, _False_ otherwise.
+       *
+       * The file is memory mapped read-only and histograms of target point straight into the mapping,
+       * which stays alive as long as any copy of target uses it. Processes loading the same file share its pages.
+       * \note load() calls this automatically when path is a regular file.
+       */
+      bool
+      loadSingleFile (boost::filesystem::path path, Database& target);
+
       /**\brief Reload a database from the last succesfully loaded path.
        * \param[out] target Database object to load into.
        * \returns _True_ if operation is succesful, _False_ otherwise
@@ -105,6 +140,41 @@ namespace pel
        */
       Database
       reload ();
+
+      /**\brief Set how many threads to use when loading a database.
+       * \param[in] nr_threads Number of threads to use, 0 means automatic (one per available core).
+       *
+       * One thread loads histograms, indices and lists while all the others decode the clouds, then joins them.
+       * Clouds are always stored in sorted file order, regardless of the number of threads.
+       * \note Default is 1, i.e. sequential loading. Has no effect if PEL is built without OpenMP.
+       */
+      inline void
+      setNumberOfThreads (const unsigned int nr_threads = 0)
+      {
+        threads_ = nr_threads;
+      }
+
+      /**\brief Load pose clouds lazily, keeping at most budget bytes of them in memory.
+       * \param[in] budget Maximum bytes of clouds kept resident, 0 loads all clouds (default).
+       *
+       * When set, loading only reads histograms, indices and lists. Clouds are paged in on first use (from their PCD
+       * files or from the mapped file) into a Least Recently Used cache of the loaded Database,
+       * see Database::getCloudCache() for its hit and miss counters.
+       */
+      inline void
+      setLazyClouds (const size_t budget)
+      {
+        cloud_budget_ = budget;
+      }
+
+      /**\brief Get the time spent in each phase of the last load.
+       * \return Timings of the last load, in milliseconds
+       */
+      inline LoadTimings
+      getLoadTimings () const
+      {
+        return (timings_);
+      }
   };
 
   /**\brief Writes(saves) a Database to disk.
@@ -143,6 +213,32 @@ namespace pel
        */
       bool
       save (boost::filesystem::path path, const Database& db, bool overwrite=false);
+
+      /**\brief Save a Database to disk into a single binary file, suitable to be memory mapped by DatabaseReader.
+       * \param[in] path Path of the file to write.
+       * \parma[in] db Database to save.
+       * \param[in] overwrite if _True_ an existing file is overwritten, if _False_ operation will fail if path exists.
+       * \return _True_ if operation is succesful, _False_ otherwise.
+       *
+       * The file contains 64 bytes aligned sections: histogram matrices, cluster offsets, pose names, clouds and
+       * serialized FLANN indices, described by a versioned header.
+       */
+      bool
+      saveSingleFile (boost::filesystem::path path, const Database& db, bool overwrite=false);
+
+      /**\brief Update a Database previously saved to disk with save(), writing only what changed.
+       * \param[in] path Path to the location on disk of the saved database.
+       * \parma[in] db Database to save, usually the one loaded from path with poses added or removed.
+       * \return _True_ if operation is succesful, _False_ otherwise.
+       *
+       * Poses are matched by name and saved histograms: clouds of poses not yet on disk, or whose histograms
+       * differ from the saved ones (e.g. removed and added again under the same name), are written, clouds of
+       * poses no longer in db are deleted, all other clouds are left untouched. Lists, histograms and indices
+       * are rewritten.
+       * \note See Database::addPoses() and Database::removePoses().
+       */
+      bool
+      update (boost::filesystem::path path, const Database& db);
   };
 }
 #endif //PEL_DATABASE_DATABASE_IO_H_
@@ -0,0 +1,109 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *   Pose Estimation Library (PEL) - https://bitbucket.org/Tabjones/pose-estimation-library
+ *   Copyright (c) 2014-2015, Federico Spinelli (fspinelli@gmail.com)
+ *   All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder(s) nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PEL_DATABASE_SEARCH_TREE_CACHE_H_
+#define PEL_DATABASE_SEARCH_TREE_CACHE_H_
+
+#include <pel/common.h>
+#include <pcl/search/kdtree.h>
+#include <boost/shared_ptr.hpp>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+namespace pel
+{
+  /**\brief Keeps search trees built over pose clouds of a Database, so they are built only once.
+   *
+   * Trees are built on first request of a cloud and kept in a Least Recently Used cache, within a budget of bytes
+   * (trees keep their clouds alive, so clouds are accounted too). Database clouds are immutable, thus a tree is
+   * identified by the cloud it was built on.
+   * Returned trees are never modified by the cache and can be searched concurrently.
+   * \note All methods are thread safe, trees are built outside of the lock.
+   * \author Federico Spinelli
+   */
+  class SearchTreeCache
+  {
+    public:
+      ///Search tree over a pose cloud
+      typedef pcl::search::KdTree<Pt> Tree;
+
+      /**\brief Constructor
+       * \param[in] budget Maximum number of bytes of trees (and their clouds) kept, 0 means no limit
+       */
+      SearchTreeCache (const size_t budget = 0);
+
+      /**\brief Get the search tree over a cloud, building it if it is not cached.
+       * \param[in] cloud Cloud to search, it must not be modified afterwards
+       * \return Shared pointer to the tree, whose input cloud is cloud
+       */
+      Tree::Ptr
+      get (const PtC::ConstPtr& cloud);
+
+      ///\brief Drop all trees, counters are kept
+      void
+      clear ();
+
+      ///\brief Maximum number of bytes of trees kept, 0 means no limit
+      inline size_t
+      getBudget () const
+      {
+        return (budget_);
+      }
+      ///\brief Number of bytes of trees currently kept (estimated)
+      size_t
+      getResidentBytes () const;
+      ///\brief Number of requests served by cached trees
+      size_t
+      getHits () const;
+      ///\brief Number of requests that had to build the tree
+      size_t
+      getMisses () const;
+
+    private:
+      ///Cached tree, and its position in the LRU list
+      struct Entry
+      {
+        Tree::Ptr tree;
+        std::list<const PtC*>::iterator lru;
+        size_t bytes;
+      };
+      size_t budget_;
+      std::unordered_map<const PtC*, Entry> trees_;
+      ///Clouds with a cached tree, most recently used first
+      std::list<const PtC*> lru_;
+      size_t resident_bytes_, hits_, misses_;
+      mutable std::mutex mutex_;
+  };
+}
+#endif //PEL_DATABASE_SEARCH_TREE_CACHE_H_
@@ -0,0 +1,109 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *   Pose Estimation Library (PEL) - https://bitbucket.org/Tabjones/pose-estimation-library
+ *   Copyright (c) 2014-2015, Federico Spinelli (fspinelli@gmail.com)
+ *   All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder(s) nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PEL_DATABASE_VOXEL_PYRAMID_CACHE_H_
+#define PEL_DATABASE_VOXEL_PYRAMID_CACHE_H_
+
+#include <pel/common.h>
+#include <boost/shared_ptr.hpp>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace pel
+{
+  /**\brief Keeps voxel pyramids built over pose clouds of a Database, so they are built only once.
+   *
+   * Level 0 of a pyramid is the cloud itself, level _l_ is level _l-1_ downsampled with a Voxel Grid of leaf
+   * size leaf*2^(l-1). Levels are built on first request and kept in a Least Recently Used cache, within a budget
+   * of bytes. Like SearchTreeCache a pyramid is identified by the cloud it was built on, which it keeps alive.
+   * Returned clouds are never modified, thus their search trees can be cached as well.
+   * \note All methods are thread safe, levels are built outside of the lock.
+   * \author Federico Spinelli
+   */
+  class VoxelPyramidCache
+  {
+    public:
+      /**\brief Constructor
+       * \param[in] leaf Leaf size of the Voxel Grid building level 1, a value of 1 means one meter
+       * \param[in] budget Maximum number of bytes of coarse levels (and their clouds) kept, 0 means no limit
+       */
+      VoxelPyramidCache (const float leaf, const size_t budget = 0);
+
+      /**\brief Get a level of the pyramid over a cloud, building it if it is not cached.
+       * \param[in] cloud Cloud at level 0, it must not be modified afterwards
+       * \param[in] level Level to get, 0 returns cloud itself
+       * \return Shared pointer to the (immutable) downsampled cloud
+       */
+      PtC::ConstPtr
+      get (const PtC::ConstPtr& cloud, const unsigned int level);
+
+      ///\brief Drop all pyramids
+      void
+      clear ();
+
+      ///\brief Leaf size of level 1
+      inline float
+      getLeafSize () const
+      {
+        return (leaf_);
+      }
+      ///\brief Maximum number of bytes of pyramids kept, 0 means no limit
+      inline size_t
+      getBudget () const
+      {
+        return (budget_);
+      }
+      ///\brief Number of bytes of pyramids currently kept (estimated)
+      size_t
+      getResidentBytes () const;
+
+    private:
+      ///Cached levels of a cloud (level 0 included), and its position in the LRU list
+      struct Entry
+      {
+        std::vector<PtC::ConstPtr> levels;
+        std::list<const PtC*>::iterator lru;
+        size_t bytes;
+      };
+      float leaf_;
+      size_t budget_;
+      std::unordered_map<const PtC*, Entry> pyramids_;
+      ///Clouds with a cached pyramid, most recently used first
+      std::list<const PtC*> lru_;
+      size_t resident_bytes_;
+      mutable std::mutex mutex_;
+  };
+}
+#endif //PEL_DATABASE_VOXEL_PYRAMID_CACHE_H_
@@ -0,0 +1,97 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *   Pose Estimation Library (PEL) - https://bitbucket.org/Tabjones/pose-estimation-library
+ *   Copyright (c) 2014-2015, Federico Spinelli (fspinelli@gmail.com)
+ *   All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder(s) nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PEL_FEATURES_SEEDED_ESF_ESTIMATION_H_
+#define PEL_FEATURES_SEEDED_ESF_ESTIMATION_H_
+
+#include <pel/common.h>
+#include <pcl/features/esf.h>
+
+namespace pel
+{
+  /**\brief ESF estimation that samples points with its own seeded generator, instead of libc rand().
+   *
+   * pcl::ESFEstimation draws its 20000 point triplets from the process wide rand() state, so concurrent estimations
+   * interleave their draws and results depend on thread scheduling. This estimation computes the same descriptor
+   * (same voxel grid, line tracing and histograms) but draws from a std::mt19937 owned by the instance and seeded
+   * at every compute(): the ESF of a cloud depends only on the cloud and the seed, and rand() is never touched.
+   * \note Database poses and Targets use the same default seed, so their histograms are sampled alike.
+   * \author Federico Spinelli
+   */
+  class SeededESFEstimation : public pcl::ESFEstimation<Pt, pcl::ESFSignature640>
+  {
+    public:
+      typedef boost::shared_ptr<SeededESFEstimation> Ptr;
+      typedef boost::shared_ptr<const SeededESFEstimation> ConstPtr;
+
+      /**\brief Constructor
+       * \param[in] seed Seed of the generator, used again at every compute()
+       */
+      SeededESFEstimation (const unsigned int seed = 0) : seed_(seed)
+      {
+        feature_name_ = "SeededESFEstimation";
+      }
+      virtual ~SeededESFEstimation () {}
+
+      ///\brief Set the seed of the generator, used again at every compute()
+      inline void
+      setSeed (const unsigned int seed)
+      {
+        seed_ = seed;
+      }
+      ///\brief Get the seed of the generator
+      inline unsigned int
+      getSeed () const
+      {
+        return (seed_);
+      }
+
+    protected:
+      ///Seed of the generator
+      unsigned int seed_;
+
+      /**\brief Scale the input surface into the voxel grid, voxelize it and compute its ESF
+       * \param[out] output Cloud with the single ESF signature
+       */
+      virtual void
+      computeFeature (PointCloudOut& output);
+      /**\brief Sample point triplets of a voxelized cloud and build the ESF histogram, like
+       * pcl::ESFEstimation::computeESF() but with a seeded generator
+       * \param[in] pc Cloud scaled into the voxel grid, already voxelized
+       * \param[out] hist ESF histogram, 640 bins
+       */
+      void
+      computeSeededESF (PointCloudIn& pc, std::vector<float>& hist);
+  };
+}
+#endif //PEL_FEATURES_SEEDED_ESF_ESTIMATION_H_
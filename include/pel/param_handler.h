@@ -65,12 +65,45 @@ namespace pel
       virtual inline parameters
       getAllParams () const =0;
   };
+  /**\brief Typed snapshot of parameters, published by ParamHandler::commit().
+   *
+   * Each field is named after its key (see \ref params "Parameters section of User Guide page") and holds its value
+   * as validated by commit(). Flags are _true_ when their key is greater than zero.
+   * Code that runs per point, per Candidate or per pose reads these fields instead of looking keys up by name.
+   */
+  struct Config
+  {
+    int verbosity;
+    bool use_vfh, use_esf, use_cvfh, use_ourcvfh;
+    bool filter;
+    int filter_mean_k;
+    float filter_std_dev_mul_thresh;
+    bool upsamp;
+    int upsamp_poly_order, upsamp_point_density;
+    bool upsamp_poly_fit;
+    float upsamp_search_radius;
+    bool downsamp;
+    float downsamp_leaf_size;
+    int lists_size;
+    float normals_radius_search;
+    float cvfh_ang_thresh, cvfh_curv_thresh, cvfh_clus_tol;
+    int cvfh_clus_min_points;
+    float ourcvfh_ang_thresh, ourcvfh_curv_thresh, ourcvfh_clus_tol;
+    int ourcvfh_clus_min_points;
+    float ourcvfh_axis_ratio, ourcvfh_min_axis_value, ourcvfh_refine_clusters;
+    bool cascade;
+    int cascade_top;
+    float cascade_agreement, cascade_margin;
+  };
+
   /**\brief Class for parameters handling.
    *
    * Parameters contain key:value pairs to configure various aspects
    * of Pose Estimation and Database creation. Such as radiuses of descriptors or thresholds.
    * A list of valid keys with their default values are supplied in the \ref params "Parameters section of User Guide page" or the config file supplied with PEL.
    * \note Even if not pure virtual the class cannot be used directly, but only inherithed.
+   * \note Setting parameters only changes the key=value map (what getParam() returns), derived classes read the
+   * typed Config published by commit(). Pose estimation and Database creation commit pending changes when they start.
    */
   class ParamHandler : public ParamHandlerBase
   {
@@ -81,6 +114,17 @@ namespace pel
       parameters params_;
       ///How many valid parameters are there
       int size_of_valid_params_;
+      ///Parameters as of last commit(), read by derived classes
+      Config config_;
+      ///Whether parameters were set after last commit()
+      bool pending_;
+      ///\brief Commit parameters if any was set after last commit()
+      inline void
+      applyPendingParams ()
+      {
+        if (pending_)
+          commit();
+      }
       ///\brief Set a param from a string value converting it to float. Used internally to read from file.
       bool
       setParam (const std::string key, const std::string value);
@@ -104,6 +148,22 @@ namespace pel
       virtual bool
       setParam (const std::string key, const float value);
 
+      /**\brief Validate current parameters (fixing wrong values) and publish them as the Config in use.
+       *
+       * Changes made with setParam(), loadParamsFromFile() or setParamsFromMap() take effect from here on.
+       */
+      void
+      commit ();
+
+      /**\brief Get the parameters in use, as of last commit()
+       * \return Typed snapshot of parameters
+       */
+      inline const Config&
+      getConfig () const
+      {
+        return (config_);
+      }
+
       /**\brief Load a set of parameters from a configuration file
        * \param[in] config_file File containing parameters in yaml format
        * \returns The number of parameters set correctly, or (-1) in case of errors.
@@ -85,6 +85,18 @@ namespace pel
         pcl::registration::TransformationEstimationDualQuaternion<Pt,Pt,float>::Ptr te_dq_;
         pcl::registration::TransformationEstimationLM<Pt,Pt,float>::Ptr te_lm_;
         pcl::registration::TransformationEstimationSVD<Pt,Pt,float>::Ptr te_svd_;
+        PointToPlaneEstimation::Ptr te_ptp_;
+        ///Transformation estimation method currently set on icp_
+        TransformationType te_type_;
+        ///Number of threads requested for alignment, 0 means automatic
+        unsigned int threads_;
+
+        /**\brief Create one ICP per worker thread, configured like icp_ and with its own transformation estimation.
+         * \param[out] workers Vector of ICP objects, one for each thread
+         * \param[in] size How many workers to create
+         */
+        void
+        initWorkers (std::vector<PoseICP::Ptr>& workers, const int size) const;
       public:
         PEBruteForce ();
         virtual ~PEBruteForce () {}
@@ -132,6 +144,7 @@ namespace pel
         setUseDQ()
         {
           icp_.setTransformationEstimation(te_dq_);
+          te_type_ = TransformationType::dq;
         }
         /**\brief Set transformation estimation for ICP to Levenberg Marquardt method.
          * Default is to use Dual Quaternion Method
@@ -140,6 +153,7 @@ namespace pel
         setUseLM()
         {
           icp_.setTransformationEstimation(te_lm_);
+          te_type_ = TransformationType::lm;
         }
         /**\brief Set transformation estimation for ICP to SVD-based method.
          * Default is to use Dual Quaternion Method
@@ -148,6 +162,34 @@ namespace pel
         setUseSVD()
         {
           icp_.setTransformationEstimation(te_svd_);
+          te_type_ = TransformationType::svd;
+        }
+        /**\brief Set transformation estimation for ICP to point to plane method, using Target normals.
+         * Default is to use Dual Quaternion Method
+         *
+         * Normals already estimated on the Target for VFH/CVFH/OURCVFH are reused (they are computed if no
+         * feature needed them). Point to plane usually converges in a handful of iterations, so the number of
+         * ICP iterations can be lowered accordingly.
+         */
+        virtual inline void
+        setUsePointToPlane()
+        {
+          icp_.setTransformationEstimation(te_ptp_);
+          te_type_ = TransformationType::point_to_plane;
+        }
+        /**\brief Set how many threads to use to align Candidates concurrently.
+         * \param[in] nr_threads Number of threads to use, 0 means automatic (one per available core).
+         *
+         * Each thread aligns a different Candidate, taken in rank order from the composite list. When a Candidate
+         * converges, all the threads aligning worse ranked Candidates are cancelled, while better ranked ones keep going.
+         * The final Pose Estimation is always the best ranked Candidate that converged, regardless of the number of threads:
+         * cancellation is checked after every ICP iteration and never restarts an alignment.
+         * \note Default is 1, i.e. sequential Brute Force. Has no effect if PEL is built without OpenMP.
+         */
+        virtual inline void
+        setNumberOfThreads (const unsigned int nr_threads = 0)
+        {
+          threads_ = nr_threads;
         }
     };
   }
@@ -92,6 +92,58 @@ namespace pel
         pcl::registration::TransformationEstimationDualQuaternion<Pt,Pt,float>::Ptr te_dq_;
         pcl::registration::TransformationEstimationLM<Pt,Pt,float>::Ptr te_lm_;
         pcl::registration::TransformationEstimationSVD<Pt,Pt,float>::Ptr te_svd_;
+        PointToPlaneEstimation::Ptr te_ptp_;
+        ///Transformation estimation method currently set on icp_
+        TransformationType te_type_;
+        ///Number of threads requested for alignment, 0 means automatic
+        unsigned int threads_;
+        ///Number of coarse levels of voxel pyramids, 0 means always align at full resolution
+        unsigned int pyramid_levels_;
+        ///Leaf size of the first coarse level of voxel pyramids
+        float pyramid_leaf_;
+        ///Pyramid level of each step, empty means one level less at each step
+        std::vector<unsigned int> pyramid_schedule_;
+        ///Levels of the Target voxel pyramid, level 0 is the processed Target, built once per Target
+        std::vector<PtC::ConstPtr> target_levels_;
+        ///Search trees over target_levels_
+        std::vector<SearchTreeCache::Tree::Ptr> target_level_trees_;
+        ///Normals of target_levels_, set only for point to plane estimation
+        std::vector<PointToPlaneEstimation::Normals::ConstPtr> target_level_normals_;
+        ///Leaf size target_levels_ were built with
+        float target_levels_leaf_;
+
+        /**\brief Get the pyramid level used at a step of Progressive Bisection
+         * \param[in] step Step number, starting from 0
+         * \return Level of voxel pyramids, 0 means full resolution
+         */
+        unsigned int
+        getStepLevel (const int step) const;
+        /**\brief Make all workers align over a level of the Target voxel pyramid
+         * \param[in,out] workers ICP objects to set
+         * \param[in] target_levels Levels of the Target pyramid
+         * \param[in] target_trees Search trees over target_levels
+         * \param[in] level_normals Normals of target_levels, used only by point to plane estimation
+         * \param[in] level Level to set
+         */
+        void
+        setWorkersLevel (std::vector<PoseICP::Ptr>& workers,
+            const std::vector<PtC::ConstPtr>& target_levels, const std::vector<SearchTreeCache::Tree::Ptr>& target_trees,
+            const std::vector<PointToPlaneEstimation::Normals::ConstPtr>& level_normals, const unsigned int level) const;
+
+        /**\brief Create one ICP per worker thread, configured like icp_ and with its own transformation estimation.
+         * \param[out] workers Vector of ICP objects, one for each thread
+         * \param[in] size How many workers to create
+         */
+        void
+        initWorkers (std::vector<PoseICP::Ptr>& workers, const int size) const;
+        ///\brief Initialize a Target and build its voxel pyramid
+        virtual bool
+        initTarget ();
+        /**\brief Build the coarse levels of the Target voxel pyramid, with their search trees and, for point to
+         * plane estimation, their normals. Time spent is stored in stats_.pyramid.
+         */
+        void
+        buildTargetPyramid ();
       public:
         PEProgressiveBisection ();
         virtual ~PEProgressiveBisection () {}
@@ -139,6 +191,7 @@ namespace pel
         setUseDQ()
         {
           icp_.setTransformationEstimation(te_dq_);
+          te_type_ = TransformationType::dq;
         }
         /**\brief Set transformation estimation for ICP to Levenberg Marquardt method.
          * Default is to use Dual Quaternion Method
@@ -147,6 +200,7 @@ namespace pel
         setUseLM()
         {
           icp_.setTransformationEstimation(te_lm_);
+          te_type_ = TransformationType::lm;
         }
         /**\brief Set transformation estimation for ICP to SVD-based method.
          * Default is to use Dual Quaternion Method
@@ -155,6 +209,20 @@ namespace pel
         setUseSVD()
         {
           icp_.setTransformationEstimation(te_svd_);
+          te_type_ = TransformationType::svd;
+        }
+        /**\brief Set transformation estimation for ICP to point to plane method, using Target normals.
+         * Default is to use Dual Quaternion Method
+         *
+         * Normals already estimated on the Target for VFH/CVFH/OURCVFH are reused (they are computed if no
+         * feature needed them). Point to plane usually converges in a handful of iterations, so the number of
+         * ICP iterations can be lowered accordingly.
+         */
+        virtual inline void
+        setUsePointToPlane()
+        {
+          icp_.setTransformationEstimation(te_ptp_);
+          te_type_ = TransformationType::point_to_plane;
         }
         /**\brief Set how much of the list is kept during bisection
          *\param[in] fraction Fraction of the list to keep on each bisection step.
@@ -178,6 +246,48 @@ namespace pel
         {
           success_on_size_one_ = success;
         }
+        /**\brief Set how many threads to use when aligning Candidates on each step of Progressive Bisection.
+         * \param[in] nr_threads Number of threads to use, 0 means automatic (one per available core).
+         *
+         * Each step aligns all the surviving Candidates concurrently, every thread owns its own ICP and
+         * transformation estimation. Candidates are resorted only after all of them are aligned, so the outcome
+         * does not depend on the number of threads used.
+         * \note Default is 1, i.e. sequential alignment. Has no effect if PEL is built without OpenMP.
+         */
+        virtual inline void
+        setNumberOfThreads (const unsigned int nr_threads = 0)
+        {
+          threads_ = nr_threads;
+        }
+        /**\brief Align Candidates coarse to fine, over voxel pyramids of Candidates and Target.
+         * \param[in] levels Number of coarse levels above full resolution, 0 disables pyramids (default)
+         * \param[in] leaf Leaf size of the first coarse level, each further level doubles it. A value of 1 means one meter.
+         *
+         * Early steps only rank Candidates, so they align downsampled clouds; only the Candidates surviving
+         * them are aligned at full resolution and the RMSE threshold is checked only there. Pyramids of Database
+         * poses are built once, on their first use, and shared by copies of the Database. The Target pyramid is
+         * built once by setTarget(), call this before it to avoid building it again in estimate().
+         * \note See setPyramidSchedule() to choose which level each step uses.
+         */
+        virtual inline void
+        setPyramid (const unsigned int levels = 2, const float leaf = 0.01)
+        {
+          pyramid_levels_ = levels;
+          if (leaf > 0)
+            pyramid_leaf_ = leaf;
+        }
+        /**\brief Set which pyramid level each step of Progressive Bisection uses.
+         * \param[in] schedule Level used by each step, the first element is the first step. Steps after the last
+         * element use full resolution (level 0), levels above the ones set with setPyramid() are clamped.
+         *
+         * By default (empty schedule) the first step uses the coarsest level and each following step uses one
+         * level less, down to full resolution.
+         */
+        virtual inline void
+        setPyramidSchedule (const std::vector<unsigned int>& schedule = std::vector<unsigned int>())
+        {
+          pyramid_schedule_ = schedule;
+        }
     };
   }
 }
@@ -0,0 +1,172 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *   Pose Estimation Library (PEL) - https://bitbucket.org/Tabjones/pose-estimation-library
+ *   Copyright (c) 2014-2015, Federico Spinelli (fspinelli@gmail.com)
+ *   All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder(s) nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PEL_PIPELINE_STATS_H_
+#define PEL_PIPELINE_STATS_H_
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace pel
+{
+  ///Time spent (ms) in each step of the last Target initialization
+  struct TargetInitTimings
+  {
+    TargetInitTimings () : filter(0), upsampling(0), downsampling(0), tree(0), esf(0), normals(0),
+      vfh(0), cvfh(0), ourcvfh(0), composite(0), total(0) {}
+    ///Outliers removal (or plain copy if disabled)
+    double filter;
+    ///MLS upsampling
+    double upsampling;
+    ///VoxelGrid downsampling
+    double downsampling;
+    ///Construction of the target search tree
+    double tree;
+    ///ESF estimation, including its list of Candidates when retrieval is pipelined
+    double esf;
+    ///Normal estimation, including the one the cascade or point to plane ICP may need later
+    double normals;
+    ///VFH estimation, including its list of Candidates when retrieval is pipelined
+    double vfh;
+    ///CVFH estimation, including its list of Candidates when retrieval is pipelined or its late estimation by the cascade
+    double cvfh;
+    ///OURCVFH estimation, including its list of Candidates when retrieval is pipelined or its late estimation by the cascade
+    double ourcvfh;
+    ///Fusion of the composite list when retrieval is pipelined
+    double composite;
+    ///Wall time of the whole initialization, tasks may overlap so this can be less than their sum
+    double total;
+  };
+
+  /**\brief Timings and counters of the last Target initialization and Pose Estimation.
+   *
+   * Filled by PoseEstimationBase::setTarget() and by the estimate() of every estimator, see
+   * PoseEstimationBase::getPipelineStats(). Times are in milliseconds.
+   * \author Federico Spinelli
+   */
+  struct PipelineStats
+  {
+    ///Number of points of the Target after each preprocessing step, a disabled step keeps the previous count
+    struct TargetPoints
+    {
+      TargetPoints () : input(0), filter(0), upsampling(0), downsampling(0) {}
+      ///Target as set by the user
+      size_t input;
+      ///After outliers removal
+      size_t filter;
+      ///After MLS upsampling
+      size_t upsampling;
+      ///After VoxelGrid downsampling, this is the processed Target used by features and ICP
+      size_t downsampling;
+    };
+    ///Time spent generating each list of Candidates by the last generateLists, reset at each call
+    struct ListTimings
+    {
+      ListTimings () : vfh(0), esf(0), cvfh(0), ourcvfh(0), composite(0), total(0), cascade_exit(false) {}
+      ///Database query of each feature
+      double vfh;
+      double esf;
+      double cvfh;
+      double ourcvfh;
+      ///Fusion of the composite list
+      double composite;
+      ///Wall time of generateLists, zero when lists were already generated during Target initialization
+      double total;
+      ///Whether the cascade stopped before CVFH and OURCVFH
+      bool cascade_exit;
+    };
+    ///One round of ICP over the surviving Candidates
+    struct ICPStep
+    {
+      ICPStep () : level(0), candidates(0), time(0) {}
+      ///Pyramid level ICP aligned over, 0 is full resolution
+      unsigned int level;
+      ///Number of Candidates aligned
+      size_t candidates;
+      ///Wall time of the step
+      double time;
+    };
+    ///ICP alignment of one Candidate during one step
+    struct CandidateICP
+    {
+      CandidateICP () : step(0), level(0), iterations(0), rmse(0), time(0), cancelled(false) {}
+      ///Name of the Candidate
+      std::string name;
+      ///Index of the step in icp_steps
+      unsigned int step;
+      ///Pyramid level ICP aligned over
+      unsigned int level;
+      ///ICP iterations performed
+      int iterations;
+      ///RMSE after the alignment, NaN (null in JSON) if it was cancelled
+      float rmse;
+      ///Time spent aligning
+      double time;
+      ///Whether the alignment was stopped because a better ranked Candidate converged
+      bool cancelled;
+    };
+
+    PipelineStats () : pyramid(0), estimation(0), success(false) {}
+
+    ///Reset everything filled by estimate(), Target statistics are kept
+    void
+    clearEstimation ();
+
+    /**\brief Export statistics as a JSON object
+     * \return A string holding the JSON object, on a single line
+     */
+    std::string
+    toJSON () const;
+
+    ///Name of the Target
+    std::string target_name;
+    ///Target initialization timings
+    TargetInitTimings target;
+    ///Target points after each preprocessing step
+    TargetPoints points;
+    ///Lists generation timings
+    ListTimings lists;
+    ///Construction of the Target pyramid used by coarse ICP steps, done once per Target (again by estimate only if pyramid parameters changed)
+    double pyramid;
+    ///ICP steps performed by last estimate, in order
+    std::vector<ICPStep> icp_steps;
+    ///ICP alignments performed by last estimate, grouped by step
+    std::vector<CandidateICP> icp;
+    ///Wall time of last estimate, lists generation included
+    double estimation;
+    ///Whether last estimate found a Candidate
+    bool success;
+  };
+}
+#endif //PEL_PIPELINE_STATS_H_
@@ -38,6 +38,11 @@
 #include <pel/param_handler.h>
 #include <pel/candidates/target.h>
 #include <pel/candidates/candidate_list.h>
+#include <pel/registration/pose_correspondence_estimation.h>
+#include <pel/registration/point_to_plane_estimation.h>
+#include <pel/registration/pose_icp.h>
+#include <pel/features/seeded_esf_estimation.h>
+#include <pel/pipeline_stats.h>
 #include <cmath>
 #include <stdexcept>
 #include <pcl/common/norms.h>
@@ -48,7 +53,6 @@
 #include <pcl/features/normal_3d_omp.h>
 #include <pcl/filters/statistical_outlier_removal.h>
 #include <pcl/features/vfh.h>
-#include <pcl/features/esf.h>
 #include <pcl/features/cvfh.h>
 #include <pcl/features/our_cvfh.h>
 #include <pcl/filters/voxel_grid.h>
@@ -68,7 +72,11 @@ namespace pel
   class PoseEstimationBase : public ParamHandler, public Database, public CandidateLists, public Target
   {
     public:
-      PoseEstimationBase () : feature_count_(0)
+      ///Time spent (ms) in each step of the last Target initialization
+      typedef pel::TargetInitTimings TargetInitTimings;
+      PoseEstimationBase () : feature_count_(0), init_threads_(1), lists_ready_(false),
+        lists_poses_(0), lists_removed_(0), deferred_features_(false), cascade_exit_(false),
+        concurrent_init_(false)
       {
         target_cloud.reset(new PtC);
         target_cloud_processed.reset(new PtC);
@@ -77,12 +85,54 @@ namespace pel
     protected:
       ///Internal counter used to count how many feature the class uses
       int feature_count_;
+      ///Number of concurrent tasks used to initialize a Target, 0 means automatic
+      unsigned int init_threads_;
+      ///Timings and counters of the last Target initialization and estimation
+      PipelineStats stats_;
+      ///Whether Candidate lists were already generated while initializing the current Target
+      bool lists_ready_;
+      ///Parameters, Database size and removed poses the pipelined lists were generated with
+      Config lists_config_;
+      size_t lists_poses_;
+      size_t lists_removed_;
+      ///Whether CVFH and OURCVFH of current Target are left to generateLists by the cascade
+      bool deferred_features_;
+      ///Whether last generateLists stopped the cascade before CVFH and OURCVFH
+      bool cascade_exit_;
+      ///Whether Target features are being computed concurrently by initTarget
+      bool concurrent_init_;
+
+      ///\brief Whether single steps are reported: at verbosity > 1, unless they run concurrently with others
+      inline bool
+      reportSteps () const
+      {
+        return (config_.verbosity > 1 && !concurrent_init_);
+      }
 
       /**\brief Generate Lists of Candidates based on distance from target
        *\returns _True_ if succesful, _False_ otherwise
        */
       virtual bool
       generateLists();
+      /**\brief Generate the list of Candidates of a single feature, whose descriptor must be already computed
+       * \param[in] type Feature to generate the list of, composite is not valid here
+       * \param[in] k Size of the list
+       * \return _True_ if succesful, _False_ otherwise
+       */
+      bool
+      generateList (ListType type, const int k);
+      /**\brief Fuse the lists of the enabled features into the composite list
+       * \param[in] k Size of the composite list
+       */
+      void
+      generateCompositeList (const int k);
+      /**\brief Cascade test on lists of the cheap global features (VFH and ESF)
+       * \param[in] k Size of the lists
+       * \return _True_ if VFH and ESF lists agree on their first cascade_top Candidates and the best one of the
+       * composite list leads the second one by at least cascade_margin, _False_ otherwise
+       */
+      bool
+      isUnambiguous (const int k) const;
       ///\brief Initialize a Target for PoseEstimation
       virtual bool
       initTarget ();
@@ -101,6 +151,9 @@ namespace pel
       ///\brief computeNormals features of target
       virtual void
       computeNormals ();
+      ///\brief Compute normals of target if its initialization did not need them (only ESF, or deferred by cascade)
+      void
+      computeMissingNormals ();
       ///\brief removeOutliers by applying Statistical Outliers Filter
       virtual void
       removeOutliers ();
@@ -110,6 +163,22 @@ namespace pel
       ///\brief applyUpsampling With MLS with Random uniform sampling
       virtual void
       applyUpsampling ();
+      /**\brief Compute the initial guess of ICP for a Candidate
+       * \param[in] c Candidate to align, its pose id selects the precomputed sensor frame in Database
+       * \param[in] target_centroid Centroid of the processed target
+       * \return Transformation from Candidate local frame to sensor frame, translated so that the Candidate
+       * centroid lies over the target centroid
+       */
+      Eigen::Matrix4f
+      computeInitialGuess (const Candidate& c, const Eigen::Vector3f& target_centroid) const;
+      /**\brief Set a Candidate as source of an ICP, reusing the search tree of its Database pose
+       * \param[in,out] icp ICP to set, it should use a PoseCorrespondenceEstimation to make use of the tree
+       * \param[in] c Candidate to align
+       * \param[in] level Level of the voxel pyramid of the pose to use as source, 0 is the Candidate cloud
+       * (see Database::getDatabasePyramidCloud())
+       */
+      void
+      setICPSource (pcl::IterativeClosestPoint<Pt, Pt, float>& icp, const Candidate& c, const unsigned int level = 0) const;
       ///Estimate prototype
       virtual void
       estimate (Candidate& estimation)=0;
@@ -138,6 +207,43 @@ namespace pel
        * \param[in] other Database to move from
        */
       PoseEstimationBase& operator= (Database&& other);
+      /**\brief Set the number of concurrent tasks used to initialize a Target.
+       * \param[in] nr_threads Number of threads, 0 means automatic, 1 disables concurrency (default)
+       *
+       * With more than one thread ESF is computed while normals are estimated, then VFH, CVFH and OURCVFH
+       * run concurrently on the same normals. If a Database is already set, each feature also generates its
+       * list of Candidates as soon as its descriptor is ready, so that retrieval is hidden behind the
+       * remaining descriptors and the following generateLists() finds them already built.
+       */
+      inline void
+      setTargetInitThreads (const unsigned int nr_threads = 0)
+      {
+        init_threads_ = nr_threads;
+      }
+      /**\brief Get the time spent in each step of the last Target initialization.
+       * \return Timings of the last initialization, in milliseconds
+       */
+      inline TargetInitTimings
+      getTargetInitTimings () const
+      {
+        return (stats_.target);
+      }
+      /**\brief Get timings and counters of the last Target initialization and Pose Estimation.
+       * \return Statistics of the last setTarget() and estimate(), see PipelineStats::toJSON() to export them
+       */
+      inline const PipelineStats&
+      getPipelineStats () const
+      {
+        return (stats_);
+      }
+      /**\brief Tell whether the last lists generation exited the cascade early.
+       * \return _True_ if CVFH and OURCVFH were skipped because VFH and ESF lists were unambiguous
+       */
+      inline bool
+      getCascadeExit () const
+      {
+        return (cascade_exit_);
+      }
   };
 }
 #endif //PEL_POSE_ESTIMATION_BASE_H_
@@ -0,0 +1,113 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *   Pose Estimation Library (PEL) - https://bitbucket.org/Tabjones/pose-estimation-library
+ *   Copyright (c) 2014-2015, Federico Spinelli (fspinelli@gmail.com)
+ *   All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder(s) nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PEL_REGISTRATION_POINT_TO_PLANE_ESTIMATION_H_
+#define PEL_REGISTRATION_POINT_TO_PLANE_ESTIMATION_H_
+
+#include <pel/common.h>
+#include <pcl/registration/transformation_estimation.h>
+
+namespace pel
+{
+  /**\brief Point to plane transformation estimation for ICP, using normals precomputed on the target cloud.
+   *
+   * Minimizes the distances of source points from the tangent planes of their corresponding target points, with a
+   * linear least squares approximation (small rotations), like pcl::registration::TransformationEstimationPointToPlaneLLS.
+   * Unlike PCL this does not require a point type with normals: they are taken from a separate cloud indexed like
+   * the target, for example the normals computed on the processed Target by PoseEstimationBase.
+   * Correspondences whose target normal is not finite are ignored, if less than six remain a point to point (SVD)
+   * estimation is used instead.
+   * \note Normals are only read, so they can be shared by many instances concurrently.
+   * \author Federico Spinelli
+   */
+  class PointToPlaneEstimation : public pcl::registration::TransformationEstimation<Pt, Pt, float>
+  {
+    public:
+      typedef boost::shared_ptr<PointToPlaneEstimation> Ptr;
+      typedef boost::shared_ptr<const PointToPlaneEstimation> ConstPtr;
+      typedef pcl::PointCloud<pcl::Normal> Normals;
+
+      /**\brief Constructor
+       * \param[in] normals Normals of the target cloud, indexed like it
+       */
+      PointToPlaneEstimation (const Normals::ConstPtr& normals = Normals::ConstPtr ()) : normals_(normals) {}
+      virtual ~PointToPlaneEstimation () {}
+
+      /**\brief Set the normals of the target cloud
+       * \param[in] normals Normals indexed like the target cloud set on ICP
+       */
+      inline void
+      setTargetNormals (const Normals::ConstPtr& normals)
+      {
+        normals_ = normals;
+      }
+      ///\brief Get the normals of the target cloud
+      inline Normals::ConstPtr
+      getTargetNormals () const
+      {
+        return (normals_);
+      }
+
+      ///\brief Estimate the transformation between clouds of the same size, point _i_ corresponds to point _i_
+      virtual void
+      estimateRigidTransformation (const pcl::PointCloud<Pt>& cloud_src, const pcl::PointCloud<Pt>& cloud_tgt,
+          Matrix4& transformation_matrix) const;
+      ///\brief Estimate the transformation, point indices_src[i] of source corresponds to point _i_ of target
+      virtual void
+      estimateRigidTransformation (const pcl::PointCloud<Pt>& cloud_src, const std::vector<int>& indices_src,
+          const pcl::PointCloud<Pt>& cloud_tgt, Matrix4& transformation_matrix) const;
+      ///\brief Estimate the transformation, point indices_src[i] of source corresponds to point indices_tgt[i] of target
+      virtual void
+      estimateRigidTransformation (const pcl::PointCloud<Pt>& cloud_src, const std::vector<int>& indices_src,
+          const pcl::PointCloud<Pt>& cloud_tgt, const std::vector<int>& indices_tgt, Matrix4& transformation_matrix) const;
+      ///\brief Estimate the transformation from correspondences found by ICP
+      virtual void
+      estimateRigidTransformation (const pcl::PointCloud<Pt>& cloud_src, const pcl::PointCloud<Pt>& cloud_tgt,
+          const pcl::Correspondences& correspondences, Matrix4& transformation_matrix) const;
+
+    private:
+      ///Normals of the target cloud
+      Normals::ConstPtr normals_;
+
+      /**\brief Solve the linearized point to plane problem
+       * \param[in] cloud_src Source cloud
+       * \param[in] cloud_tgt Target cloud
+       * \param[in] pairs Corresponding source and target indices
+       * \param[out] transformation_matrix Estimated transformation
+       */
+      void
+      estimate (const pcl::PointCloud<Pt>& cloud_src, const pcl::PointCloud<Pt>& cloud_tgt,
+          const std::vector<std::pair<int, int> >& pairs, Matrix4& transformation_matrix) const;
+  };
+}
+#endif //PEL_REGISTRATION_POINT_TO_PLANE_ESTIMATION_H_
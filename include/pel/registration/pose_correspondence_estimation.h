@@ -0,0 +1,84 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *   Pose Estimation Library (PEL) - https://bitbucket.org/Tabjones/pose-estimation-library
+ *   Copyright (c) 2014-2015, Federico Spinelli (fspinelli@gmail.com)
+ *   All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder(s) nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PEL_REGISTRATION_POSE_CORRESPONDENCE_ESTIMATION_H_
+#define PEL_REGISTRATION_POSE_CORRESPONDENCE_ESTIMATION_H_
+
+#include <pel/common.h>
+#include <pcl/registration/correspondence_estimation.h>
+#include <pcl/search/kdtree.h>
+
+namespace pel
+{
+  /**\brief Correspondence estimation for ICP that reuses a search tree built over the untransformed source cloud.
+   *
+   * ICP moves its source cloud at every iteration, so PCL rebuilds the source search tree used for reciprocal
+   * correspondences each time, unless forced not to, in which case the tree would be stale.
+   * When a tree is set with setSearchMethodSource(tree, true) this class assumes it is built over the original
+   * source cloud (for example a Database pose cloud, see Database::getDatabaseSearchTree()): it recovers the
+   * rigid transformation that ICP applied to the source and queries the tree with target points brought back by
+   * its inverse, which gives the same correspondences without building any tree.
+   * Otherwise it behaves like pcl::registration::CorrespondenceEstimation.
+   * \note The shared tree is only searched, never modified, so it can be used by many instances concurrently.
+   * \author Federico Spinelli
+   */
+  class PoseCorrespondenceEstimation : public pcl::registration::CorrespondenceEstimation<Pt, Pt, float>
+  {
+    public:
+      typedef boost::shared_ptr<PoseCorrespondenceEstimation> Ptr;
+      typedef boost::shared_ptr<const PoseCorrespondenceEstimation> ConstPtr;
+
+      PoseCorrespondenceEstimation ()
+      {
+        corr_name_ = "PoseCorrespondenceEstimation";
+      }
+      virtual ~PoseCorrespondenceEstimation () {}
+
+      /**\brief Determine reciprocal correspondences between source and target
+       * \param[out] correspondences Found correspondences
+       * \param[in] max_distance Maximum allowed distance between corresponding points
+       */
+      virtual void
+      determineReciprocalCorrespondences (pcl::Correspondences& correspondences,
+          double max_distance = std::numeric_limits<double>::max ());
+
+      ///\brief Clone this estimation, search trees are shared with the clone
+      virtual boost::shared_ptr<pcl::registration::CorrespondenceEstimationBase<Pt, Pt, float> >
+      clone () const
+      {
+        Ptr copy (new PoseCorrespondenceEstimation (*this));
+        return (copy);
+      }
+  };
+}
+#endif //PEL_REGISTRATION_POSE_CORRESPONDENCE_ESTIMATION_H_
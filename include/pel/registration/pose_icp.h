@@ -0,0 +1,122 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *   Pose Estimation Library (PEL) - https://bitbucket.org/Tabjones/pose-estimation-library
+ *   Copyright (c) 2014-2015, Federico Spinelli (fspinelli@gmail.com)
+ *   All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder(s) nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PEL_REGISTRATION_POSE_ICP_H_
+#define PEL_REGISTRATION_POSE_ICP_H_
+
+#include <pel/common.h>
+#include <pcl/registration/icp.h>
+#include <pcl/registration/default_convergence_criteria.h>
+#include <boost/function.hpp>
+
+namespace pel
+{
+  /**\brief ICP used by pose estimators, it exposes how many iterations the last alignment performed and can be
+   * cancelled while aligning.
+   *
+   * pcl::IterativeClosestPoint resets its iteration counter at every align() but keeps it protected,
+   * estimators read it to report the ICP effort spent on each Candidate (see PipelineStats).
+   * Cancellation is checked by the convergence criteria after every iteration, so an alignment that is not
+   * cancelled runs exactly like a plain ICP one.
+   * \author Federico Spinelli
+   */
+  class PoseICP : public pcl::IterativeClosestPoint<Pt, Pt, float>
+  {
+    public:
+      typedef boost::shared_ptr<PoseICP> Ptr;
+      typedef boost::shared_ptr<const PoseICP> ConstPtr;
+      ///Function telling if the alignment in progress should stop
+      typedef boost::function<bool ()> CancelCheck;
+
+      PoseICP ()
+      {
+        criteria_.reset (new CancellableConvergenceCriteria (nr_iterations_, transformation_, *correspondences_));
+        convergence_criteria_ = criteria_;
+      }
+      virtual ~PoseICP () {}
+
+      ///\brief Get the number of iterations performed by the last call to align()
+      inline int
+      getNumberOfIterations () const
+      {
+        return (nr_iterations_);
+      }
+      /**\brief Set a check for cancellation, called after every iteration of align()
+       * \param[in] check Function returning _true_ when the alignment should stop, empty to never stop
+       */
+      inline void
+      setCancelCheck (const CancelCheck& check)
+      {
+        criteria_->cancel_ = check;
+      }
+      ///\brief Tell if the last call to align() was stopped by the cancel check
+      inline bool
+      isCancelled () const
+      {
+        return (criteria_->cancelled_);
+      }
+
+    protected:
+      ///Default ICP convergence criteria, which also converge when the cancel check is true
+      struct CancellableConvergenceCriteria : public pcl::registration::DefaultConvergenceCriteria<float>
+      {
+        CancellableConvergenceCriteria (const int& iterations, const Matrix4& transform,
+            const pcl::Correspondences& correspondences) :
+          pcl::registration::DefaultConvergenceCriteria<float> (iterations, transform, correspondences),
+          cancelled_ (false) {}
+
+        virtual bool
+        hasConverged ()
+        {
+          if (cancel_ && cancel_())
+          {
+            cancelled_ = true;
+            return (true);
+          }
+          return (pcl::registration::DefaultConvergenceCriteria<float>::hasConverged());
+        }
+
+        CancelCheck cancel_;
+        bool cancelled_;
+      };
+      boost::shared_ptr<CancellableConvergenceCriteria> criteria_;
+
+      virtual void
+      computeTransformation (PointCloudSource& output, const Matrix4& guess)
+      {
+        criteria_->cancelled_ = false;
+        pcl::IterativeClosestPoint<Pt, Pt, float>::computeTransformation (output, guess);
+      }
+  };
+}
+#endif //PEL_REGISTRATION_POSE_ICP_H_
@@ -33,6 +33,7 @@
 
 #include <pel/candidates/candidate_list.h>
 #include <algorithm>
+#include <unordered_map>
 #include <pcl/console/parse.h>
 
 using namespace pcl::console;
@@ -236,21 +237,39 @@ namespace pel
     else
       return (false);
   }
-  bool
-  CandidateLists::findAndEraseCandidate(std::vector<Candidate>& list, std::string name, float dist)
+  void
+  CandidateLists::fuseLists (const std::vector<const std::vector<Candidate>* >& lists, std::vector<Candidate>& fused) const
   {
-    if (!list.empty())
-    {
-      for (std::vector<Candidate>::iterator it=list.begin(); it!=list.end(); ++it)
+    fused.clear();
+    size_t total (0);
+    for (const auto l: lists)
+      total += l->size();
+    //pose index -> position in fused, one pass per list
+    std::unordered_map<int, size_t> slot;
+    slot.reserve(total);
+    fused.reserve(total);
+    std::vector<float> sum;
+    std::vector<int> found;
+    sum.reserve(total);
+    found.reserve(total);
+    for (const auto l: lists)
+      for (const auto& x: *l)
       {
-        if (name.compare(it->getName()) ==0)
+        auto ins = slot.emplace(x.getPoseId(), fused.size());
+        if (ins.second)
         {
-          dist = it->getNormalizedDistance();
-          list.erase(it);
-          return true;
+          fused.push_back(x);
+          sum.push_back(x.getNormalizedDistance());
+          found.push_back(1);
+        }
+        else
+        {
+          sum[ins.first->second] += x.getNormalizedDistance();
+          ++found[ins.first->second];
         }
       }
-    }
-    return false;
+    const int n = lists.size();
+    for (size_t i=0; i<fused.size(); ++i)
+      fused[i].setNormalizedDistance( (sum[i] + (n - found[i])) / n );
   }
 }
@@ -32,28 +32,234 @@
 */
 
 #include <pel/common.h>
+#include <limits>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+//Compiler can emit per function SIMD code and detect CPU features at runtime
+#define PEL_SIMD_DISPATCH
+#include <immintrin.h>
+#if defined(__clang__) || __GNUC__ >= 7
+#define PEL_SIMD_AVX512
+#endif
+#endif
 
 namespace pel
 {
-  float
-  getMinMaxDistance (float* a, float* b, int size)
+  namespace
   {
-    float num(1.0f), den(1.0f);
-    //Process 4 items with each loop for efficency (since it should be applied to vectors of 308 elements)
-    int i=0;
-    for (; i<(size-3); i+=4)
+    ///Signature of getMinMaxDistance kernels
+    typedef float (*MinMaxKernel)(const float*, const float*, int);
+
+    float
+    minMaxScalar (const float* a, const float* b, int size)
+    {
+      float num(1.0f), den(1.0f);
+      //Process 4 items with each loop for efficency (since it should be applied to vectors of 308 elements)
+      int i=0;
+      for (; i<(size-3); i+=4)
+      {
+        num += std::min(a[i],b[i]) + std::min(a[i+1],b[i+1]) + std::min(a[i+2],b[i+2]) + std::min(a[i+3],b[i+3]);
+        den += std::max(a[i],b[i]) + std::max(a[i+1],b[i+1]) + std::max(a[i+2],b[i+2]) + std::max(a[i+3],b[i+3]);
+      }
+      //process last 0-4 elements (if size!=308)
+      while ( i < size)
+      {
+        num += std::min(a[i],b[i]);
+        den += std::max(a[i],b[i]);
+        ++i;
+      }
+      return (1 - (num/den));
+    }
+
+#ifdef PEL_SIMD_DISPATCH
+    __attribute__((target("sse4.1"))) float
+    minMaxSSE4 (const float* a, const float* b, int size)
+    {
+      __m128 num = _mm_setzero_ps();
+      __m128 den = _mm_setzero_ps();
+      int i=0;
+      for (; i<(size-3); i+=4)
+      {
+        __m128 va = _mm_loadu_ps(a+i);
+        __m128 vb = _mm_loadu_ps(b+i);
+        num = _mm_add_ps(num, _mm_min_ps(va, vb));
+        den = _mm_add_ps(den, _mm_max_ps(va, vb));
+      }
+      //horizontal sums
+      num = _mm_hadd_ps(num, den);
+      num = _mm_hadd_ps(num, num);
+      float n = 1.0f + _mm_cvtss_f32(num);
+      float d = 1.0f + _mm_cvtss_f32(_mm_shuffle_ps(num, num, 1));
+      for (; i<size; ++i)
+      {
+        n += std::min(a[i],b[i]);
+        d += std::max(a[i],b[i]);
+      }
+      return (1 - (n/d));
+    }
+
+    __attribute__((target("avx2"))) float
+    minMaxAVX2 (const float* a, const float* b, int size)
+    {
+      //two accumulators per sum, to hide latency of additions
+      __m256 num0 = _mm256_setzero_ps(), num1 = _mm256_setzero_ps();
+      __m256 den0 = _mm256_setzero_ps(), den1 = _mm256_setzero_ps();
+      int i=0;
+      for (; i<(size-15); i+=16)
+      {
+        __m256 va0 = _mm256_loadu_ps(a+i);
+        __m256 vb0 = _mm256_loadu_ps(b+i);
+        __m256 va1 = _mm256_loadu_ps(a+i+8);
+        __m256 vb1 = _mm256_loadu_ps(b+i+8);
+        num0 = _mm256_add_ps(num0, _mm256_min_ps(va0, vb0));
+        den0 = _mm256_add_ps(den0, _mm256_max_ps(va0, vb0));
+        num1 = _mm256_add_ps(num1, _mm256_min_ps(va1, vb1));
+        den1 = _mm256_add_ps(den1, _mm256_max_ps(va1, vb1));
+      }
+      for (; i<(size-7); i+=8)
+      {
+        __m256 va = _mm256_loadu_ps(a+i);
+        __m256 vb = _mm256_loadu_ps(b+i);
+        num0 = _mm256_add_ps(num0, _mm256_min_ps(va, vb));
+        den0 = _mm256_add_ps(den0, _mm256_max_ps(va, vb));
+      }
+      num0 = _mm256_add_ps(num0, num1);
+      den0 = _mm256_add_ps(den0, den1);
+      //horizontal sums
+      __m128 num = _mm_add_ps(_mm256_castps256_ps128(num0), _mm256_extractf128_ps(num0, 1));
+      __m128 den = _mm_add_ps(_mm256_castps256_ps128(den0), _mm256_extractf128_ps(den0, 1));
+      num = _mm_hadd_ps(num, den);
+      num = _mm_hadd_ps(num, num);
+      float n = 1.0f + _mm_cvtss_f32(num);
+      float d = 1.0f + _mm_cvtss_f32(_mm_shuffle_ps(num, num, 1));
+      for (; i<size; ++i)
+      {
+        n += std::min(a[i],b[i]);
+        d += std::max(a[i],b[i]);
+      }
+      return (1 - (n/d));
+    }
+
+#ifdef PEL_SIMD_AVX512
+    __attribute__((target("avx512f"))) float
+    minMaxAVX512 (const float* a, const float* b, int size)
     {
-      num += std::min(a[i],b[i]) + std::min(a[i+1],b[i+1]) + std::min(a[i+2],b[i+2]) + std::min(a[i+3],b[i+3]);
-      den += std::max(a[i],b[i]) + std::max(a[i+1],b[i+1]) + std::max(a[i+2],b[i+2]) + std::max(a[i+3],b[i+3]);
+      __m512 num = _mm512_setzero_ps();
+      __m512 den = _mm512_setzero_ps();
+      int i=0;
+      for (; i<(size-15); i+=16)
+      {
+        __m512 va = _mm512_loadu_ps(a+i);
+        __m512 vb = _mm512_loadu_ps(b+i);
+        num = _mm512_add_ps(num, _mm512_min_ps(va, vb));
+        den = _mm512_add_ps(den, _mm512_max_ps(va, vb));
+      }
+      if (i < size)
+      {
+        //masked tail, lanes past the end are loaded as zero and add nothing
+        __mmask16 mask = static_cast<__mmask16>((1u << (size - i)) - 1);
+        __m512 va = _mm512_maskz_loadu_ps(mask, a+i);
+        __m512 vb = _mm512_maskz_loadu_ps(mask, b+i);
+        num = _mm512_add_ps(num, _mm512_min_ps(va, vb));
+        den = _mm512_add_ps(den, _mm512_max_ps(va, vb));
+      }
+      float n = 1.0f + _mm512_reduce_add_ps(num);
+      float d = 1.0f + _mm512_reduce_add_ps(den);
+      return (1 - (n/d));
     }
-    //process last 0-4 elements (if size!=308)
-    while ( i < size)
+#endif
+#endif
+
+    ///A getMinMaxDistance kernel and its name
+    struct NamedMinMaxKernel
+    {
+      const char* name;
+      MinMaxKernel kernel;
+    };
+
+    ///Kernels supported by the running CPU, fastest first, scalar is always the last one
+    std::vector<NamedMinMaxKernel>
+    supportedMinMaxKernels ()
+    {
+      std::vector<NamedMinMaxKernel> kernels;
+#ifdef PEL_SIMD_DISPATCH
+      __builtin_cpu_init();
+#ifdef PEL_SIMD_AVX512
+      if (__builtin_cpu_supports("avx512f"))
+        kernels.push_back({"avx512", &minMaxAVX512});
+#endif
+      if (__builtin_cpu_supports("avx2"))
+        kernels.push_back({"avx2", &minMaxAVX2});
+      if (__builtin_cpu_supports("sse4.1"))
+        kernels.push_back({"sse4", &minMaxSSE4});
+#endif
+      kernels.push_back({"scalar", &minMaxScalar});
+      return (kernels);
+    }
+
+    ///Select the best kernel supported by the running CPU
+    MinMaxKernel
+    selectMinMaxKernel (const char** name)
     {
-      num += std::min(a[i],b[i]);
-      den += std::max(a[i],b[i]);
-      ++i;
+      const NamedMinMaxKernel best = supportedMinMaxKernels().front();
+      *name = best.name;
+      return (best.kernel);
     }
-    return (1 - (num/den));
+
+    ///Kernel dispatch, resolved once on first use
+    struct MinMaxDispatch
+    {
+      MinMaxDispatch () { kernel = selectMinMaxKernel(&name); }
+      MinMaxKernel kernel;
+      const char* name;
+    };
+
+    const MinMaxDispatch&
+    minMaxDispatch ()
+    {
+      //initialization of function statics is thread safe in C++11
+      static const MinMaxDispatch dispatch;
+      return (dispatch);
+    }
+  }
+
+  float
+  getMinMaxDistance (float* a, float* b, int size)
+  {
+    return (minMaxDispatch().kernel(a, b, size));
+  }
+
+  float
+  getMinMaxDistanceScalar (float* a, float* b, int size)
+  {
+    return (minMaxScalar(a, b, size));
+  }
+
+  const char*
+  getMinMaxDistanceKernel ()
+  {
+    return (minMaxDispatch().name);
+  }
+
+  std::vector<std::string>
+  getMinMaxDistanceKernels ()
+  {
+    std::vector<std::string> names;
+    for (const auto& k : supportedMinMaxKernels())
+      names.push_back(k.name);
+    return (names);
+  }
+
+  float
+  getMinMaxDistance (const std::string& kernel, float* a, float* b, int size)
+  {
+    for (const auto& k : supportedMinMaxKernels())
+      if (kernel == k.name)
+        return (k.kernel(a, b, size));
+    return (std::numeric_limits<float>::quiet_NaN());
   }
 
   bool
@@ -85,4 +291,37 @@ namespace pel
 
     return true;
   }
+
+  int
+  resolveNumberOfThreads (unsigned int requested)
+  {
+#ifdef _OPENMP
+    if (requested == 0)
+      return (std::max(1, omp_get_num_procs()));
+    return (static_cast<int>(requested));
+#else
+    return (1);
+#endif
+  }
+
+  void
+  computeSensorFrame (const PtC& cloud, Eigen::Matrix4f& transform, Eigen::Vector3f& centroid)
+  {
+    transform.setIdentity();
+    transform.topLeftCorner<3,3>() = Eigen::Matrix3f (cloud.sensor_orientation_);
+    transform.topRightCorner<3,1>() = cloud.sensor_origin_.head<3>();
+    //the mean commutes with rigid transformations, so transform the local centroid instead of every point
+    Eigen::Vector3d sum (Eigen::Vector3d::Zero());
+    size_t count (0);
+    for (const auto& p: cloud.points)
+      if (std::isfinite(p.x) && std::isfinite(p.y) && std::isfinite(p.z))
+      {
+        sum += p.getVector3fMap().cast<double>();
+        ++count;
+      }
+    Eigen::Vector3f local (Eigen::Vector3f::Zero());
+    if (count > 0)
+      local = (sum / static_cast<double>(count)).cast<float>();
+    centroid = transform.topLeftCorner<3,3>() * local + transform.topRightCorner<3,1>();
+  }
 }
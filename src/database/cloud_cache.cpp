@@ -0,0 +1,133 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *   Pose Estimation Library (PEL) - https://bitbucket.org/Tabjones/pose-estimation-library
+ *   Copyright (c) 2014-2015, Federico Spinelli (fspinelli@gmail.com)
+ *   All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of copyright holder(s) nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <pel/database/cloud_cache.h>
+
+namespace pel
+{
+  CloudCache::CloudCache (const Loader& loader, const size_t size, const size_t budget) :
+    loader_(loader), budget_(budget), slots_(size), resident_bytes_(0), hits_(0), misses_(0), evictions_(0)
+  {
+    for (auto& s: slots_)
+    {
+      s.lru = lru_.end();
+      s.bytes = 0;
+    }
+  }
+
+  PtC::ConstPtr
+  CloudCache::get (const size_t idx)
+  {
+    if (idx >= slots_.size())
+      return PtC::ConstPtr (new PtC);
+    {
+      std::lock_guard<std::mutex> lock (mutex_);
+      Slot& s = slots_[idx];
+      if (s.cloud)
+      {
+        ++hits_;
+        lru_.splice(lru_.begin(), lru_, s.lru); //now most recently used
+        return (s.cloud);
+      }
+      ++misses_;
+    }
+    //load without holding the lock, so other poses can be served meanwhile
+    PtC::ConstPtr cloud = loader_(idx);
+    if (!cloud)
+      cloud.reset(new PtC);
+    std::lock_guard<std::mutex> lock (mutex_);
+    Slot& s = slots_[idx];
+    if (s.cloud)
+      return (s.cloud); //someone else loaded it concurrently, use theirs
+    s.cloud = cloud;
+    s.bytes = sizeof(PtC) + cloud->points.size() * sizeof(Pt);
+    lru_.push_front(idx);
+    s.lru = lru_.begin();
+    resident_bytes_ += s.bytes;
+    //evict least recently used clouds, but always keep the one just loaded
+    while (resident_bytes_ > budget_ && lru_.size() > 1)
+    {
+      Slot& victim = slots_[lru_.back()];
+      resident_bytes_ -= victim.bytes;
+      victim.cloud.reset();
+      victim.bytes = 0;
+      victim.lru = lru_.end();
+      lru_.pop_back();
+      ++evictions_;
+    }
+    return (cloud);
+  }
+
+  void
+  CloudCache::clear ()
+  {
+    std::lock_guard<std::mutex> lock (mutex_);
+    for (auto& s: slots_)
+    {
+      s.cloud.reset();
+      s.bytes = 0;
+    }
+    lru_.clear();
+    for (auto& s: slots_)
+      s.lru = lru_.end();
+    resident_bytes_ = 0;
+  }
+
+  size_t
+  CloudCache::getResidentBytes () const
+  {
+    std::lock_guard<std::mutex> lock (mutex_);
+    return (resident_bytes_);
+  }
+
+  size_t
+  CloudCache::getHits () const
+  {
+    std::lock_guard<std::mutex> lock (mutex_);
+    return (hits_);
+  }
+
+  size_t
+  CloudCache::getMisses () const
+  {
+    std::lock_guard<std::mutex> lock (mutex_);
+    return (misses_);
+  }
+
+  size_t
+  CloudCache::getEvictions () const
+  {
+    std::lock_guard<std::mutex> lock (mutex_);
+    return (evictions_);
+  }
+}
@@ -33,17 +33,104 @@
 
 #include <pel/database/database.h>
 #include <boost/make_shared.hpp>
+#include <cstring>
+#include <limits>
+#include <unordered_set>
 
 using namespace pcl::console;
 
 namespace pel
 {
+  namespace
+  {
+    //Allocates a rows*cols matrix which owns its buffer
+    boost::shared_ptr<histograms>
+    newHistograms (const size_t rows, const size_t cols)
+    {
+      return (boost::shared_ptr<histograms> (new histograms (new float[std::max<size_t>(rows,1)*cols], rows, cols),
+            [](histograms* h) { delete[] h->ptr(); delete h; }));
+    }
+
+    //Copies rows [first, last) of src into dst, starting at row at
+    void
+    copyRows (const histograms& src, const size_t first, const size_t last, histograms& dst, const size_t at)
+    {
+      for (size_t i=first; i<last; ++i)
+        std::memcpy (dst[at + i - first], src[i], src.cols*sizeof(float));
+    }
+
+    //Builds a FLANN index over data, the index keeps data alive
+    template <typename IndexT> boost::shared_ptr<IndexT>
+    buildIndex (const boost::shared_ptr<histograms>& data)
+    {
+      boost::shared_ptr<IndexT> index (new IndexT (*data, flann::KDTreeIndexParams(4)), [data](IndexT* p) { delete p; });
+      index->buildIndex();
+      return (index);
+    }
+
+    //Buffer with room for more rows than the ones currently used
+    struct RowBuffer
+    {
+      RowBuffer (const size_t capacity, const size_t cols): data (new float[capacity*cols]), capacity (capacity),
+        used (0) {}
+      ~RowBuffer () { delete[] data; }
+      float* data;
+      size_t capacity;
+      size_t used;
+    };
+
+    //Deleter of matrices viewing the first rows of a RowBuffer, it keeps the buffer alive
+    struct BufferView
+    {
+      boost::shared_ptr<RowBuffer> buffer;
+      void operator() (histograms* h) const { delete h; }
+    };
+
+    //Returns a matrix with rows of a followed by rows of b, a and matrices sharing it are not modified.
+    //Rows of b are written in place after the ones of a when a views all the used rows of a buffer with enough
+    //room, otherwise a new buffer with room for as many rows again is allocated and moved is set to true.
+    boost::shared_ptr<histograms>
+    appendRows (const boost::shared_ptr<histograms>& a, const histograms& b, bool& moved)
+    {
+      const size_t rows (a->rows + b.rows), cols (a->cols);
+      const BufferView* view = boost::get_deleter<BufferView> (a);
+      BufferView grown;
+      moved = !(view && view->buffer->used == a->rows && view->buffer->capacity >= rows);
+      if (moved)
+      {
+        grown.buffer.reset (new RowBuffer (std::max<size_t>(2*rows, 16), cols));
+        histograms dst (grown.buffer->data, rows, cols);
+        copyRows (*a, 0, a->rows, dst, 0);
+      }
+      else
+        grown.buffer = view->buffer;
+      histograms dst (grown.buffer->data, rows, cols);
+      copyRows (b, 0, b.rows, dst, a->rows);
+      grown.buffer->used = rows;
+      return (boost::shared_ptr<histograms> (new histograms (grown.buffer->data, rows, cols), grown));
+    }
+
+    //Adds rows of data past the ones already indexed to index, which is rebuilt instead if data moved or index is
+    //shared with copies, since they must not see the new rows. FLANN itself rebuilds the trees once the index
+    //doubled in size since last build.
+    template <typename IndexT> boost::shared_ptr<IndexT>
+    extendIndex (const boost::shared_ptr<IndexT>& index, const boost::shared_ptr<histograms>& data, const bool moved)
+    {
+      if (moved || !index || index.use_count() > 1 || index->size() > data->rows)
+        return (buildIndex<IndexT> (data));
+      const size_t first (index->size());
+      if (first < data->rows)
+        index->addPoints (histograms ((*data)[first], data->rows - first, data->cols));
+      return (index);
+    }
+  }
+
   bool
   Database::isEmpty () const
   {
     if ( !(vfh_) || !(esf_) || !(cvfh_) || !(ourcvfh_) )
       return true;
-    else if (names_.empty() || names_cvfh_.empty() || names_ourcvfh_.empty() || clouds_.empty() )
+    else if (names_.empty() || cvfh_offsets_.empty() || ourcvfh_offsets_.empty() || (clouds_.empty() && !cloud_cache_) )
       return true;
     else if ( !(vfh_idx_) || !(esf_idx_) )
       return true;
@@ -51,123 +138,51 @@ namespace pel
       return false;
   }
 
-  Database::Database (const Database& other)
+  Database::Database (const Database& other): vfh_(other.vfh_), esf_(other.esf_), cvfh_(other.cvfh_),
+      ourcvfh_(other.ourcvfh_), names_(other.names_), cvfh_offsets_(other.cvfh_offsets_),
+      ourcvfh_offsets_(other.ourcvfh_offsets_), db_path_(other.db_path_), clouds_(other.clouds_),
+      cloud_cache_(other.cloud_cache_), removed_(other.removed_), removed_count_(other.removed_count_),
+      vfh_idx_(other.vfh_idx_), esf_idx_(other.esf_idx_), frames_(other.frames_), trees_(other.trees_),
+      pyramids_(other.pyramids_)
   {
-    //Make a local copy of other, so that this is exception safe
-    histograms vfh (new float[other.vfh_->rows * other.vfh_->cols], other.vfh_->rows, other.vfh_->cols);
-    for (size_t i=0; i<other.vfh_->rows; ++i)
-      for (size_t j=0; j<other.vfh_->cols; ++j)
-        vfh[i][j] = (*other.vfh_)[i][j];
-    histograms esf (new float[other.esf_->rows * other.esf_->cols], other.esf_->rows, other.esf_->cols);
-    for (size_t i=0; i<other.esf_->rows; ++i)
-      for (size_t j=0; j<other.esf_->cols; ++j)
-        esf[i][j] = (*other.esf_)[i][j];
-    histograms cvfh (new float[other.cvfh_->rows * other.cvfh_->cols], other.cvfh_->rows, other.cvfh_->cols);
-    for (size_t i=0; i<other.cvfh_->rows; ++i)
-      for (size_t j=0; j<other.cvfh_->cols; ++j)
-        cvfh[i][j] = (*other.cvfh_)[i][j];
-    histograms ourcvfh (new float[other.ourcvfh_->rows * other.ourcvfh_->cols], other.ourcvfh_->rows, other.ourcvfh_->cols);
-    for (size_t i=0; i<other.ourcvfh_->rows; ++i)
-      for (size_t j=0; j<other.ourcvfh_->cols; ++j)
-        ourcvfh[i][j] = (*other.ourcvfh_)[i][j];
-    std::vector<std::string> names;
-    boost::copy (other.names_, back_inserter(names));
-    std::vector<std::string> names_cvfh;
-    boost::copy (other.names_cvfh_, back_inserter(names_cvfh));
-    std::vector<std::string> names_ourcvfh;
-    boost::copy (other.names_ourcvfh_, back_inserter(names_ourcvfh));
-    std::vector<PtC> clouds;
-    boost::copy (other.clouds_, back_inserter(clouds));
-    //only way to copy FLANN indexs that i'm aware of (save it to disk then load it)
-    other.vfh_idx_->save(".idx_v_tmp");
-    indexVFH idx_vfh (vfh, SavedIndexParams(".idx_v_tmp"));
-    other.esf_idx_->save(".idx_e_tmp");
-    indexESF idx_esf (esf, SavedIndexParams(".idx_e_tmp"));
-    //finally save the local copy into this
-    db_path_ = other.db_path_;
-    vfh_ = boost::make_shared<histograms>(vfh);
-    esf_ = boost::make_shared<histograms>(esf);
-    cvfh_ = boost::make_shared<histograms>(cvfh);
-    ourcvfh_ = boost::make_shared<histograms>(ourcvfh);
-    vfh_idx_ = boost::make_shared<indexVFH>(idx_vfh);
-    vfh_idx_ -> buildIndex();
-    boost::filesystem::remove(".idx_v_tmp");
-    esf_idx_ = boost::make_shared<indexESF>(idx_esf);
-    esf_idx_ -> buildIndex();
-    boost::filesystem::remove(".idx_e_tmp");
-    names_.clear();
-    names_cvfh_.clear();
-    names_ourcvfh_.clear();
-    clouds_.clear();
-    boost::copy (names, back_inserter(names_));
-    boost::copy (names_ourcvfh, back_inserter(names_ourcvfh_));
-    boost::copy (clouds, back_inserter(clouds_));
-    boost::copy (names_cvfh, back_inserter(names_cvfh_));
+    //Histograms, FLANN indices and clouds are immutable once built, so they are shared (reference counted) with other
   }
 
   Database::Database (Database&& other): vfh_(std::move(other.vfh_)), esf_(std::move(other.esf_)),
       cvfh_(std::move(other.cvfh_)), ourcvfh_(std::move(other.ourcvfh_)), db_path_(std::move(other.db_path_)),
-      vfh_idx_(std::move(other.vfh_idx_)), esf_idx_(std::move(other.esf_idx_))
+      removed_count_(other.removed_count_), vfh_idx_(std::move(other.vfh_idx_)), esf_idx_(std::move(other.esf_idx_)),
+      frames_(std::move(other.frames_)), trees_(std::move(other.trees_)), pyramids_(std::move(other.pyramids_))
   {
     names_.swap(other.names_);
-    names_cvfh_.swap(other.names_cvfh_);
-    names_ourcvfh_.swap(other.names_ourcvfh_);
+    cvfh_offsets_.swap(other.cvfh_offsets_);
+    ourcvfh_offsets_.swap(other.ourcvfh_offsets_);
     clouds_.swap(other.clouds_);
+    cloud_cache_.swap(other.cloud_cache_);
+    removed_.swap(other.removed_);
+    other.removed_count_ = 0;
   }
 
   Database&
   Database::operator= (const Database& other)
   {
-    histograms vfh (new float[other.vfh_->rows * other.vfh_->cols], other.vfh_->rows, other.vfh_->cols);
-    for (size_t i=0; i<other.vfh_->rows; ++i)
-      for (size_t j=0; j<other.vfh_->cols; ++j)
-        vfh[i][j] = (*other.vfh_)[i][j];
-    histograms esf (new float[other.esf_->rows * other.esf_->cols], other.esf_->rows, other.esf_->cols);
-    for (size_t i=0; i<other.esf_->rows; ++i)
-      for (size_t j=0; j<other.esf_->cols; ++j)
-        esf[i][j] = (*other.esf_)[i][j];
-    histograms cvfh (new float[other.cvfh_->rows * other.cvfh_->cols], other.cvfh_->rows, other.cvfh_->cols);
-    for (size_t i=0; i<other.cvfh_->rows; ++i)
-      for (size_t j=0; j<other.cvfh_->cols; ++j)
-        cvfh[i][j] = (*other.cvfh_)[i][j];
-    histograms ourcvfh (new float[other.ourcvfh_->rows * other.ourcvfh_->cols], other.ourcvfh_->rows, other.ourcvfh_->cols);
-    for (size_t i=0; i<other.ourcvfh_->rows; ++i)
-      for (size_t j=0; j<other.ourcvfh_->cols; ++j)
-        ourcvfh[i][j] = (*other.ourcvfh_)[i][j];
-    std::vector<std::string> names;
-    boost::copy (other.names_, back_inserter(names));
-    std::vector<std::string> names_cvfh;
-    boost::copy (other.names_cvfh_, back_inserter(names_cvfh));
-    std::vector<std::string> names_ourcvfh;
-    boost::copy (other.names_ourcvfh_, back_inserter(names_ourcvfh));
-    std::vector<PtC> clouds;
-    boost::copy (other.clouds_, back_inserter(clouds));
-    //only way to copy FLANN indexs that i'm aware of (save it to disk then load it)
-    other.vfh_idx_->save(".idx_v_tmp");
-    indexVFH idx_vfh (vfh, SavedIndexParams(".idx_v_tmp"));
-    boost::filesystem::remove(".idx_v_tmp"); //delete tmp file
-    //only way to copy indexs that i'm aware of (save it to disk then load it)
-    other.esf_idx_->save(".idx_e_tmp");
-    indexESF idx_esf (esf, SavedIndexParams(".idx_e_tmp"));
-    boost::filesystem::remove(".idx_e_tmp"); //delete tmp file
-    //save tmp db into this
-    this->vfh_ = boost::make_shared<histograms>(vfh);
-    this->esf_ = boost::make_shared<histograms>(esf);
-    this->cvfh_ = boost::make_shared<histograms>(cvfh);
-    this->ourcvfh_ = boost::make_shared<histograms>(ourcvfh);
-    this->vfh_idx_ = boost::make_shared<indexVFH>(idx_vfh);
-    this->vfh_idx_ -> buildIndex();
-    this->esf_idx_ = boost::make_shared<indexESF>(idx_esf);
-    this->esf_idx_ -> buildIndex();
-    this->names_.clear();
-    this->names_cvfh_.clear();
-    this->names_ourcvfh_.clear();
-    this->clouds_.clear();
-    boost::copy (names, back_inserter(this->names_));
-    boost::copy (names_ourcvfh, back_inserter(this->names_ourcvfh_));
-    boost::copy (clouds, back_inserter(this->clouds_));
-    boost::copy (names_cvfh, back_inserter(this->names_cvfh_));
+    //Histograms, FLANN indices and clouds are immutable once built, so they are shared (reference counted) with other
+    this->vfh_ = other.vfh_;
+    this->esf_ = other.esf_;
+    this->cvfh_ = other.cvfh_;
+    this->ourcvfh_ = other.ourcvfh_;
+    this->names_ = other.names_;
+    this->cvfh_offsets_ = other.cvfh_offsets_;
+    this->ourcvfh_offsets_ = other.ourcvfh_offsets_;
     this->db_path_ = other.db_path_;
+    this->clouds_ = other.clouds_;
+    this->cloud_cache_ = other.cloud_cache_;
+    this->removed_ = other.removed_;
+    this->removed_count_ = other.removed_count_;
+    this->vfh_idx_ = other.vfh_idx_;
+    this->esf_idx_ = other.esf_idx_;
+    this->frames_ = other.frames_;
+    this->trees_ = other.trees_;
+    this->pyramids_ = other.pyramids_;
     return *this;
   }
 
@@ -179,12 +194,19 @@ namespace pel
     this->cvfh_ = std::move(other.cvfh_);
     this->ourcvfh_ = std::move(other.ourcvfh_);
     this->names_ = std::move(other.names_);
-    this->names_cvfh_ = std::move(other.names_cvfh_);
-    this->names_ourcvfh_ = std::move(other.names_ourcvfh_);
+    this->cvfh_offsets_ = std::move(other.cvfh_offsets_);
+    this->ourcvfh_offsets_ = std::move(other.ourcvfh_offsets_);
     this->db_path_= std::move(other.db_path_);
     this->clouds_ = std::move(other.clouds_);
+    this->cloud_cache_ = std::move(other.cloud_cache_);
+    this->removed_ = std::move(other.removed_);
+    this->removed_count_ = other.removed_count_;
+    other.removed_count_ = 0;
     this->vfh_idx_ = std::move(other.vfh_idx_);
     this->esf_idx_ = std::move(other.esf_idx_);
+    this->frames_ = std::move(other.frames_);
+    this->trees_ = std::move(other.trees_);
+    this->pyramids_ = std::move(other.pyramids_);
     return *this;
   }
 
@@ -201,112 +223,334 @@ namespace pel
       print_error("%*s]\tTarget histogram is empty, cannot continue.\n",20,__func__);
       return false;
     }
-    distIdx.clear();
-    if ( feat == ListType::cvfh )
-    { //cvfh list
-      for (int n=0; n<target->points.size(); ++n)
-      {//for each target cluster
-        float d; //tmp distance
-        int s=0; //counts objects
-        for (int i=0; i<names_cvfh_.size(); ++i)
-        {// for each cluster in database
-          if (i != 0 && i != (names_cvfh_.size()-1) ) //nor first neither last
-          {
-            if (names_cvfh_[i].compare(names_cvfh_[i-1]) == 0)
-            {//another cluster of the same object
-              d = std::min (d, (getMinMaxDistance(target->points[n].histogram, (*cvfh_)[i], 308)) );
-            }
-            else
-            {//another cluster of another object
-              if (n==0)
-                distIdx.push_back( std::make_pair(d, s++) );
-              else
-                distIdx[s++].first += d;
-              d = getMinMaxDistance (target->points[n].histogram, (*cvfh_)[i], 308);
-            }
-          }
-          else if (i == (names_cvfh_.size() -1) )
-          {//last cluster of last object
-            if (names_cvfh_[i].compare(names_cvfh_[i-1]) == 0)
-            {//last cluster is still part of previous object
-              d = std::min (d, (getMinMaxDistance(target->points[n].histogram, (*cvfh_)[i], 308)) );
-              if (n==0)
-                distIdx.push_back( std::make_pair(d, s++) );
-              else
-                distIdx[s++].first += d;
-            }
-            else
-            {//last cluster is part of another last object
-              d = getMinMaxDistance(target->points[n].histogram, (*cvfh_)[i], 308);
-              if (n==0)
-                distIdx.push_back( std::make_pair(d, s++) );
-              else
-                distIdx[s++].first += d;
-            }
-          }
-          else
-          {//first cluster of first object
-            d = getMinMaxDistance (target->points[n].histogram, (*cvfh_)[i], 308);
-          }
-        }//end of for each cluster in db
-      }//end of for each target cluster
-      return true;
+    if ( feat != ListType::cvfh && feat != ListType::ourcvfh )
+    {
+      print_error("%*s]\tfeat must be 'ListType::cvfh' or 'ListType::ourcvfh'! Exiting...\n",20,__func__);
+      return false;
     }
-    else if ( feat == ListType::ourcvfh )
-    { //ourcvfh list
-      for (int n=0; n<target->points.size(); ++n)
+    const histograms& db = (feat == ListType::cvfh) ? *cvfh_ : *ourcvfh_;
+    const std::vector<size_t>& offsets = (feat == ListType::cvfh) ? cvfh_offsets_ : ourcvfh_offsets_;
+    const size_t poses = offsets.size() -1;
+    distIdx.resize(poses);
+    for (size_t s=0; s<poses; ++s)
+      distIdx[s] = std::make_pair(0.0f, static_cast<int>(s));
+    //The distance of a pose is the sum, over target clusters, of the minimum distance between that target
+    //cluster and all the clusters of the pose. Database rows are processed in tiles of whole poses, small
+    //enough to stay in cache while every target cluster is compared against them.
+    const size_t tile_rows = std::max<size_t>(1, tile_bytes_ / (db.cols * sizeof(float)));
+    size_t first(0);
+    while (first < poses)
+    {
+      size_t last (first+1);
+      while (last < poses && offsets[last+1] - offsets[first] <= tile_rows)
+        ++last;
+      for (size_t n=0; n<target->points.size(); ++n)
       {//for each target cluster
-        float d; //tmp distance
-        int s=0; //counts objects
-        for (int i=0; i<names_ourcvfh_.size(); ++i)
-        {// for each cluster in database
-          if (i != 0 && i != (names_ourcvfh_.size()-1) ) //not first neither last
+        float* hist = target->points[n].histogram;
+        for (size_t s=first; s<last; ++s)
+        {//for each pose in tile, take the minimum among its clusters
+          float d = std::numeric_limits<float>::infinity();
+          if (isRemoved(s))
           {
-            if (names_ourcvfh_[i].compare(names_ourcvfh_[i-1]) == 0)
-            {//another cluster of the same object
-              d = std::min (d, (getMinMaxDistance(target->points[n].histogram, (*ourcvfh_)[i], 308)) );
-            }
-            else
-            {//another cluster of another object
-              if (n==0)
-                distIdx.push_back( std::make_pair(d, s++) );
-              else
-                distIdx[s++].first += d;
-              d = getMinMaxDistance (target->points[n].histogram, (*ourcvfh_)[i], 308);
-            }
-          }
-          else if (i == (names_cvfh_.size() -1) )
-          {//last cluster of last object
-            if (names_cvfh_[i].compare(names_cvfh_[i-1]) == 0)
-            {//last cluster is still part of previous object
-              d = std::min (d, (getMinMaxDistance(target->points[n].histogram, (*ourcvfh_)[i], 308)) );
-              if (n==0)
-                distIdx.push_back( std::make_pair(d, s++) );
-              else
-                distIdx[s++].first += d;
-            }
-            else
-            {//last cluster is part of another last object
-              d = getMinMaxDistance(target->points[n].histogram, (*ourcvfh_)[i], 308);
-              if (n==0)
-                distIdx.push_back( std::make_pair(d, s++) );
-              else
-                distIdx[s++].first += d;
-            }
+            distIdx[s].first = d;
+            continue;
           }
-          else
-          {//first cluster of first object
-            d = getMinMaxDistance (target->points[n].histogram, (*ourcvfh_)[i], 308);
-          }
-        }//end of for each cluster in db
-      }//end of for each target
+          for (size_t i=offsets[s]; i<offsets[s+1]; ++i)
+            d = std::min(d, getMinMaxDistance(hist, db[i], db.cols));
+          distIdx[s].first += d;
+        }
+      }
+      first = last;
+    }
+    return true;
+  }
+
+  std::vector<std::string>
+  Database::getDatabaseNamesCVFH () const
+  {
+    std::vector<std::string> names;
+    for (size_t s=0; s+1 < cvfh_offsets_.size(); ++s)
+      names.insert(names.end(), cvfh_offsets_[s+1] - cvfh_offsets_[s], names_[s]);
+    return (names);
+  }
+
+  std::vector<std::string>
+  Database::getDatabaseNamesOURCVFH () const
+  {
+    std::vector<std::string> names;
+    for (size_t s=0; s+1 < ourcvfh_offsets_.size(); ++s)
+      names.insert(names.end(), ourcvfh_offsets_[s+1] - ourcvfh_offsets_[s], names_[s]);
+    return (names);
+  }
+
+  std::vector<PtC::ConstPtr>
+  Database::getDatabaseClouds () const
+  {
+    if (!cloud_cache_)
+      return (clouds_);
+    std::vector<PtC::ConstPtr> clouds;
+    clouds.reserve(cloud_cache_->size());
+    for (size_t i=0; i<cloud_cache_->size(); ++i)
+      clouds.push_back(cloud_cache_->get(i));
+    return (clouds);
+  }
+
+  PtC::ConstPtr
+  Database::getDatabaseCloud (const size_t idx) const
+  {
+    if (cloud_cache_)
+      return (cloud_cache_->get(idx));
+    if (idx < clouds_.size())
+      return (clouds_[idx]);
+    return (PtC::ConstPtr (new PtC));
+  }
+
+  bool
+  Database::addPoses (const Database& other)
+  {
+    if (other.isEmpty())
+    {
+      print_error("%*s]\tDatabase to add is empty, cannot continue.\n",20,__func__);
+      return false;
+    }
+    if (this->isEmpty())
+    {
+      *this = other;
       return true;
     }
-    else
+    if (vfh_->cols != other.vfh_->cols || esf_->cols != other.esf_->cols ||
+        cvfh_->cols != other.cvfh_->cols || ourcvfh_->cols != other.ourcvfh_->cols)
     {
-      print_error("%*s]\tfeat must be 'ListType::cvfh' or 'ListType::ourcvfh'! Exiting...\n",20,__func__);
+      print_error("%*s]\tHistograms of database to add have different sizes, cannot continue.\n",20,__func__);
       return false;
     }
+    std::unordered_set<std::string> present (names_.begin(), names_.end());
+    for (const auto& name : other.names_)
+      if (present.count(name))
+      {
+        print_error("%*s]\tPose %s is already in database, remove it first.\n",20,__func__,name.c_str());
+        return false;
+      }
+    const size_t n (names_.size()), m (other.names_.size());
+    //Rows of other are appended after the ones of this database, in place when there is room left by previous
+    //additions. Matrices held by copies keep their rows count, so they keep seeing the old poses.
+    bool vfh_moved, esf_moved, moved;
+    vfh_ = appendRows (vfh_, *other.vfh_, vfh_moved);
+    esf_ = appendRows (esf_, *other.esf_, esf_moved);
+    cvfh_ = appendRows (cvfh_, *other.cvfh_, moved);
+    ourcvfh_ = appendRows (ourcvfh_, *other.ourcvfh_, moved);
+    if (frames_ && other.frames_)
+      frames_ = appendRows (frames_, *other.frames_, moved);
+    else
+      frames_.reset(); //computed from clouds on demand
+    const size_t cvfh_rows (cvfh_offsets_.back()), ourcvfh_rows (ourcvfh_offsets_.back());
+    for (size_t s=1; s<=m; ++s)
+    {
+      cvfh_offsets_.push_back(cvfh_rows + other.cvfh_offsets_[s]);
+      ourcvfh_offsets_.push_back(ourcvfh_rows + other.ourcvfh_offsets_[s]);
+    }
+    names_.insert(names_.end(), other.names_.begin(), other.names_.end());
+    if (!removed_.empty() || !other.removed_.empty())
+    {
+      removed_.resize(n, false);
+      removed_.insert(removed_.end(), m, false);
+      for (size_t s=0; s<m; ++s)
+        removed_[n+s] = other.isRemoved(s);
+      removed_count_ += other.removed_count_;
+    }
+    if (cloud_cache_ || other.cloud_cache_)
+    {
+      //Page clouds of both databases through a single cache, loading them as their own caches would
+      CloudCache::Loader first, second;
+      if (cloud_cache_)
+        first = cloud_cache_->getLoader();
+      else
+      {
+        std::vector<PtC::ConstPtr> clouds (clouds_);
+        first = [clouds](size_t i) { return (clouds[i]); };
+      }
+      if (other.cloud_cache_)
+        second = other.cloud_cache_->getLoader();
+      else
+      {
+        std::vector<PtC::ConstPtr> clouds (other.clouds_);
+        second = [clouds](size_t i) { return (clouds[i]); };
+      }
+      const size_t budget = std::max (cloud_cache_ ? cloud_cache_->getBudget() : 0,
+          other.cloud_cache_ ? other.cloud_cache_->getBudget() : 0);
+      cloud_cache_.reset (new CloudCache ([first, second, n](size_t i) { return (i < n ? first(i) : second(i-n)); },
+            n + m, budget));
+      clouds_.clear();
+    }
+    else
+      clouds_.insert(clouds_.end(), other.clouds_.begin(), other.clouds_.end());
+    vfh_idx_ = extendIndex<indexVFH> (vfh_idx_, vfh_, vfh_moved);
+    esf_idx_ = extendIndex<indexESF> (esf_idx_, esf_, esf_moved);
+    return true;
+  }
+
+  size_t
+  Database::removePoses (const std::vector<std::string>& names)
+  {
+    if (this->isEmpty())
+      return 0;
+    std::unordered_set<std::string> to_remove (names.begin(), names.end());
+    removed_.resize(names_.size(), false);
+    size_t count (0);
+    for (size_t s=0; s<names_.size(); ++s)
+      if (!removed_[s] && to_remove.count(names_[s]))
+      {
+        removed_[s] = true;
+        ++count;
+      }
+    removed_count_ += count;
+    if (count > 0)
+      dropCachedTrees();
+    //Tombstoned rows still cost time in every query, drop them once they are a noticeable fraction
+    if (removed_count_ * 4 > names_.size())
+      compact();
+    return count;
+  }
+
+  void
+  Database::compact ()
+  {
+    if (removed_count_ == 0)
+    {
+      removed_.clear();
+      return;
+    }
+    if (removed_count_ >= names_.size())
+    {
+      clear();
+      return;
+    }
+    std::vector<size_t> kept;
+    kept.reserve(names_.size() - removed_count_);
+    for (size_t s=0; s<names_.size(); ++s)
+      if (!removed_[s])
+        kept.push_back(s);
+    //VFH and ESF have one row per pose
+    boost::shared_ptr<histograms>* single[2] = {&vfh_, &esf_};
+    for (int i=0; i<2; ++i)
+    {
+      const histograms& a = **single[i];
+      boost::shared_ptr<histograms> h = newHistograms (kept.size(), a.cols);
+      for (size_t j=0; j<kept.size(); ++j)
+        copyRows (a, kept[j], kept[j]+1, *h, j);
+      *single[i] = h;
+    }
+    //CVFH and OURCVFH have the clusters of each pose between its offsets
+    boost::shared_ptr<histograms>* clustered[2] = {&cvfh_, &ourcvfh_};
+    std::vector<size_t>* offsets[2] = {&cvfh_offsets_, &ourcvfh_offsets_};
+    for (int i=0; i<2; ++i)
+    {
+      const histograms& a = **clustered[i];
+      const std::vector<size_t>& off = *offsets[i];
+      std::vector<size_t> new_off (1, 0);
+      for (const auto& s : kept)
+        new_off.push_back(new_off.back() + off[s+1] - off[s]);
+      boost::shared_ptr<histograms> h = newHistograms (new_off.back(), a.cols);
+      for (size_t j=0; j<kept.size(); ++j)
+        copyRows (a, off[kept[j]], off[kept[j]+1], *h, new_off[j]);
+      *clustered[i] = h;
+      offsets[i]->swap(new_off);
+    }
+    if (frames_)
+    {
+      boost::shared_ptr<histograms> h = newHistograms (kept.size(), frame_cols_);
+      for (size_t j=0; j<kept.size(); ++j)
+        copyRows (*frames_, kept[j], kept[j]+1, *h, j);
+      frames_ = h;
+    }
+    std::vector<std::string> names;
+    names.reserve(kept.size());
+    for (const auto& s : kept)
+      names.push_back(names_[s]);
+    names_.swap(names);
+    if (cloud_cache_)
+    {
+      CloudCache::Loader loader = cloud_cache_->getLoader();
+      cloud_cache_.reset (new CloudCache ([loader, kept](size_t i) { return (loader(kept[i])); },
+            kept.size(), cloud_cache_->getBudget()));
+    }
+    else
+    {
+      std::vector<PtC::ConstPtr> clouds;
+      clouds.reserve(kept.size());
+      for (const auto& s : kept)
+        clouds.push_back(clouds_[s]);
+      clouds_.swap(clouds);
+    }
+    removed_.clear();
+    removed_count_ = 0;
+    vfh_idx_ = buildIndex<indexVFH> (vfh_);
+    esf_idx_ = buildIndex<indexESF> (esf_);
+    dropCachedTrees();
+  }
+
+  void
+  Database::dropCachedTrees ()
+  {
+    trees_.reset(new SearchTreeCache(trees_ ? trees_->getBudget() : 0));
+    if (pyramids_)
+      pyramids_.reset(new VoxelPyramidCache(pyramids_->getLeafSize(), pyramids_->getBudget()));
+  }
+
+  void
+  Database::getSensorFrame (const size_t idx, Eigen::Matrix4f& transform, Eigen::Vector3f& centroid) const
+  {
+    if (frames_ && idx < frames_->rows)
+    {
+      const float* row = (*frames_)[idx];
+      transform = Eigen::Map<const Eigen::Matrix<float,4,4,Eigen::RowMajor> > (row);
+      centroid = Eigen::Map<const Eigen::Vector3f> (row + 16);
+    }
+    else
+      computeSensorFrame (*getDatabaseCloud(idx), transform, centroid);
+  }
+
+  SearchTreeCache::Tree::Ptr
+  Database::getDatabaseSearchTree (const size_t idx) const
+  {
+    PtC::ConstPtr cloud = getDatabaseCloud(idx);
+    if (trees_)
+      return (trees_->get(cloud));
+    SearchTreeCache::Tree::Ptr tree (new SearchTreeCache::Tree);
+    tree->setInputCloud(cloud);
+    return (tree);
+  }
+
+  SearchTreeCache::Tree::Ptr
+  Database::getDatabaseSearchTree (const size_t idx, const unsigned int level) const
+  {
+    if (level == 0)
+      return (getDatabaseSearchTree(idx));
+    //coarse levels are kept alive by pyramids_, so they are cached like pose clouds
+    PtC::ConstPtr cloud = getDatabasePyramidCloud(idx, level);
+    if (trees_)
+      return (trees_->get(cloud));
+    SearchTreeCache::Tree::Ptr tree (new SearchTreeCache::Tree);
+    tree->setInputCloud(cloud);
+    return (tree);
+  }
+
+  void
+  Database::setPyramidLeafSize (const float leaf)
+  {
+    if (pyramids_ && pyramids_->getLeafSize() == leaf)
+      return;
+    //same budget of paged clouds, coarse levels are a fraction of them
+    pyramids_.reset(new VoxelPyramidCache(leaf, cloud_cache_ ? cloud_cache_->getBudget() : 0));
+  }
+
+  PtC::ConstPtr
+  Database::getDatabasePyramidCloud (const size_t idx, const unsigned int level) const
+  {
+    PtC::ConstPtr cloud = getDatabaseCloud(idx);
+    if (level == 0 || !pyramids_)
+      return (cloud);
+    return (pyramids_->get(cloud, level));
   }
 
   void
@@ -317,11 +561,17 @@ namespace pel
     cvfh_.reset();
     ourcvfh_.reset();
     names_.clear();
-    names_cvfh_.clear();
-    names_ourcvfh_.clear();
+    cvfh_offsets_.clear();
+    ourcvfh_offsets_.clear();
     vfh_idx_.reset();
     esf_idx_.reset();
+    frames_.reset();
+    trees_.reset(new SearchTreeCache);
+    pyramids_.reset();
     clouds_.clear();
+    cloud_cache_.reset();
+    removed_.clear();
+    removed_count_ = 0;
     db_path_.clear();
   }
 }
@@ -34,11 +34,11 @@
 #include <pel/database/database_io.h>
 #include <pel/database/database.h>
 #include <pel/database/database_creator.h>
+#include <pel/features/seeded_esf_estimation.h>
 #include <pcl/common/common.h>
 #include <pcl/common/angles.h>
 #include <pcl/common/transforms.h>
 #include <pcl/features/vfh.h>
-#include <pcl/features/esf.h>
 #include <pcl/features/cvfh.h>
 #include <pcl/features/our_cvfh.h>
 #include <pcl/filters/voxel_grid.h>
@@ -51,11 +51,142 @@ using namespace pcl::console;
 
 namespace pel
 {
+  bool
+  DatabaseCreator::processPose (const boost::filesystem::path& file, PoseData& pose, const int normal_threads) const
+  {
+    PtC::Ptr input (new PtC);
+    if (is_regular_file (file) && file.extension() == ".pcd")
+    {
+      if (pcl::io::loadPCDFile(file.c_str(), *input)!=0 ) //loadPCDFile returns 0 if success
+      {
+#ifdef _OPENMP
+#pragma omp critical (pel_creator_print)
+#endif
+        print_warn("%*s]\tError Loading Cloud %s, skipping...\n",20,__func__,file.c_str());
+        return false;
+      }
+    }
+    else
+    {
+#ifdef _OPENMP
+#pragma omp critical (pel_creator_print)
+#endif
+      print_warn("%*s]\tLoaded File (%s) is not a pcd, skipping...\n",20,__func__,file.c_str());
+      return false;
+    }
+    std::vector<std::string> vst;
+    PtC::Ptr output (new PtC);
+    boost::split (vst, file.string(), boost::is_any_of("../\\"), boost::token_compress_on);
+    pose.name = vst.at(vst.size()-2); //filename without extension and path
+    if (config_.filter)
+    {
+      pcl::StatisticalOutlierRemoval<Pt> filter;
+      filter.setMeanK ( config_.filter_mean_k );
+      filter.setStddevMulThresh ( config_.filter_std_dev_mul_thresh );
+      filter.setInputCloud(input);
+      filter.filter(*output); //Process Filtering
+      pcl::copyPointCloud(*output, *input);
+    }
+    if (config_.upsamp)
+    {
+      pcl::MovingLeastSquares<Pt, Pt> mls;
+      pcl::search::KdTree<Pt>::Ptr tree (new pcl::search::KdTree<Pt>);
+      mls.setInputCloud (input);
+      mls.setSearchMethod (tree);
+      mls.setUpsamplingMethod (pcl::MovingLeastSquares<Pt, Pt>::RANDOM_UNIFORM_DENSITY);
+      mls.setComputeNormals (false);
+      mls.setPolynomialOrder ( config_.upsamp_poly_order );
+      mls.setPolynomialFit ( config_.upsamp_poly_fit );
+      mls.setSearchRadius ( config_.upsamp_search_radius );
+      mls.setPointDensity( config_.upsamp_point_density );
+      mls.process (*output); //Process Upsampling
+      copyPointCloud(*output, *input);
+    }
+    if (config_.downsamp)
+    {
+      pcl::VoxelGrid <Pt> vgrid;
+      vgrid.setInputCloud (input);
+      float leaf = config_.downsamp_leaf_size;
+      vgrid.setLeafSize (leaf, leaf, leaf);
+      vgrid.setDownsampleAllData (true);
+      vgrid.filter (*output); //Process Downsampling
+      copyPointCloud(*output, *input);
+    }
+    pose.cloud.reset(new PtC(*input)); //store a copy of processed cloud
+    Eigen::Vector3f s_orig (input->sensor_origin_(0), input->sensor_origin_(1), input->sensor_origin_(2) );
+    Eigen::Quaternionf s_orie = input->sensor_orientation_;
+    input->sensor_origin_.setZero();
+    input->sensor_orientation_.setIdentity();
+    pcl::transformPointCloud(*input, *output, s_orig, s_orie);
+    pcl::copyPointCloud(*output, *input);
+    //Normals computation
+    pcl::NormalEstimationOMP<Pt, pcl::Normal> ne;
+    pcl::search::KdTree<Pt>::Ptr tree (new pcl::search::KdTree<Pt>);
+    pcl::PointCloud<pcl::Normal>::Ptr normals (new pcl::PointCloud<pcl::Normal>);
+    ne.setSearchMethod(tree);
+    ne.setRadiusSearch(config_.normals_radius_search);
+    ne.setNumberOfThreads(normal_threads);
+    ne.setInputCloud(input);
+    //Use sensor origin stored inside point cloud as viewpoint, should be zero.
+    //Because cloud now is in viewpoint reference frame
+    ne.useSensorOriginAsViewPoint();
+    ne.compute(*normals);
+    //VFH
+    pcl::VFHEstimation<Pt, pcl::Normal, pcl::VFHSignature308> vfhE;
+    pcl::PointCloud<pcl::VFHSignature308> out;
+    vfhE.setSearchMethod(tree);
+    vfhE.setInputCloud (input);
+    vfhE.setViewPoint (0,0,0);
+    vfhE.setInputNormals (normals);
+    vfhE.compute (out);
+    pose.vfh = out.points[0];
+    //ESF, sampled with its own generator: rand() is shared by all threads
+    SeededESFEstimation esfE;
+    pcl::PointCloud<pcl::ESFSignature640> out_esf;
+    esfE.setSearchMethod(tree);
+    esfE.setInputCloud (input);
+    esfE.compute (out_esf);
+    pose.esf = out_esf.points[0];
+    //CVFH
+    pcl::CVFHEstimation<Pt, pcl::Normal, pcl::VFHSignature308> cvfhE;
+    cvfhE.setSearchMethod(tree);
+    cvfhE.setInputCloud (input);
+    cvfhE.setViewPoint (0, 0, 0);
+    cvfhE.setInputNormals (normals);
+    //angle needs to be supplied in radians
+    cvfhE.setEPSAngleThreshold(pcl::deg2rad(config_.cvfh_ang_thresh));
+    cvfhE.setCurvatureThreshold(config_.cvfh_curv_thresh);
+    cvfhE.setClusterTolerance(config_.cvfh_clus_tol);
+    cvfhE.setMinPoints(config_.cvfh_clus_min_points);
+    cvfhE.setNormalizeBins(false);
+    cvfhE.compute (out);
+    pose.cvfh.assign(out.points.begin(), out.points.end());
+    //OURCVFH
+    pcl::OURCVFHEstimation<Pt, pcl::Normal, pcl::VFHSignature308> ourcvfhE;
+    pcl::search::KdTree<Pt>::Ptr tree2 (new pcl::search::KdTree<Pt>);
+    pcl::PointCloud<Pt>::Ptr input2 (new pcl::PointCloud<Pt>);
+    copyPointCloud(*input, *input2);
+    ourcvfhE.setSearchMethod(tree2);
+    ourcvfhE.setInputCloud (input2);
+    ourcvfhE.setViewPoint (0,0,0);
+    ourcvfhE.setInputNormals (normals);
+    ourcvfhE.setEPSAngleThreshold(pcl::deg2rad(config_.ourcvfh_ang_thresh));
+    ourcvfhE.setCurvatureThreshold(config_.ourcvfh_curv_thresh);
+    ourcvfhE.setClusterTolerance(config_.ourcvfh_clus_tol);
+    ourcvfhE.setMinPoints(config_.ourcvfh_clus_min_points);
+    ourcvfhE.setAxisRatio(config_.ourcvfh_axis_ratio);
+    ourcvfhE.setMinAxisValue(config_.ourcvfh_min_axis_value);
+    ourcvfhE.setRefineClusters(config_.ourcvfh_refine_clusters);
+    ourcvfhE.compute (out);
+    pose.ourcvfh.assign(out.points.begin(), out.points.end());
+    return true;
+  }
+
   Database
   DatabaseCreator::create (boost::filesystem::path path_clouds)
   {
-    //Check params correctness
-    fixParameters();
+    //Check params correctness and publish them, poses are processed with this snapshot
+    commit();
     Database created;
     //Start database creation
     if (boost::filesystem::exists(path_clouds) && boost::filesystem::is_directory(path_clouds))
@@ -63,144 +194,66 @@ namespace pel
       std::vector<boost::filesystem::path> pvec;
       copy(boost::filesystem::directory_iterator(path_clouds), boost::filesystem::directory_iterator(), back_inserter(pvec));
       sort(pvec.begin(), pvec.end());
-      pcl::PointCloud<pcl::VFHSignature308>::Ptr tmp_vfh (new pcl::PointCloud<pcl::VFHSignature308>);
-      pcl::PointCloud<pcl::VFHSignature308>::Ptr tmp_cvfh (new pcl::PointCloud<pcl::VFHSignature308>);
-      pcl::PointCloud<pcl::VFHSignature308>::Ptr tmp_ourcvfh (new pcl::PointCloud<pcl::VFHSignature308>);
-      pcl::PointCloud<pcl::ESFSignature640>::Ptr tmp_esf (new pcl::PointCloud<pcl::ESFSignature640>);
-      PtC::Ptr input (new PtC);
-      int i(0);
-      for (const auto& file : pvec)
+      //Process poses concurrently, each one into its own slot
+      const int size = pvec.size();
+      const int threads = resolveNumberOfThreads(threads_);
+      //normal estimation is parallel too, avoid oversubscribing cores when poses already run in parallel
+      const int normal_threads = (threads > 1) ? 1 : 0;
+      std::vector<PoseData> poses (size);
+      std::vector<char> valid (size, 0);
+      int processed (0);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(threads) schedule(dynamic,1)
+#endif
+      for (int p=0; p<size; ++p)
       {
-        if (is_regular_file (file) && file.extension() == ".pcd")
+        valid[p] = processPose(pvec[p], poses[p], normal_threads);
+        if (valid[p])
         {
-          if (pcl::io::loadPCDFile(file.c_str(), *input)!=0 ) //loadPCDFile returns 0 if success
+#ifdef _OPENMP
+#pragma omp critical (pel_creator_print)
+#endif
           {
-            print_warn("%*s]\tError Loading Cloud %s, skipping...\n",20,__func__,file.c_str());
-            continue;
+            print_info("%*s]\t%d clouds processed so far...\r",20,__func__,++processed);
+            std::cout<<std::flush;
           }
         }
-        else
-        {
-          print_warn("%*s]\tLoaded File (%s) is not a pcd, skipping...\n",20,__func__,file.c_str());
+      }
+      //Merge in sorted file order, so the result does not depend on the number of threads
+      pcl::PointCloud<pcl::VFHSignature308>::Ptr tmp_vfh (new pcl::PointCloud<pcl::VFHSignature308>);
+      pcl::PointCloud<pcl::VFHSignature308>::Ptr tmp_cvfh (new pcl::PointCloud<pcl::VFHSignature308>);
+      pcl::PointCloud<pcl::VFHSignature308>::Ptr tmp_ourcvfh (new pcl::PointCloud<pcl::VFHSignature308>);
+      pcl::PointCloud<pcl::ESFSignature640>::Ptr tmp_esf (new pcl::PointCloud<pcl::ESFSignature640>);
+      //sensor frames are stored now, so estimators do not need to transform every candidate cloud to get its centroid
+      std::vector<float> frames;
+      created.cvfh_offsets_.push_back(0);
+      created.ourcvfh_offsets_.push_back(0);
+      for (int p=0; p<size; ++p)
+      {
+        if (!valid[p])
           continue;
-        }
-        std::vector<std::string> vst;
-        PtC::Ptr output (new PtC);
-        boost::split (vst, file.string(), boost::is_any_of("../\\"), boost::token_compress_on);
-        created.names_.push_back(vst.at(vst.size()-2)); //filename without extension and path
-        if (this->getParam("filtering") >0)
-        {
-          pcl::StatisticalOutlierRemoval<Pt> filter;
-          filter.setMeanK ( this->getParam("filter_mean_k") );
-          filter.setStddevMulThresh ( this->getParam("filter_std_dev_mul_thresh") );
-          filter.setInputCloud(input);
-          filter.filter(*output); //Process Filtering
-          pcl::copyPointCloud(*output, *input);
-        }
-        if (this->getParam("upsamp") >0)
-        {
-          pcl::MovingLeastSquares<Pt, Pt> mls;
-          pcl::search::KdTree<Pt>::Ptr tree (new pcl::search::KdTree<Pt>);
-          mls.setInputCloud (input);
-          mls.setSearchMethod (tree);
-          mls.setUpsamplingMethod (pcl::MovingLeastSquares<Pt, Pt>::RANDOM_UNIFORM_DENSITY);
-          mls.setComputeNormals (false);
-          mls.setPolynomialOrder ( this->getParam("upsamp_poly_order") );
-          mls.setPolynomialFit ( this->getParam("upsamp_poly_fit") );
-          mls.setSearchRadius ( this->getParam("upsamp_search_radius") );
-          mls.setPointDensity( this->getParam("upsamp_point_density") );
-          mls.process (*output); //Process Upsampling
-          copyPointCloud(*output, *input);
-        }
-        if (this->getParam("downsamp") >0)
-        {
-          pcl::VoxelGrid <Pt> vgrid;
-          vgrid.setInputCloud (input);
-          float leaf = this->getParam("downsamp_leaf_size");
-          vgrid.setLeafSize (leaf, leaf, leaf);
-          vgrid.setDownsampleAllData (true);
-          vgrid.filter (*output); //Process Downsampling
-          copyPointCloud(*output, *input);
-        }
-        created.clouds_.push_back(*input); //store processed cloud
-        Eigen::Vector3f s_orig (input->sensor_origin_(0), input->sensor_origin_(1), input->sensor_origin_(2) );
-        Eigen::Quaternionf s_orie = input->sensor_orientation_;
-        input->sensor_origin_.setZero();
-        input->sensor_orientation_.setIdentity();
-        pcl::transformPointCloud(*input, *output, s_orig, s_orie);
-        pcl::copyPointCloud(*output, *input);
-        //Normals computation
-        pcl::NormalEstimationOMP<Pt, pcl::Normal> ne;
-        pcl::search::KdTree<Pt>::Ptr tree (new pcl::search::KdTree<Pt>);
-        pcl::PointCloud<pcl::Normal>::Ptr normals (new pcl::PointCloud<pcl::Normal>);
-        ne.setSearchMethod(tree);
-        ne.setRadiusSearch(this->getParam("normals_radius_search"));
-        ne.setNumberOfThreads(0); //use pcl autoallocation
-        ne.setInputCloud(input);
-        //Use sensor origin stored inside point cloud as viewpoint, should be zero.
-        //Because cloud now is in viewpoint reference frame
-        ne.useSensorOriginAsViewPoint();
-        ne.compute(*normals);
-        //VFH
-        pcl::VFHEstimation<Pt, pcl::Normal, pcl::VFHSignature308> vfhE;
-        pcl::PointCloud<pcl::VFHSignature308> out;
-        vfhE.setSearchMethod(tree);
-        vfhE.setInputCloud (input);
-        vfhE.setViewPoint (0,0,0);
-        vfhE.setInputNormals (normals);
-        vfhE.compute (out);
-        tmp_vfh->push_back(out.points[0]);
-        //ESF
-        pcl::ESFEstimation<Pt, pcl::ESFSignature640> esfE;
-        pcl::PointCloud<pcl::ESFSignature640> out_esf;
-        esfE.setSearchMethod(tree);
-        esfE.setInputCloud (input);
-        esfE.compute (out_esf);
-        tmp_esf->push_back(out_esf.points[0]);
-        //CVFH
-        pcl::CVFHEstimation<Pt, pcl::Normal, pcl::VFHSignature308> cvfhE;
-        cvfhE.setSearchMethod(tree);
-        cvfhE.setInputCloud (input);
-        cvfhE.setViewPoint (0, 0, 0);
-        cvfhE.setInputNormals (normals);
-        //angle needs to be supplied in radians
-        cvfhE.setEPSAngleThreshold(pcl::deg2rad(this->getParam("cvfh_ang_thresh")));
-        cvfhE.setCurvatureThreshold(this->getParam("cvfh_curv_thresh"));
-        cvfhE.setClusterTolerance(this->getParam("cvfh_clus_tol"));
-        cvfhE.setMinPoints(this->getParam("cvfh_clus_min_points"));
-        cvfhE.setNormalizeBins(false);
-        cvfhE.compute (out);
-        for (size_t n=0; n<out.points.size(); ++n)
-        {
-          created.names_cvfh_.push_back(created.names_[i]);
-          tmp_cvfh->push_back(out.points[n]);
-        }
-        //OURCVFH
-        pcl::OURCVFHEstimation<Pt, pcl::Normal, pcl::VFHSignature308> ourcvfhE;
-        pcl::search::KdTree<Pt>::Ptr tree2 (new pcl::search::KdTree<Pt>);
-        pcl::PointCloud<Pt>::Ptr input2 (new pcl::PointCloud<Pt>);
-        copyPointCloud(*input, *input2);
-        ourcvfhE.setSearchMethod(tree2);
-        ourcvfhE.setInputCloud (input2);
-        ourcvfhE.setViewPoint (0,0,0);
-        ourcvfhE.setInputNormals (normals);
-        ourcvfhE.setEPSAngleThreshold(pcl::deg2rad(this->getParam("ourcvfh_ang_thresh")));
-        ourcvfhE.setCurvatureThreshold(this->getParam("ourcvfh_curv_thresh"));
-        ourcvfhE.setClusterTolerance(this->getParam("ourcvfh_clus_tol"));
-        ourcvfhE.setMinPoints(this->getParam("ourcvf_clus_min_points"));
-        ourcvfhE.setAxisRatio(this->getParam("ourcvfh_axis_ratio"));
-        ourcvfhE.setMinAxisValue(this->getParam("ourcvfh_min_axis_value"));
-        ourcvfhE.setRefineClusters(this->getParam("ourcvfh_refine_clusters"));
-        ourcvfhE.compute (out);
-        for (size_t n=0; n<out.points.size(); ++n)
-        {
-          tmp_ourcvfh->push_back(out.points[n]);
-          created.names_ourcvfh_.push_back(created.names_[i]);
-        }
-        print_info("%*s]\t%d clouds processed so far...\r",20,__func__,i+1);
-        std::cout<<std::flush;
-        ++i;
+        PoseData& pose = poses[p];
+        Eigen::Matrix4f transform;
+        Eigen::Vector3f centroid;
+        computeSensorFrame (*pose.cloud, transform, centroid);
+        frames.resize(frames.size() + Database::frame_cols_);
+        float* row = &frames[frames.size() - Database::frame_cols_];
+        Eigen::Map<Eigen::Matrix<float,4,4,Eigen::RowMajor> > row_transform (row);
+        row_transform = transform;
+        Eigen::Map<Eigen::Vector3f> (row + 16) = centroid;
+        created.names_.push_back(pose.name);
+        created.clouds_.push_back(pose.cloud);
+        tmp_vfh->push_back(pose.vfh);
+        tmp_esf->push_back(pose.esf);
+        for (const auto& h: pose.cvfh)
+          tmp_cvfh->push_back(h);
+        created.cvfh_offsets_.push_back(tmp_cvfh->points.size());
+        for (const auto& h: pose.ourcvfh)
+          tmp_ourcvfh->push_back(h);
+        created.ourcvfh_offsets_.push_back(tmp_ourcvfh->points.size());
+        pose = PoseData(); //release memory as soon as possible
       }
+      int i(0);
       std::cout<<std::endl;
       if (tmp_vfh->points.size() == 0) //no clouds loaded
       {
@@ -228,6 +281,9 @@ namespace pel
       created.esf_ = boost::make_shared<histograms>(esf);
       created.cvfh_ = boost::make_shared<histograms>(cvfh);
       created.ourcvfh_ = boost::make_shared<histograms>(ourcvfh);
+      histograms poses_frames (new float[frames.size()], frames.size() / Database::frame_cols_, Database::frame_cols_);
+      std::copy (frames.begin(), frames.end(), poses_frames.ptr());
+      created.frames_ = boost::make_shared<histograms>(poses_frames);
       //and indices
       indexVFH vfh_idx (*created.vfh_, flann::KDTreeIndexParams(4));
       created.vfh_idx_ = boost::make_shared<indexVFH>(vfh_idx);
@@ -0,0 +1,362 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *   Pose Estimation Library (PEL) - https://bitbucket.org/Tabjones/pose-estimation-library
+ *   Copyright (c) 2014-2015, Federico Spinelli (fspinelli@gmail.com)
+ *   All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of copyright holder(s) nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <pel/database/database_generator.h>
+#include <pel/database/database.h>
+#include <pcl/common/transforms.h>
+#include <pcl/io/pcd_io.h>
+#include <cstdio>
+#include <cmath>
+
+using namespace pcl::console;
+
+namespace pel
+{
+  namespace
+  {
+    ///Purposes of random draws, each one has its own stream
+    enum Stream {shape_stream, pose_stream, target_stream, clusters_stream, prototype_stream, histogram_stream};
+
+    ///Rotation of a sensor placed in eye and looking at the origin, z-axis forward
+    Eigen::Matrix3f
+    lookAtOrigin (const Eigen::Vector3f& eye)
+    {
+      const Eigen::Vector3f z = -eye.normalized();
+      const Eigen::Vector3f up = (std::abs(z(2)) < 0.99f) ? Eigen::Vector3f::UnitZ() : Eigen::Vector3f::UnitY();
+      const Eigen::Vector3f x = up.cross(z).normalized();
+      Eigen::Matrix3f R;
+      R.col(0) = x;
+      R.col(1) = z.cross(x);
+      R.col(2) = z;
+      return (R);
+    }
+
+    ///Scale a histogram so that its bins sum to 100
+    void
+    normalizeHistogram (float* h, const int size)
+    {
+      double sum (0);
+      for (int j=0; j<size; ++j)
+        sum += h[j];
+      if (sum > 0)
+        for (int j=0; j<size; ++j)
+          h[j] = static_cast<float>(100 * h[j] / sum);
+    }
+
+    ///Draw a random histogram with positive bins
+    void
+    randomHistogram (std::mt19937& rng, float* h, const int size)
+    {
+      std::exponential_distribution<float> e (1);
+      for (int j=0; j<size; ++j)
+        h[j] = e(rng);
+      normalizeHistogram(h, size);
+    }
+
+    ///Perturb each bin of a prototype histogram by a random factor
+    void
+    perturbHistogram (const float* prototype, std::mt19937& rng, float* h, const int size)
+    {
+      std::normal_distribution<float> g (0, 0.25f);
+      for (int j=0; j<size; ++j)
+        h[j] = prototype[j] * std::exp(g(rng));
+      normalizeHistogram(h, size);
+    }
+
+    ///Number of decimal digits of n
+    int
+    digits (unsigned int n)
+    {
+      int d (1);
+      while (n >= 10)
+      {
+        n /= 10;
+        ++d;
+      }
+      return (d);
+    }
+  }
+
+  std::mt19937
+  DatabaseGenerator::getGenerator (const unsigned int object, const unsigned int view, const unsigned int stream) const
+  {
+    std::seed_seq seq {seed_, object, view, stream};
+    return (std::mt19937 (seq));
+  }
+
+  DatabaseGenerator::Shape
+  DatabaseGenerator::getShape (const unsigned int object) const
+  {
+    std::mt19937 rng = getGenerator(object, 0, shape_stream);
+    std::uniform_real_distribution<float> dim (0.03f, 0.08f);
+    Shape shape;
+    shape.type = object % 3;
+    shape.size << dim(rng), dim(rng), dim(rng);
+    return (shape);
+  }
+
+  Eigen::Vector3f
+  DatabaseGenerator::getViewpoint (const unsigned int view) const
+  {
+    const float golden = M_PI * (3 - std::sqrt(5.0f));
+    const float z = 1 - 2*(view + 0.5f)/views_;
+    const float r = std::sqrt(std::max(0.0f, 1 - z*z));
+    return (distance_ * Eigen::Vector3f(r*std::cos(golden*view), r*std::sin(golden*view), z));
+  }
+
+  std::string
+  DatabaseGenerator::getPoseName (const unsigned int object, const unsigned int view) const
+  {
+    //zero padded, so names sort like poses are generated, as DatabaseCreator sorts files
+    char name[64];
+    std::snprintf(name, sizeof(name), "obj%0*u_view%0*u", std::max(4, digits(objects_ > 0 ? objects_-1 : 0)),
+        object, std::max(4, digits(views_ > 0 ? views_-1 : 0)), view);
+    return (std::string(name));
+  }
+
+  PtC::Ptr
+  DatabaseGenerator::sampleView (const Shape& shape, const Eigen::Vector3f& eye, std::mt19937& rng) const
+  {
+    PtC::Ptr view (new PtC);
+    std::uniform_real_distribution<float> u (0,1);
+    std::normal_distribution<float> g (0,1);
+    Eigen::Vector3f p, n;
+    view->points.reserve(points_);
+    //only the side facing the sensor is visible, shapes are convex
+    for (size_t tries=0; view->points.size() < points_ && tries < 20*static_cast<size_t>(points_); ++tries)
+    {
+      if (shape.type == 0)
+      {
+        n << g(rng), g(rng), g(rng);
+        n.normalize();
+        p = shape.size(0) * n;
+      }
+      else if (shape.type == 1)
+      {
+        //pick a face with probability proportional to its area
+        const Eigen::Vector3f& h = shape.size;
+        const float areas[3] = {h(1)*h(2), h(0)*h(2), h(0)*h(1)};
+        const float r = u(rng) * (areas[0] + areas[1] + areas[2]);
+        const int axis = (r < areas[0]) ? 0 : (r < areas[0] + areas[1]) ? 1 : 2;
+        const float sign = (u(rng) < 0.5f) ? -1.0f : 1.0f;
+        for (int i=0; i<3; ++i)
+          p(i) = (2*u(rng) -1) * h(i);
+        p(axis) = sign * h(axis);
+        n.setZero();
+        n(axis) = sign;
+      }
+      else
+      {
+        //cylinder along z
+        const float r (shape.size(0)), h (shape.size(1));
+        const float side = 4*M_PI*r*h, caps = 2*M_PI*r*r;
+        const float theta = 2*M_PI*u(rng);
+        if (u(rng) * (side + caps) < side)
+        {
+          n << std::cos(theta), std::sin(theta), 0;
+          p << r*n(0), r*n(1), (2*u(rng) -1) * h;
+        }
+        else
+        {
+          const float sign = (u(rng) < 0.5f) ? -1.0f : 1.0f;
+          const float rr = r * std::sqrt(u(rng));
+          p << rr*std::cos(theta), rr*std::sin(theta), sign*h;
+          n << 0, 0, sign;
+        }
+      }
+      if ((eye - p).dot(n) <= 0)
+        continue;
+      Pt pt;
+      pt.x = p(0) + noise_*g(rng);
+      pt.y = p(1) + noise_*g(rng);
+      pt.z = p(2) + noise_*g(rng);
+      view->points.push_back(pt);
+    }
+    view->width = view->points.size();
+    view->height = 1;
+    view->is_dense = true;
+    //sensor_origin_ and sensor_orientation_ bring the view from the shape frame back into sensor frame
+    const Eigen::Matrix3f R = lookAtOrigin(eye);
+    view->sensor_origin_ << -R.transpose() * eye, 0;
+    view->sensor_orientation_ = Eigen::Quaternionf(R.transpose());
+    return (view);
+  }
+
+  PtC::Ptr
+  DatabaseGenerator::generatePose (const unsigned int object, const unsigned int view) const
+  {
+    std::mt19937 rng = getGenerator(object, view, pose_stream);
+    return (sampleView(getShape(object), getViewpoint(view), rng));
+  }
+
+  PtC::Ptr
+  DatabaseGenerator::generateTarget (const unsigned int object, const unsigned int view) const
+  {
+    std::mt19937 rng = getGenerator(object, view, target_stream);
+    std::uniform_real_distribution<float> j (-jitter_, jitter_);
+    Eigen::Vector3f eye = getViewpoint(view);
+    eye += Eigen::Vector3f(j(rng), j(rng), j(rng));
+    PtC::Ptr local = sampleView(getShape(object), eye, rng);
+    PtC::Ptr target (new PtC);
+    Eigen::Vector3f offset (local->sensor_origin_.head<3>());
+    pcl::transformPointCloud(*local, *target, offset, local->sensor_orientation_);
+    target->sensor_origin_.setZero();
+    target->sensor_orientation_.setIdentity();
+    return (target);
+  }
+
+  bool
+  DatabaseGenerator::writePoses (boost::filesystem::path path) const
+  {
+    boost::system::error_code ec;
+    boost::filesystem::create_directories(path, ec);
+    if (!boost::filesystem::is_directory(path))
+    {
+      print_error("%*s]\tCannot create directory %s\n",20,__func__,path.c_str());
+      return false;
+    }
+    for (unsigned int o=0; o<objects_; ++o)
+      for (unsigned int v=0; v<views_; ++v)
+      {
+        boost::filesystem::path file = path / (getPoseName(o, v) + ".pcd");
+        if (pcl::io::savePCDFileBinary(file.string(), *generatePose(o, v)) != 0)
+        {
+          print_error("%*s]\tError writing %s\n",20,__func__,file.c_str());
+          return false;
+        }
+      }
+    return true;
+  }
+
+  Database
+  DatabaseGenerator::create (DatabaseCreator& creator) const
+  {
+    boost::filesystem::path tmp = boost::filesystem::temp_directory_path() /
+      boost::filesystem::unique_path("pel_poses_%%%%-%%%%-%%%%-%%%%");
+    Database created;
+    if (writePoses(tmp))
+      created = creator.create(tmp);
+    boost::system::error_code ec;
+    boost::filesystem::remove_all(tmp, ec);
+    return (created);
+  }
+
+  Database
+  DatabaseGenerator::createDescriptorsOnly () const
+  {
+    Database created;
+    const size_t n = getNumberOfPoses();
+    if (n == 0)
+    {
+      print_error("%*s]\tNothing to generate, set a positive number of objects and views\n",20,__func__);
+      return (created);
+    }
+    //clusters of each pose are drawn first, so that histograms rows are known and can be filled concurrently
+    created.cvfh_offsets_.assign(n+1, 0);
+    created.ourcvfh_offsets_.assign(n+1, 0);
+    for (unsigned int o=0; o<objects_; ++o)
+      for (unsigned int v=0; v<views_; ++v)
+      {
+        const size_t i = static_cast<size_t>(o)*views_ + v;
+        std::mt19937 rng = getGenerator(o, v, clusters_stream);
+        created.cvfh_offsets_[i+1] = created.cvfh_offsets_[i] + 1 + rng() % 3;
+        created.ourcvfh_offsets_[i+1] = created.ourcvfh_offsets_[i] + 1 + rng() % 3;
+        created.names_.push_back(getPoseName(o, v));
+      }
+    histograms vfh (new float[n*308], n, 308);
+    histograms esf (new float[n*640], n, 640);
+    histograms cvfh (new float[created.cvfh_offsets_[n]*308], created.cvfh_offsets_[n], 308);
+    histograms ourcvfh (new float[created.ourcvfh_offsets_[n]*308], created.ourcvfh_offsets_[n], 308);
+    histograms frames (new float[n*Database::frame_cols_], n, Database::frame_cols_);
+    //one small placeholder cloud serves every pose, sensor frames are computed on its centroid
+    Shape placeholder_shape;
+    placeholder_shape.type = 0;
+    placeholder_shape.size << 0.05f, 0.05f, 0.05f;
+    std::mt19937 placeholder_rng = getGenerator(0, 0, pose_stream);
+    PtC::Ptr placeholder = sampleView(placeholder_shape, distance_ * Eigen::Vector3f::UnitZ(), placeholder_rng);
+    Eigen::Vector3f local (Eigen::Vector3f::Zero());
+    for (const auto& p: placeholder->points)
+      local += p.getVector3fMap();
+    if (!placeholder->points.empty())
+      local /= placeholder->points.size();
+    const int size = objects_;
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(resolveNumberOfThreads(threads_)) schedule(dynamic,1)
+#endif
+    for (int o=0; o<size; ++o)
+    {
+      std::mt19937 prng = getGenerator(o, 0, prototype_stream);
+      std::vector<float> vfh_p (308), esf_p (640), cvfh_p (308), ourcvfh_p (308);
+      randomHistogram(prng, vfh_p.data(), 308);
+      randomHistogram(prng, esf_p.data(), 640);
+      randomHistogram(prng, cvfh_p.data(), 308);
+      randomHistogram(prng, ourcvfh_p.data(), 308);
+      for (unsigned int v=0; v<views_; ++v)
+      {
+        const size_t i = static_cast<size_t>(o)*views_ + v;
+        std::mt19937 rng = getGenerator(o, v, histogram_stream);
+        perturbHistogram(vfh_p.data(), rng, vfh[i], 308);
+        perturbHistogram(esf_p.data(), rng, esf[i], 640);
+        for (size_t c=created.cvfh_offsets_[i]; c<created.cvfh_offsets_[i+1]; ++c)
+          perturbHistogram(cvfh_p.data(), rng, cvfh[c], 308);
+        for (size_t c=created.ourcvfh_offsets_[i]; c<created.ourcvfh_offsets_[i+1]; ++c)
+          perturbHistogram(ourcvfh_p.data(), rng, ourcvfh[c], 308);
+        //same frame as a pose of create(), see sampleView()
+        const Eigen::Vector3f eye = getViewpoint(v);
+        const Eigen::Matrix3f R = lookAtOrigin(eye).transpose();
+        Eigen::Matrix4f transform (Eigen::Matrix4f::Identity());
+        transform.topLeftCorner<3,3>() = R;
+        transform.topRightCorner<3,1>() = -R * eye;
+        float* row = frames[i];
+        Eigen::Map<Eigen::Matrix<float,4,4,Eigen::RowMajor> > row_transform (row);
+        row_transform = transform;
+        Eigen::Map<Eigen::Vector3f> row_centroid (row + 16);
+        row_centroid = R * local - R * eye;
+      }
+    }
+    created.clouds_.assign(n, placeholder);
+    created.vfh_ = boost::make_shared<histograms>(vfh);
+    created.esf_ = boost::make_shared<histograms>(esf);
+    created.cvfh_ = boost::make_shared<histograms>(cvfh);
+    created.ourcvfh_ = boost::make_shared<histograms>(ourcvfh);
+    created.frames_ = boost::make_shared<histograms>(frames);
+    indexVFH vfh_idx (*created.vfh_, flann::KDTreeIndexParams(4));
+    created.vfh_idx_ = boost::make_shared<indexVFH>(vfh_idx);
+    created.vfh_idx_->buildIndex();
+    indexESF esf_idx (*created.esf_, flann::KDTreeIndexParams(4));
+    created.esf_idx_ = boost::make_shared<indexESF>(esf_idx);
+    created.esf_idx_->buildIndex();
+    print_info("%*s]\tDone generating synthetic database, total of %d poses stored in memory\n",20,__func__,created.names_.size());
+    return (created);
+  }
+}
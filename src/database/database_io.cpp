@@ -33,176 +33,573 @@
 
 #include <pel/database/database_io.h>
 #include <pel/database/database.h>
+#include <pcl/common/time.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 using namespace pcl::console;
 
 namespace pel
 {
-  bool
-  DatabaseReader::load (boost::filesystem::path path, Database& target)
+  namespace
   {
-    if ( isValidDatabasePath(path) )
+    ///Read a list file with one trimmed entry per line
+    bool
+    readList (const boost::filesystem::path& file_path, std::vector<std::string>& list)
     {
-      boost::filesystem::path Pclouds(path.string()+"/Clouds");
-      std::vector<boost::filesystem::path> pvec;
-      copy (boost::filesystem::directory_iterator(Pclouds), boost::filesystem::directory_iterator(), back_inserter(pvec));
-      if (pvec.size() <= 0)
-      {
-        print_error("%*s]\tNo files in Clouds directory of database, cannot load poses, aborting...\n",20,__func__);
+      std::ifstream file (file_path.c_str());
+      if (!file.is_open())
         return false;
-      }
-      sort (pvec.begin(), pvec.end());
-      Database tmp;
-      tmp.clouds_.resize(pvec.size());
-      int i(0);
-      for (std::vector<boost::filesystem::path>::const_iterator it(pvec.begin()); it != pvec.end(); ++it, ++i)
+      std::string line;
+      while (getline (file, line))
+      {
+        boost::trim(line); //remove white spaces from line
+        if (!line.empty())
+          list.push_back(line);
+      }//end of file
+      return true;
+    }
+
+    /**\brief Load offsets of clusters of each pose for feature feat ("cvfh" or "ourcvfh").
+     * Offsets are read from offsets.<feat> if present, otherwise they are rebuilt from names.<feat>,
+     * which lists the pose name of every cluster (databases saved with older versions of PEL).
+     */
+    bool
+    loadClusterOffsets (const boost::filesystem::path& path, const std::string& feat, const std::vector<std::string>& names,
+        const size_t rows, std::vector<size_t>& offsets)
+    {
+      offsets.clear();
+      std::vector<std::string> list;
+      try
       {
-        if (boost::filesystem::is_regular_file(*it) && boost::filesystem::extension(*it)==".pcd" )
+        if (boost::filesystem::is_regular_file(path.string() + "/offsets." + feat))
         {
-          if (pcl::io::loadPCDFile (it->string(),tmp.clouds_[i])!=0)
-          {
-            print_warn("%*s]\tError loading PCD file number %d, name %s, skipping...\n",20,__func__,i+1,it->string().c_str());
-            continue;
-          }
-          Eigen::Vector3f s_orig (tmp.clouds_[i].sensor_origin_(0), tmp.clouds_[i].sensor_origin_(1), tmp.clouds_[i].sensor_origin_(2) ) ;
-          Eigen::Quaternionf s_orie = tmp.clouds_[i].sensor_orientation_;
-          if (tmp.clouds_[i].points.size() <= 0)
-            print_warn("%*s]\tLoaded PCD file number %d, name %s has ZERO points!! Are you loading the correct files?\n",20,__func__,i+1,it->string().c_str());
+          if (!readList(path.string() + "/offsets." + feat, list))
+            return false;
+          for (const auto& x: list)
+            offsets.push_back(std::stoul(x));
         }
         else
         {
-          print_warn("%*s]\t%s is not a PCD file, skipping...\n",20,__func__,it->string().c_str());
-          continue;
+          if (!readList(path.string() + "/names." + feat, list))
+            return false;
+          //clusters of the same pose are contiguous and poses follow names.list order
+          size_t row(0);
+          offsets.push_back(0);
+          for (const auto& name: names)
+          {
+            while (row < list.size() && list[row].compare(name) == 0)
+              ++row;
+            offsets.push_back(row);
+          }
+          if (row != list.size())
+            return false;
+          if (row < rows)
+            print_warn("%*s]\tnames.%s lists only %d of %d clusters, remaining ones are ignored. Recreate database to use them all.\n",
+                20,__func__,feat.c_str(),(int)row,(int)rows);
         }
       }
-      try
-      {
-        tmp.vfh_.reset(new histograms);
-        flann::load_from_file (*(tmp.vfh_), path.string() + "/vfh.h5", "VFH Histograms");
-      }
       catch (...)
       {
-        print_error("%*s]\tError loading VFH histograms, file is likely corrupted, try recreating database...\n",20,__func__);
         return false;
       }
-      try
-      {
-        tmp.esf_.reset(new histograms);
-        flann::load_from_file (*(tmp.esf_), path.string() + "/esf.h5", "ESF Histograms");
-      }
-      catch (...)
-      {
-        print_error("%*s]\tError loading ESF histograms, file is likely corrupted, try recreating database...\n",20,__func__);
+      //offsets must be one more than poses, start from zero and never decrease
+      if (offsets.size() != names.size()+1 || offsets.front() != 0 || offsets.back() > rows)
         return false;
-      }
-      try
+      for (size_t i=1; i<offsets.size(); ++i)
+        if (offsets[i] < offsets[i-1])
+          return false;
+      return true;
+    }
+  }
+
+  namespace
+  {
+    ///Single file database layout, see DatabaseWriter::saveSingleFile
+    const char file_magic[8] = {'P','E','L','D','B','\0','\0','\0'};
+    const uint32_t file_version = 2;
+    ///Oldest version still readable, version 1 files have no pose centroids
+    const uint32_t file_min_version = 1;
+    const uint32_t file_byte_order = 0x01020304;
+    const uint64_t file_alignment = 64;
+    ///Sections of a single file database, in the order they are written
+    enum FileSection {vfh_sec, esf_sec, cvfh_sec, ourcvfh_sec, cvfh_offsets_sec, ourcvfh_offsets_sec,
+      name_offsets_sec, names_sec, clouds_sec, points_sec, vfh_idx_sec, esf_idx_sec, sections};
+    ///Header at the beginning of a single file database
+    struct FileHeader
+    {
+      char magic[8];
+      uint32_t version;
+      uint32_t byte_order;
+      uint64_t poses;
+      uint64_t points;
+      uint64_t point_size;
+      uint64_t rows[4]; //vfh, esf, cvfh, ourcvfh
+      uint64_t cols[4];
+      uint64_t offset[sections];
+      uint64_t size[sections];
+    };
+    ///Description of one pose cloud, its points are contiguous in points section
+    struct FileCloud
+    {
+      uint64_t first_point;
+      uint32_t width;
+      uint32_t height;
+      float origin[4];
+      float orientation[4]; //w,x,y,z
+      uint32_t is_dense;
+      float centroid[3]; //in sensor frame, since version 2
+    };
+    ///Read-only memory mapping of a whole file, unmapped when last user releases it
+    struct MappedFile
+    {
+      MappedFile () : data(MAP_FAILED), size(0) {}
+      ~MappedFile ()
       {
-        tmp.cvfh_.reset(new histograms);
-        flann::load_from_file (*(tmp.cvfh_), path.string() + "/cvfh.h5", "CVFH Histograms");
+        if (data != MAP_FAILED)
+          munmap (data, size);
       }
-      catch (...)
-      {
-        print_error("%*s]\tError loading CVFH histograms, file is likely corrupted, try recreating database...\n",20,__func__);
+      void* data;
+      size_t size;
+    };
+
+    ///Serialize a FLANN index into a memory buffer
+    template <typename IndexT> bool
+    serializeIndex (IndexT& index, std::string& blob)
+    {
+      char* buf (NULL);
+      size_t len (0);
+      FILE* stream = open_memstream (&buf, &len);
+      if (!stream)
         return false;
-      }
+      index.saveIndex (stream);
+      fclose (stream);
+      blob.assign (buf, len);
+      free (buf);
+      return true;
+    }
+
+    ///Deserialize a FLANN index built over data from a memory buffer, map is kept alive with the index
+    template <typename IndexT> boost::shared_ptr<IndexT>
+    deserializeIndex (const boost::shared_ptr<MappedFile>& map, const histograms& data, const char* blob, const size_t len)
+    {
+      FILE* stream = fmemopen (const_cast<char*>(blob), len, "rb");
+      if (!stream)
+        throw std::runtime_error ("Cannot open index buffer");
+      boost::shared_ptr<IndexT> index (new IndexT (data, flann::KDTreeIndexParams(4)), [map](IndexT* p) { delete p; });
       try
       {
-        tmp.ourcvfh_.reset(new histograms);
-        flann::load_from_file (*(tmp.ourcvfh_), path.string() + "/ourcvfh.h5", "OURCVFH Histograms");
+        index->loadIndex (stream);
       }
       catch (...)
       {
-        print_error("%*s]\tError loading OURCVFH histograms, file is likely corrupted, try recreating database...\n",20,__func__);
-        return false;
+        fclose (stream);
+        throw;
       }
-      try
-      {
-        tmp.vfh_idx_.reset(new indexVFH(*(tmp.vfh_), SavedIndexParams(path.string()+"/vfh.idx")));
-        tmp.vfh_idx_ ->buildIndex();
-      }
-      catch (...)
+      fclose (stream);
+      return index;
+    }
+
+    ///Copy a pose cloud out of a single file database, PCL clouds must own their points
+    PtC::ConstPtr
+    cloudFromFile (const FileCloud& rec, const Pt* points)
+    {
+      PtC::Ptr cloud (new PtC);
+      const uint64_t size = static_cast<uint64_t>(rec.width) * rec.height;
+      cloud->points.assign(points + rec.first_point, points + rec.first_point + size);
+      cloud->width = rec.width;
+      cloud->height = rec.height;
+      cloud->is_dense = rec.is_dense != 0;
+      cloud->sensor_origin_ = Eigen::Vector4f (rec.origin[0], rec.origin[1], rec.origin[2], rec.origin[3]);
+      cloud->sensor_orientation_ = Eigen::Quaternionf (rec.orientation[0], rec.orientation[1], rec.orientation[2], rec.orientation[3]);
+      return cloud;
+    }
+
+    ///Load a pose cloud from a PCD file, an empty cloud if that fails
+    PtC::ConstPtr
+    cloudFromPCD (const boost::filesystem::path& file)
+    {
+      PtC::Ptr cloud (new PtC);
+      if (pcl::io::loadPCDFile (file.string(),*cloud)!=0)
+        print_warn("%*s]\tError loading PCD file %s, using an empty cloud\n",20,__func__,file.string().c_str());
+      return cloud;
+    }
+  }
+
+  bool
+  DatabaseReader::loadSingleFile (boost::filesystem::path path, Database& target)
+  {
+    pcl::StopWatch timer, t;
+    timer.reset();
+    boost::shared_ptr<MappedFile> map (new MappedFile);
+    int fd = open (path.string().c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+      print_error("%*s]\tCannot open %s, aborting...\n",20,__func__,path.string().c_str());
+      return false;
+    }
+    struct stat st;
+    if (fstat (fd, &st) == 0 && st.st_size >= static_cast<off_t>(sizeof(FileHeader)))
+    {
+      map->size = st.st_size;
+      map->data = mmap (NULL, map->size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close (fd);
+    if (map->data == MAP_FAILED)
+    {
+      print_error("%*s]\tCannot map %s, file is too small or unreadable, aborting...\n",20,__func__,path.string().c_str());
+      return false;
+    }
+    const char* base = static_cast<const char*>(map->data);
+    FileHeader h;
+    std::memcpy (&h, base, sizeof(FileHeader));
+    if (std::memcmp (h.magic, file_magic, sizeof(file_magic)) != 0 || h.byte_order != file_byte_order)
+    {
+      print_error("%*s]\t%s is not a PEL database file, or it was written on a different architecture\n",20,__func__,path.string().c_str());
+      return false;
+    }
+    if (h.version < file_min_version || h.version > file_version || h.point_size != sizeof(Pt))
+    {
+      print_error("%*s]\t%s has unsupported version %d, try recreating database\n",20,__func__,path.string().c_str(),h.version);
+      return false;
+    }
+    //every section must be aligned, inside the file and of the expected size
+    const uint64_t n (h.poses);
+    bool valid = n > 0;
+    for (int i=0; i<sections && valid; ++i)
+      valid = (h.offset[i] % file_alignment == 0) && h.offset[i] <= map->size && h.size[i] <= map->size - h.offset[i];
+    for (int i=0; i<4 && valid; ++i)
+      valid = h.size[vfh_sec + i] == h.rows[i]*h.cols[i]*sizeof(float);
+    valid = valid && h.rows[0] == n && h.rows[1] == n &&
+      h.size[cvfh_offsets_sec] == (n+1)*sizeof(uint64_t) && h.size[ourcvfh_offsets_sec] == (n+1)*sizeof(uint64_t) &&
+      h.size[name_offsets_sec] == (n+1)*sizeof(uint64_t) && h.size[clouds_sec] == n*sizeof(FileCloud) &&
+      h.size[points_sec] == h.points*sizeof(Pt);
+    if (!valid)
+    {
+      print_error("%*s]\t%s is truncated or corrupted, try recreating database\n",20,__func__,path.string().c_str());
+      return false;
+    }
+    Database tmp;
+    LoadTimings timings;
+    t.reset();
+    //Histograms are views over the mapping, each one keeps the mapping alive
+    boost::shared_ptr<histograms>* hists[4] = {&tmp.vfh_, &tmp.esf_, &tmp.cvfh_, &tmp.ourcvfh_};
+    for (int i=0; i<4; ++i)
+    {
+      float* data = reinterpret_cast<float*>(const_cast<char*>(base + h.offset[vfh_sec + i]));
+      hists[i]->reset (new histograms (data, h.rows[i], h.cols[i]), [map](histograms* p) { delete p; });
+    }
+    timings.histograms = t.getTime();
+    t.reset();
+    const uint64_t* names_off = reinterpret_cast<const uint64_t*>(base + h.offset[name_offsets_sec]);
+    const uint64_t* cvfh_off = reinterpret_cast<const uint64_t*>(base + h.offset[cvfh_offsets_sec]);
+    const uint64_t* ourcvfh_off = reinterpret_cast<const uint64_t*>(base + h.offset[ourcvfh_offsets_sec]);
+    const FileCloud* clouds = reinterpret_cast<const FileCloud*>(base + h.offset[clouds_sec]);
+    const Pt* points = reinterpret_cast<const Pt*>(base + h.offset[points_sec]);
+    tmp.names_.reserve(n);
+    if (cloud_budget_ == 0)
+      tmp.clouds_.reserve(n);
+    for (uint64_t i=0; i<n; ++i)
+    {
+      const uint64_t size = static_cast<uint64_t>(clouds[i].width) * clouds[i].height;
+      if (names_off[i] > names_off[i+1] || names_off[i+1] > h.size[names_sec] ||
+          clouds[i].first_point > h.points || size > h.points - clouds[i].first_point)
       {
-        print_error("%*s]\tError loading VFH index, file is likely corrupted, try recreating database...\n",20,__func__);
+        print_error("%*s]\t%s has corrupted pose %d, try recreating database\n",20,__func__,path.string().c_str(),(int)i);
         return false;
       }
-      try
+      tmp.names_.push_back(std::string(base + h.offset[names_sec] + names_off[i], names_off[i+1] - names_off[i]));
+      if (cloud_budget_ == 0)
+        tmp.clouds_.push_back(cloudFromFile(clouds[i], points));
+    }
+    if (cloud_budget_ > 0)
+    {
+      //the loader keeps the mapping alive as long as the cache exists
+      tmp.cloud_cache_.reset(new CloudCache([map, clouds, points](size_t i) { return cloudFromFile(clouds[i], points); },
+            n, cloud_budget_));
+      //trees keep their clouds alive, keep them within the same budget
+      tmp.trees_.reset(new SearchTreeCache(cloud_budget_));
+    }
+    if (h.version >= 2)
+    {
+      //sensor frames come from cloud records, no point needs to be touched
+      tmp.frames_.reset (new histograms (new float[n*Database::frame_cols_], n, Database::frame_cols_),
+          [](histograms* p) { delete[] p->ptr(); delete p; });
+      for (uint64_t i=0; i<n; ++i)
       {
-        tmp.esf_idx_.reset(new indexESF(*(tmp.esf_), SavedIndexParams(path.string()+"/esf.idx")));
-        tmp.esf_idx_ -> buildIndex();
+        Eigen::Matrix4f transform (Eigen::Matrix4f::Identity());
+        transform.topLeftCorner<3,3>() = Eigen::Quaternionf (clouds[i].orientation[0], clouds[i].orientation[1],
+            clouds[i].orientation[2], clouds[i].orientation[3]).toRotationMatrix();
+        transform.topRightCorner<3,1>() = Eigen::Vector3f (clouds[i].origin[0], clouds[i].origin[1], clouds[i].origin[2]);
+        float* row = (*tmp.frames_)[i];
+        Eigen::Map<Eigen::Matrix<float,4,4,Eigen::RowMajor> > row_transform (row);
+        row_transform = transform;
+        Eigen::Map<Eigen::Vector3f> (row + 16) = Eigen::Vector3f (clouds[i].centroid[0], clouds[i].centroid[1], clouds[i].centroid[2]);
       }
-      catch (...)
+    }
+    timings.clouds = t.getTime();
+    t.reset();
+    tmp.cvfh_offsets_.assign(cvfh_off, cvfh_off + n+1);
+    tmp.ourcvfh_offsets_.assign(ourcvfh_off, ourcvfh_off + n+1);
+    for (const auto offsets: {&tmp.cvfh_offsets_, &tmp.ourcvfh_offsets_})
+    {
+      const uint64_t rows = (offsets == &tmp.cvfh_offsets_) ? h.rows[2] : h.rows[3];
+      valid = valid && offsets->front() == 0 && offsets->back() <= rows;
+      for (size_t i=1; i<offsets->size() && valid; ++i)
+        valid = (*offsets)[i] >= (*offsets)[i-1];
+    }
+    if (!valid)
+    {
+      print_error("%*s]\t%s has corrupted cluster offsets, try recreating database\n",20,__func__,path.string().c_str());
+      return false;
+    }
+    timings.lists = t.getTime();
+    t.reset();
+    try
+    {
+      tmp.vfh_idx_ = deserializeIndex<indexVFH> (map, *tmp.vfh_, base + h.offset[vfh_idx_sec], h.size[vfh_idx_sec]);
+      tmp.esf_idx_ = deserializeIndex<indexESF> (map, *tmp.esf_, base + h.offset[esf_idx_sec], h.size[esf_idx_sec]);
+    }
+    catch (...)
+    {
+      print_error("%*s]\tError loading FLANN indices from %s, try recreating database\n",20,__func__,path.string().c_str());
+      return false;
+    }
+    timings.indices = t.getTime();
+    tmp.db_path_ = path;
+    this->last_loaded_ = path;
+    target = std::move(tmp);
+    timings.total = timer.getTime();
+    timings_ = timings;
+    return true;
+  }
+
+  bool
+  DatabaseReader::load (boost::filesystem::path path, Database& target)
+  {
+    if (boost::filesystem::is_regular_file(path))
+      return loadSingleFile(path, target);
+    if ( isValidDatabasePath(path) )
+    {
+      boost::filesystem::path Pclouds(path.string()+"/Clouds");
+      std::vector<boost::filesystem::path> pvec;
+      copy (boost::filesystem::directory_iterator(Pclouds), boost::filesystem::directory_iterator(), back_inserter(pvec));
+      if (pvec.size() <= 0)
       {
-        print_error("%*s]\tError loading ESF index, file is likely corrupted, try recreating database...\n",20,__func__);
+        print_error("%*s]\tNo files in Clouds directory of database, cannot load poses, aborting...\n",20,__func__);
         return false;
       }
-      try
+      sort (pvec.begin(), pvec.end());
+      Database tmp;
+      //with lazy clouds nobody decodes them now, they are paged in by the cache
+      const int size = (cloud_budget_ > 0) ? 0 : pvec.size();
+      tmp.clouds_.resize(size);
+      pcl::StopWatch timer;
+      timer.reset();
+      timings_ = LoadTimings();
+      //Histograms, indices and lists are loaded by one thread (HDF5 is not thread safe), while clouds are decoded by all others
+      const char* func = __func__;
+      auto load_features = [&]() -> bool
       {
-        std::ifstream file ((path.string()+"/names.list").c_str());
-        std::string line;
-        if (file.is_open())
+        pcl::StopWatch t;
+        t.reset();
+        try
+        {
+          tmp.vfh_.reset(new histograms);
+          flann::load_from_file (*(tmp.vfh_), path.string() + "/vfh.h5", "VFH Histograms");
+        }
+        catch (...)
+        {
+          print_error("%*s]\tError loading VFH histograms, file is likely corrupted, try recreating database...\n",20,func);
+          return false;
+        }
+        try
+        {
+          tmp.esf_.reset(new histograms);
+          flann::load_from_file (*(tmp.esf_), path.string() + "/esf.h5", "ESF Histograms");
+        }
+        catch (...)
+        {
+          print_error("%*s]\tError loading ESF histograms, file is likely corrupted, try recreating database...\n",20,func);
+          return false;
+        }
+        try
+        {
+          tmp.cvfh_.reset(new histograms);
+          flann::load_from_file (*(tmp.cvfh_), path.string() + "/cvfh.h5", "CVFH Histograms");
+        }
+        catch (...)
+        {
+          print_error("%*s]\tError loading CVFH histograms, file is likely corrupted, try recreating database...\n",20,func);
+          return false;
+        }
+        try
+        {
+          tmp.ourcvfh_.reset(new histograms);
+          flann::load_from_file (*(tmp.ourcvfh_), path.string() + "/ourcvfh.h5", "OURCVFH Histograms");
+        }
+        catch (...)
+        {
+          print_error("%*s]\tError loading OURCVFH histograms, file is likely corrupted, try recreating database...\n",20,func);
+          return false;
+        }
+        //sensor frames are optional, older databases do not have them
+        if (boost::filesystem::is_regular_file(path.string() + "/frames.h5"))
         {
-          while (getline (file, line))
+          try
           {
-            boost::trim(line); //remove white spaces from line
-            tmp.names_.push_back(line);
-          }//end of file
+            boost::shared_ptr<histograms> frames (new histograms);
+            flann::load_from_file (*frames, path.string() + "/frames.h5", "Sensor Frames");
+            if (frames->rows == tmp.vfh_->rows && frames->cols == Database::frame_cols_)
+              tmp.frames_ = frames;
+            else
+              print_warn("%*s]\tframes.h5 does not match histograms, sensor frames will be computed from clouds\n",20,func);
+          }
+          catch (...)
+          {
+            print_warn("%*s]\tError loading sensor frames, they will be computed from clouds\n",20,func);
+          }
         }
-        else
+        timings_.histograms = t.getTime();
+        t.reset();
+        try
         {
-          print_error("%*s]\tError opening names.list, file is likely corrupted, try recreating database\n",20,__func__);
+          tmp.vfh_idx_.reset(new indexVFH(*(tmp.vfh_), SavedIndexParams(path.string()+"/vfh.idx")));
+          tmp.vfh_idx_ ->buildIndex();
+        }
+        catch (...)
+        {
+          print_error("%*s]\tError loading VFH index, file is likely corrupted, try recreating database...\n",20,func);
           return false;
         }
-      }
-      catch (...)
-      {
-        print_error("%*s]\tError loading names.list, file is likely corrupted, try recreating database\n",20,__func__);
-        return false;
-      }
-      try
-      {
-        std::ifstream file ((path.string()+"/names.cvfh").c_str());
-        std::string line;
-        if (file.is_open())
+        try
+        {
+          tmp.esf_idx_.reset(new indexESF(*(tmp.esf_), SavedIndexParams(path.string()+"/esf.idx")));
+          tmp.esf_idx_ -> buildIndex();
+        }
+        catch (...)
+        {
+          print_error("%*s]\tError loading ESF index, file is likely corrupted, try recreating database...\n",20,func);
+          return false;
+        }
+        timings_.indices = t.getTime();
+        t.reset();
+        try
         {
-          while (getline (file, line))
+          std::ifstream file ((path.string()+"/names.list").c_str());
+          std::string line;
+          if (file.is_open())
           {
-            boost::trim(line); //remove white spaces from line
-            tmp.names_cvfh_.push_back(line);
-          }//end of file
+            while (getline (file, line))
+            {
+              boost::trim(line); //remove white spaces from line
+              tmp.names_.push_back(line);
+            }//end of file
+          }
+          else
+          {
+            print_error("%*s]\tError opening names.list, file is likely corrupted, try recreating database\n",20,func);
+            return false;
+          }
         }
-        else
+        catch (...)
         {
-          print_error("%*s]\tError opening names.cvfh, file is likely corrupted, try recreating database\n",20,__func__);
+          print_error("%*s]\tError loading names.list, file is likely corrupted, try recreating database\n",20,func);
           return false;
         }
-      }
-      catch (...)
-      {
-        print_error("%*s]\tError loading names.cvfh, file is likely corrupted, try recreating database\n",20,__func__);
-        return false;
-      }
-      try
+        if (!loadClusterOffsets(path, "cvfh", tmp.names_, tmp.cvfh_->rows, tmp.cvfh_offsets_))
+        {
+          print_error("%*s]\tError loading CVFH cluster offsets, try recreating database\n",20,func);
+          return false;
+        }
+        if (!loadClusterOffsets(path, "ourcvfh", tmp.names_, tmp.ourcvfh_->rows, tmp.ourcvfh_offsets_))
+        {
+          print_error("%*s]\tError loading OURCVFH cluster offsets, try recreating database\n",20,func);
+          return false;
+        }
+        timings_.lists = t.getTime();
+        return true;
+      };
+      bool features_ok (false);
+      double clouds_begin (std::numeric_limits<double>::max()), clouds_end (0);
+      const int threads = resolveNumberOfThreads(threads_);
+#ifdef _OPENMP
+#pragma omp parallel num_threads(threads)
+#endif
       {
-        std::ifstream file ((path.string()+"/names.ourcvfh").c_str());
-        std::string line;
-        if (file.is_open())
+        double first (std::numeric_limits<double>::max()), last (0);
+#ifdef _OPENMP
+#pragma omp single nowait
+#endif
+        features_ok = load_features();
+        //whoever ends the features joins the others on clouds, order is kept by writing each cloud in its own slot
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic,1) nowait
+#endif
+        for (int i=0; i<size; ++i)
         {
-          while (getline (file, line))
+          const boost::filesystem::path& file = pvec[i];
+          first = std::min(first, timer.getTime());
+          PtC::Ptr cloud (new PtC);
+          tmp.clouds_[i] = cloud;
+          if (boost::filesystem::is_regular_file(file) && boost::filesystem::extension(file)==".pcd" )
+          {
+            if (pcl::io::loadPCDFile (file.string(),*cloud)!=0)
+            {
+#ifdef _OPENMP
+#pragma omp critical (pel_reader_print)
+#endif
+              print_warn("%*s]\tError loading PCD file number %d, name %s, skipping...\n",20,__func__,i+1,file.string().c_str());
+              continue;
+            }
+            last = timer.getTime();
+            if (cloud->points.size() <= 0)
+            {
+#ifdef _OPENMP
+#pragma omp critical (pel_reader_print)
+#endif
+              print_warn("%*s]\tLoaded PCD file number %d, name %s has ZERO points!! Are you loading the correct files?\n",20,__func__,i+1,file.string().c_str());
+            }
+          }
+          else
           {
-            boost::trim(line); //remove white spaces from line
-            tmp.names_ourcvfh_.push_back(line);
-          }//end of file
+#ifdef _OPENMP
+#pragma omp critical (pel_reader_print)
+#endif
+            print_warn("%*s]\t%s is not a PCD file, skipping...\n",20,__func__,file.string().c_str());
+            continue;
+          }
         }
-        else
+        //clouds phase goes from the first cloud started to the last one decoded, among all threads
+#ifdef _OPENMP
+#pragma omp critical (pel_reader_time)
+#endif
         {
-          print_error("%*s]\tError opening names.ourcvfh, file is likely corrupted, try recreating database\n",20,__func__);
-          return false;
+          clouds_begin = std::min(clouds_begin, first);
+          clouds_end = std::max(clouds_end, last);
         }
       }
-      catch (...)
-      {
-        print_error("%*s]\tError loading names.ourcvfh, file is likely corrupted, try recreating database\n",20,__func__);
+      timings_.clouds = std::max(0.0, clouds_end - clouds_begin);
+      timings_.total = timer.getTime();
+      if (!features_ok)
         return false;
+      if (cloud_budget_ > 0)
+      {
+        std::vector<boost::filesystem::path> files (pvec);
+        tmp.cloud_cache_.reset(new CloudCache([files](size_t i) { return cloudFromPCD(files[i]); }, files.size(), cloud_budget_));
+        //trees keep their clouds alive, keep them within the same budget
+        tmp.trees_.reset(new SearchTreeCache(cloud_budget_));
       }
       tmp.db_path_ = path;
       this->last_loaded_ = path;
@@ -242,6 +639,81 @@ namespace pel
       return Database();
   }
 
+  namespace
+  {
+    ///Remove a regular file if it exists
+    void
+    removeFile (const boost::filesystem::path& file)
+    {
+      if (boost::filesystem::exists(file) && boost::filesystem::is_regular_file(file))
+        boost::filesystem::remove (file);
+    }
+
+    /**\brief Write everything of a directory database but clouds: lists, offsets, histograms, indices and info.
+     * Existing files are replaced, HDF5 ones are removed first since FLANN refuses to overwrite a dataset.
+     */
+    bool
+    writeTables (const boost::filesystem::path& path, const Database& db, const char* func)
+    {
+      const std::vector<std::string> db_names = db.getDatabaseNames();
+      const std::vector<size_t>& cvfh_off = db.getDatabaseOffsetsCVFH();
+      const std::vector<size_t>& ourcvfh_off = db.getDatabaseOffsetsOURCVFH();
+      std::ofstream names, c_cvfh, c_ourcvfh, o_cvfh, o_ourcvfh, info;
+      names.open((path.string()+ "/names.list").c_str());
+      c_cvfh.open((path.string()+ "/names.cvfh").c_str());
+      c_ourcvfh.open((path.string()+ "/names.ourcvfh").c_str());
+      o_cvfh.open((path.string()+ "/offsets.cvfh").c_str());
+      o_ourcvfh.open((path.string()+ "/offsets.ourcvfh").c_str());
+      o_cvfh << cvfh_off[0] <<std::endl;
+      o_ourcvfh << ourcvfh_off[0] <<std::endl;
+      for (size_t i=0; i< db_names.size(); ++i)
+      {
+        names << db_names[i] <<std::endl;
+        o_cvfh << cvfh_off[i+1] <<std::endl;
+        o_ourcvfh << ourcvfh_off[i+1] <<std::endl;
+        //names.cvfh and names.ourcvfh have one line per cluster, kept for older versions of PEL
+        for (size_t n=cvfh_off[i]; n<cvfh_off[i+1]; ++n)
+          c_cvfh << db_names[i] <<std::endl;
+        for (size_t n=ourcvfh_off[i]; n<ourcvfh_off[i+1]; ++n)
+          c_ourcvfh << db_names[i] <<std::endl;
+      }
+      names.close();
+      c_cvfh.close();
+      c_ourcvfh.close();
+      o_cvfh.close();
+      o_ourcvfh.close();
+      if (!names || !c_cvfh || !c_ourcvfh || !o_cvfh || !o_ourcvfh)
+      {
+        print_error("%*s]\tError writing lists to disk, aborting...\n",20,func);
+        return false;
+      }
+      try
+      {
+        for (const auto& file: {"/vfh.h5", "/esf.h5", "/cvfh.h5", "/ourcvfh.h5", "/frames.h5", "/vfh.idx", "/esf.idx"})
+          removeFile (path.string() + file);
+        flann::save_to_file (*(db.getDatabaseVFH()), path.string() + "/vfh.h5", "VFH Histograms");
+        flann::save_to_file (*(db.getDatabaseESF()), path.string() + "/esf.h5", "ESF Histograms");
+        flann::save_to_file (*(db.getDatabaseCVFH()), path.string() + "/cvfh.h5", "CVFH Histograms");
+        flann::save_to_file (*(db.getDatabaseOURCVFH()), path.string() + "/ourcvfh.h5", "OURCVFH Histograms");
+        if (db.getDatabaseFrames())
+          flann::save_to_file (*(db.getDatabaseFrames()), path.string() + "/frames.h5", "Sensor Frames");
+        db.getDatabaseIndexVFH()->save ( path.string() + "/vfh.idx");
+        db.getDatabaseIndexESF()->save ( path.string() + "/esf.idx");
+      }
+      catch (...)
+      {
+        print_error("%*s]\tError writing histograms or indices to disk, aborting...\n",20,func);
+        return false;
+      }
+      info.open( (path.string() + "/created.info").c_str() );
+      timestamp t(TIME_NOW);
+      info << "Database created on "<<to_simple_string(t).c_str()<<std::endl;
+      info << "Contains "<<db_names.size()<<" poses.";
+      info << "Saved on path "<<path.string().c_str()<<" by DatabaseWriter::"<<func<<std::endl;
+      return true;
+    }
+  }
+
   bool
   DatabaseWriter::save (boost::filesystem::path path, const Database& db, bool overwrite)
   {
@@ -250,6 +722,13 @@ namespace pel
       print_warn("%*s]\tPassed Database is invalid or empty, not saving it...\n",20,__func__);
       return false;
     }
+    if (db.getNumberOfRemovedPoses() > 0)
+    {
+      //Removed poses are never written, save a compacted copy
+      Database compacted (db);
+      compacted.compact();
+      return (save (path, compacted, overwrite));
+    }
     if ( (!boost::filesystem::exists (path) && !boost::filesystem::is_directory(path)) ||
         (boost::filesystem::exists (path) && boost::filesystem::is_regular_file (path)) )
     {
@@ -286,6 +765,10 @@ namespace pel
           boost::filesystem::remove (path.string()+ "/names.cvfh");
         if (boost::filesystem::exists(path.string() + "/names.ourcvfh") && boost::filesystem::is_regular_file(path.string()+ "/names.ourcvfh"))
           boost::filesystem::remove (path.string()+ "/names.ourcvfh");
+        if (boost::filesystem::exists(path.string() + "/offsets.cvfh") && boost::filesystem::is_regular_file(path.string()+ "/offsets.cvfh"))
+          boost::filesystem::remove (path.string()+ "/offsets.cvfh");
+        if (boost::filesystem::exists(path.string() + "/offsets.ourcvfh") && boost::filesystem::is_regular_file(path.string()+ "/offsets.ourcvfh"))
+          boost::filesystem::remove (path.string()+ "/offsets.ourcvfh");
         if (boost::filesystem::exists(path.string() + "/Clouds") && boost::filesystem::is_directory(path.string()+ "/Clouds"))
         {
           boost::filesystem::remove_all(path.string() + "/Clouds");
@@ -299,6 +782,8 @@ namespace pel
           boost::filesystem::remove (path.string()+ "/cvfh.h5");
         if (boost::filesystem::exists(path.string() + "/ourcvfh.h5") && boost::filesystem::is_regular_file(path.string()+ "/ourcvfh.h5"))
           boost::filesystem::remove (path.string()+ "/ourcvfh.h5");
+        if (boost::filesystem::exists(path.string() + "/frames.h5") && boost::filesystem::is_regular_file(path.string()+ "/frames.h5"))
+          boost::filesystem::remove (path.string()+ "/frames.h5");
         if (boost::filesystem::exists(path.string() + "/vfh.idx") && boost::filesystem::is_regular_file(path.string()+ "/vfh.idx"))
           boost::filesystem::remove (path.string()+ "/vfh.idx");
         if (boost::filesystem::exists(path.string() + "/esf.idx") && boost::filesystem::is_regular_file(path.string()+ "/esf.idx"))
@@ -308,18 +793,12 @@ namespace pel
       }
     }
     pcl::PCDWriter writer;
-    std::ofstream names, c_cvfh, c_ourcvfh, info;
-    names.open((path.string()+ "/names.list").c_str());
-    c_cvfh.open((path.string()+ "/names.cvfh").c_str());
-    c_ourcvfh.open((path.string()+ "/names.ourcvfh").c_str());
-    for (size_t i=0; i< db.names_.size(); ++i)
+    const std::vector<std::string> names = db.getDatabaseNames();
+    for (size_t i=0; i< names.size(); ++i)
     {
       try
       {
-        writer.writeBinaryCompressed(path.string() + "/Clouds/" + db.names_[i] + ".pcd", db.clouds_[i]);
-        names << db.names_[i] <<std::endl;
-        c_cvfh << db.names_cvfh_[i] <<std::endl;
-        c_ourcvfh << db.names_ourcvfh_[i] <<std::endl;
+        writer.writeBinaryCompressed(path.string() + "/Clouds/" + names[i] + ".pcd", *db.getDatabaseCloud(i));
       }
       catch (...)
       {
@@ -327,21 +806,239 @@ namespace pel
         return false;
       }
     }
-    names.close();
-    c_cvfh.close();
-    c_ourcvfh.close();
-    flann::save_to_file (*(db.vfh_), path.string() + "/vfh.h5", "VFH Histograms");
-    flann::save_to_file (*(db.esf_), path.string() + "/esf.h5", "ESF Histograms");
-    flann::save_to_file (*(db.cvfh_), path.string() + "/cvfh.h5", "CVFH Histograms");
-    flann::save_to_file (*(db.ourcvfh_), path.string() + "/ourcvfh.h5", "OURCVFH Histograms");
-    db.vfh_idx_->save ( path.string() + "/vfh.idx");
-    db.esf_idx_->save ( path.string() + "/esf.idx");
-    info.open( (path.string() + "/created.info").c_str() );
-    timestamp t(TIME_NOW);
-    info << "Database created on "<<to_simple_string(t).c_str()<<std::endl;
-    info << "Contains "<<db.names_.size()<<" poses.";
-    info << "Saved on path "<<path.string().c_str()<<" by DatabaseWriter::save"<<std::endl;
-    print_info("%*s]\tDone saving database, %d poses written to disk\n",20,__func__,db.names_.size());
+    if (!writeTables(path, db, __func__))
+      return false;
+    print_info("%*s]\tDone saving database, %d poses written to disk\n",20,__func__,(int)names.size());
+    return true;
+  }
+
+  bool
+  DatabaseWriter::update (boost::filesystem::path path, const Database& db)
+  {
+    if (db.isEmpty())
+    {
+      print_warn("%*s]\tPassed Database is invalid or empty, not saving it...\n",20,__func__);
+      return false;
+    }
+    if (db.getNumberOfRemovedPoses() > 0)
+    {
+      //Removed poses are never written, save a compacted copy
+      Database compacted (db);
+      compacted.compact();
+      return (update (path, compacted));
+    }
+    if (!isValidDatabasePath(path))
+    {
+      print_error("%*s]\t%s does not contain a valid database to update, use save instead. aborting...\n",20,__func__,path.string().c_str());
+      return false;
+    }
+    std::vector<std::string> saved;
+    if (!readList(path.string() + "/names.list", saved))
+    {
+      print_error("%*s]\tError reading %s/names.list, aborting...\n",20,__func__,path.string().c_str());
+      return false;
+    }
+    const std::vector<std::string> names = db.getDatabaseNames();
+    //Saved histograms tell whether a pose on disk is the same as the one in db: a pose removed and added again
+    //under the same name has different histograms and its cloud must be rewritten
+    histograms saved_vfh, saved_esf;
+    try
+    {
+      flann::load_from_file (saved_vfh, path.string() + "/vfh.h5", "VFH Histograms");
+      flann::load_from_file (saved_esf, path.string() + "/esf.h5", "ESF Histograms");
+    }
+    catch (...)
+    {
+      print_warn("%*s]\tError loading saved histograms, rewriting all clouds...\n",20,__func__);
+    }
+    const histograms& vfh = *db.getDatabaseVFH();
+    const histograms& esf = *db.getDatabaseESF();
+    const bool comparable (saved_vfh.rows == saved.size() && saved_esf.rows == saved.size() &&
+        saved_vfh.cols == vfh.cols && saved_esf.cols == esf.cols);
+    std::unordered_map<std::string, size_t> on_disk;
+    if (comparable)
+      for (size_t j=0; j< saved.size(); ++j)
+        on_disk[saved[j]] = j;
+    std::unordered_set<std::string> current (names.begin(), names.end());
+    pcl::PCDWriter writer;
+    size_t written (0), removed (0);
+    for (size_t i=0; i< names.size(); ++i)
+    {
+      const boost::filesystem::path file (path.string() + "/Clouds/" + names[i] + ".pcd");
+      const auto found = on_disk.find(names[i]);
+      if (found != on_disk.end() && boost::filesystem::is_regular_file(file) &&
+          std::equal (vfh[i], vfh[i] + vfh.cols, saved_vfh[found->second]) &&
+          std::equal (esf[i], esf[i] + esf.cols, saved_esf[found->second]))
+        continue;
+      try
+      {
+        writer.writeBinaryCompressed(file.string(), *db.getDatabaseCloud(i));
+        ++written;
+      }
+      catch (...)
+      {
+        print_error("%*s]\tError writing to disk, aborting...\n",20,__func__);
+        delete[] saved_vfh.ptr();
+        delete[] saved_esf.ptr();
+        return false;
+      }
+    }
+    delete[] saved_vfh.ptr();
+    delete[] saved_esf.ptr();
+    for (const auto& name : saved)
+      if (!current.count(name))
+      {
+        boost::filesystem::remove (path.string() + "/Clouds/" + name + ".pcd");
+        ++removed;
+      }
+    if (!writeTables(path, db, __func__))
+      return false;
+    print_info("%*s]\tDone updating database, %d poses written, %d removed, %d total\n",20,__func__,(int)written,(int)removed,(int)names.size());
+    return true;
+  }
+
+  bool
+  DatabaseWriter::saveSingleFile (boost::filesystem::path path, const Database& db, bool overwrite)
+  {
+    if (db.isEmpty())
+    {
+      print_warn("%*s]\tPassed Database is invalid or empty, not saving it...\n",20,__func__);
+      return false;
+    }
+    if (db.getNumberOfRemovedPoses() > 0)
+    {
+      //Removed poses are never written, save a compacted copy
+      Database compacted (db);
+      compacted.compact();
+      return (saveSingleFile (path, compacted, overwrite));
+    }
+    if (boost::filesystem::exists(path))
+    {
+      if (!boost::filesystem::is_regular_file(path) || !overwrite)
+      {
+        print_error("%*s]\t%s already exists, not overwriting it. aborting...\n",20,__func__,path.string().c_str());
+        return false;
+      }
+      print_warn("%*s]\t%s already exists, overwriting it as requested.\n",20,__func__,path.string().c_str());
+    }
+    const uint64_t n = db.names_.size();
+    std::string vfh_blob, esf_blob;
+    if (!serializeIndex(*db.vfh_idx_, vfh_blob) || !serializeIndex(*db.esf_idx_, esf_blob))
+    {
+      print_error("%*s]\tError serializing FLANN indices, aborting...\n",20,__func__);
+      return false;
+    }
+    //Section contents that are not already contiguous in memory
+    std::vector<uint64_t> cvfh_off (db.cvfh_offsets_.begin(), db.cvfh_offsets_.end());
+    std::vector<uint64_t> ourcvfh_off (db.ourcvfh_offsets_.begin(), db.ourcvfh_offsets_.end());
+    std::vector<uint64_t> names_off (1, 0);
+    std::string names;
+    std::vector<FileCloud> clouds (n);
+    uint64_t points (0);
+    for (uint64_t i=0; i<n; ++i)
+    {
+      names += db.names_[i];
+      names_off.push_back(names.size());
+      PtC::ConstPtr cloud = db.getDatabaseCloud(i);
+      const PtC& c = *cloud;
+      std::memset (&clouds[i], 0, sizeof(FileCloud));
+      clouds[i].first_point = points;
+      clouds[i].width = c.points.size() == c.width * c.height ? c.width : c.points.size();
+      clouds[i].height = c.points.size() == c.width * c.height ? c.height : 1;
+      clouds[i].is_dense = c.is_dense;
+      for (int j=0; j<4; ++j)
+        clouds[i].origin[j] = c.sensor_origin_(j);
+      clouds[i].orientation[0] = c.sensor_orientation_.w();
+      clouds[i].orientation[1] = c.sensor_orientation_.x();
+      clouds[i].orientation[2] = c.sensor_orientation_.y();
+      clouds[i].orientation[3] = c.sensor_orientation_.z();
+      Eigen::Matrix4f transform;
+      Eigen::Vector3f centroid;
+      db.getSensorFrame(i, transform, centroid);
+      for (int j=0; j<3; ++j)
+        clouds[i].centroid[j] = centroid(j);
+      points += c.points.size();
+    }
+    //Layout
+    FileHeader h;
+    std::memset (&h, 0, sizeof(FileHeader));
+    std::memcpy (h.magic, file_magic, sizeof(file_magic));
+    h.version = file_version;
+    h.byte_order = file_byte_order;
+    h.poses = n;
+    h.points = points;
+    h.point_size = sizeof(Pt);
+    const histograms* hists[4] = {db.vfh_.get(), db.esf_.get(), db.cvfh_.get(), db.ourcvfh_.get()};
+    for (int i=0; i<4; ++i)
+    {
+      h.rows[i] = hists[i]->rows;
+      h.cols[i] = hists[i]->cols;
+      h.size[vfh_sec + i] = h.rows[i] * h.cols[i] * sizeof(float);
+    }
+    h.size[cvfh_offsets_sec] = cvfh_off.size() * sizeof(uint64_t);
+    h.size[ourcvfh_offsets_sec] = ourcvfh_off.size() * sizeof(uint64_t);
+    h.size[name_offsets_sec] = names_off.size() * sizeof(uint64_t);
+    h.size[names_sec] = names.size();
+    h.size[clouds_sec] = clouds.size() * sizeof(FileCloud);
+    h.size[points_sec] = points * sizeof(Pt);
+    h.size[vfh_idx_sec] = vfh_blob.size();
+    h.size[esf_idx_sec] = esf_blob.size();
+    uint64_t end = sizeof(FileHeader);
+    for (int i=0; i<sections; ++i)
+    {
+      h.offset[i] = (end + file_alignment -1) / file_alignment * file_alignment;
+      end = h.offset[i] + h.size[i];
+    }
+    //Write to a temporary file first, then rename it, so readers never see a partial database
+    boost::filesystem::path tmp_path (path.string() + ".tmp");
+    try
+    {
+      std::ofstream file (tmp_path.string().c_str(), std::ios::binary | std::ios::trunc);
+      if (!file.is_open())
+        throw std::runtime_error("Cannot open file");
+      //pad stream up to section i and return it
+      auto at = [&](const int i) -> std::ofstream&
+      {
+        const uint64_t pos = file.tellp();
+        if (pos < h.offset[i])
+          file.write (std::string(h.offset[i] - pos, '\0').data(), h.offset[i] - pos);
+        return file;
+      };
+      file.write (reinterpret_cast<const char*>(&h), sizeof(FileHeader));
+      for (int i=0; i<4; ++i)
+      {
+        at(vfh_sec + i);
+        for (size_t r=0; r<hists[i]->rows; ++r)
+          file.write (reinterpret_cast<const char*>((*hists[i])[r]), hists[i]->cols * sizeof(float));
+      }
+      at(cvfh_offsets_sec).write (reinterpret_cast<const char*>(cvfh_off.data()), h.size[cvfh_offsets_sec]);
+      at(ourcvfh_offsets_sec).write (reinterpret_cast<const char*>(ourcvfh_off.data()), h.size[ourcvfh_offsets_sec]);
+      at(name_offsets_sec).write (reinterpret_cast<const char*>(names_off.data()), h.size[name_offsets_sec]);
+      at(names_sec).write (names.data(), h.size[names_sec]);
+      at(clouds_sec).write (reinterpret_cast<const char*>(clouds.data()), h.size[clouds_sec]);
+      at(points_sec);
+      for (uint64_t i=0; i<n; ++i)
+      {
+        PtC::ConstPtr c = db.getDatabaseCloud(i);
+        if (!c->points.empty())
+          file.write (reinterpret_cast<const char*>(&c->points[0]), c->points.size() * sizeof(Pt));
+      }
+      at(vfh_idx_sec).write (vfh_blob.data(), vfh_blob.size());
+      at(esf_idx_sec).write (esf_blob.data(), esf_blob.size());
+      file.close();
+      if (!file)
+        throw std::runtime_error("Write failed");
+      boost::filesystem::rename (tmp_path, path);
+    }
+    catch (...)
+    {
+      boost::system::error_code ec;
+      boost::filesystem::remove (tmp_path, ec);
+      print_error("%*s]\tError writing to disk, aborting...\n",20,__func__);
+      return false;
+    }
+    last_saved_ = path;
+    print_info("%*s]\tDone saving database, %d poses written to %s\n",20,__func__,(int)n,path.string().c_str());
     return true;
   }
 }//End of namespace
@@ -0,0 +1,111 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *   Pose Estimation Library (PEL) - https://bitbucket.org/Tabjones/pose-estimation-library
+ *   Copyright (c) 2014-2015, Federico Spinelli (fspinelli@gmail.com)
+ *   All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of copyright holder(s) nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <pel/database/search_tree_cache.h>
+
+namespace pel
+{
+  SearchTreeCache::SearchTreeCache (const size_t budget) :
+    budget_(budget), resident_bytes_(0), hits_(0), misses_(0)
+  {
+  }
+
+  SearchTreeCache::Tree::Ptr
+  SearchTreeCache::get (const PtC::ConstPtr& cloud)
+  {
+    {
+      std::lock_guard<std::mutex> lock (mutex_);
+      auto it = trees_.find(cloud.get());
+      if (it != trees_.end())
+      {
+        ++hits_;
+        lru_.splice(lru_.begin(), lru_, it->second.lru); //now most recently used
+        return (it->second.tree);
+      }
+      ++misses_;
+    }
+    //build without holding the lock, so other trees can be served meanwhile
+    Tree::Ptr tree (new Tree);
+    tree->setInputCloud(cloud);
+    std::lock_guard<std::mutex> lock (mutex_);
+    auto it = trees_.find(cloud.get());
+    if (it != trees_.end())
+      return (it->second.tree); //someone else built it concurrently, use theirs
+    //the tree keeps the cloud alive, FLANN keeps a copy of coordinates and indices of points
+    Entry& e = trees_[cloud.get()];
+    e.tree = tree;
+    e.bytes = sizeof(Tree) + cloud->points.size() * (sizeof(Pt) + 4*sizeof(float));
+    lru_.push_front(cloud.get());
+    e.lru = lru_.begin();
+    resident_bytes_ += e.bytes;
+    //evict least recently used trees, but always keep the one just built
+    while (budget_ > 0 && resident_bytes_ > budget_ && lru_.size() > 1)
+    {
+      auto victim = trees_.find(lru_.back());
+      resident_bytes_ -= victim->second.bytes;
+      trees_.erase(victim);
+      lru_.pop_back();
+    }
+    return (tree);
+  }
+
+  void
+  SearchTreeCache::clear ()
+  {
+    std::lock_guard<std::mutex> lock (mutex_);
+    trees_.clear();
+    lru_.clear();
+    resident_bytes_ = 0;
+  }
+
+  size_t
+  SearchTreeCache::getResidentBytes () const
+  {
+    std::lock_guard<std::mutex> lock (mutex_);
+    return (resident_bytes_);
+  }
+
+  size_t
+  SearchTreeCache::getHits () const
+  {
+    std::lock_guard<std::mutex> lock (mutex_);
+    return (hits_);
+  }
+
+  size_t
+  SearchTreeCache::getMisses () const
+  {
+    std::lock_guard<std::mutex> lock (mutex_);
+    return (misses_);
+  }
+}
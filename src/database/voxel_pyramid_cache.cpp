@@ -0,0 +1,125 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *   Pose Estimation Library (PEL) - https://bitbucket.org/Tabjones/pose-estimation-library
+ *   Copyright (c) 2014-2015, Federico Spinelli (fspinelli@gmail.com)
+ *   All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of copyright holder(s) nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <pel/database/voxel_pyramid_cache.h>
+#include <pcl/filters/voxel_grid.h>
+
+namespace pel
+{
+  VoxelPyramidCache::VoxelPyramidCache (const float leaf, const size_t budget) :
+    leaf_(leaf), budget_(budget), resident_bytes_(0)
+  {
+  }
+
+  PtC::ConstPtr
+  VoxelPyramidCache::get (const PtC::ConstPtr& cloud, const unsigned int level)
+  {
+    if (level == 0)
+      return (cloud);
+    std::vector<PtC::ConstPtr> levels;
+    {
+      std::lock_guard<std::mutex> lock (mutex_);
+      auto it = pyramids_.find(cloud.get());
+      if (it != pyramids_.end())
+      {
+        lru_.splice(lru_.begin(), lru_, it->second.lru); //now most recently used
+        if (level < it->second.levels.size())
+          return (it->second.levels[level]);
+        levels = it->second.levels;
+      }
+      else
+        levels.push_back(cloud);
+    }
+    //build missing levels without holding the lock, each one from the previous
+    pcl::VoxelGrid<Pt> vg;
+    while (levels.size() <= level)
+    {
+      PtC::Ptr coarse (new PtC);
+      vg.setInputCloud(levels.back());
+      const float leaf = leaf_ * (1 << (levels.size() - 1));
+      vg.setLeafSize(leaf, leaf, leaf);
+      vg.filter(*coarse);
+      levels.push_back(coarse);
+    }
+    std::lock_guard<std::mutex> lock (mutex_);
+    auto it = pyramids_.find(cloud.get());
+    if (it == pyramids_.end())
+    {
+      //new pyramid (or evicted meanwhile), level 0 is accounted too, since the pyramid keeps it alive
+      it = pyramids_.emplace(cloud.get(), Entry()).first;
+      lru_.push_front(cloud.get());
+      it->second.lru = lru_.begin();
+      it->second.bytes = 0;
+    }
+    else
+      lru_.splice(lru_.begin(), lru_, it->second.lru);
+    Entry& e = it->second;
+    if (level < e.levels.size())
+      return (e.levels[level]); //someone else built it concurrently, use theirs
+    //account only the levels actually added, the first ones may be cached already
+    size_t bytes (0);
+    for (size_t l=e.levels.size(); l<levels.size(); ++l)
+    {
+      bytes += levels[l]->points.size() * sizeof(Pt);
+      e.levels.push_back(levels[l]);
+    }
+    e.bytes += bytes;
+    resident_bytes_ += bytes;
+    PtC::ConstPtr result = e.levels[level];
+    //evict least recently used pyramids, but always keep the one just built
+    while (budget_ > 0 && resident_bytes_ > budget_ && lru_.size() > 1)
+    {
+      auto victim = pyramids_.find(lru_.back());
+      resident_bytes_ -= victim->second.bytes;
+      pyramids_.erase(victim);
+      lru_.pop_back();
+    }
+    return (result);
+  }
+
+  void
+  VoxelPyramidCache::clear ()
+  {
+    std::lock_guard<std::mutex> lock (mutex_);
+    pyramids_.clear();
+    lru_.clear();
+    resident_bytes_ = 0;
+  }
+
+  size_t
+  VoxelPyramidCache::getResidentBytes () const
+  {
+    std::lock_guard<std::mutex> lock (mutex_);
+    return (resident_bytes_);
+  }
+}
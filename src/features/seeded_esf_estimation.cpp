@@ -0,0 +1,219 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *   Pose Estimation Library (PEL) - https://bitbucket.org/Tabjones/pose-estimation-library
+ *   Copyright (c) 2014-2015, Federico Spinelli (fspinelli@gmail.com)
+ *   All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder(s) nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <pel/features/seeded_esf_estimation.h>
+#include <pcl/common/centroid.h>
+#include <pcl/common/distances.h>
+#include <pcl/common/transforms.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace pel
+{
+  namespace
+  {
+    ///Half the side of the voxel grid of pcl::ESFEstimation (64 voxels)
+    const int grid_half = 32;
+    ///Number of bins of each of the ten ESF sub histograms
+    const int binsize = 64;
+    ///Number of point triplets sampled
+    const size_t sample_size = 20000;
+
+    //Voxel holding a coordinate of a cloud scaled into the grid
+    inline int
+    toVoxel (const float v)
+    {
+      return (v < 0.0f ? static_cast<int>(std::floor(v) + grid_half) : static_cast<int>(std::ceil(v) + grid_half - 1));
+    }
+
+    //Bin of a value in [0,1]
+    inline int
+    toBin (const float v)
+    {
+      return (static_cast<int>(pcl_round(v * (binsize-1))));
+    }
+  }
+
+  void
+  SeededESFEstimation::computeFeature (PointCloudOut& output)
+  {
+    //scale the surface into a sphere inscribed in the voxel grid, as pcl::ESFEstimation does
+    PointCloudIn cloud;
+    Eigen::Vector4f centroid;
+    pcl::compute3DCentroid (*surface_, centroid);
+    pcl::demeanPointCloud (*surface_, centroid, cloud);
+    float max_distance (0);
+    for (const auto& p : cloud.points)
+      max_distance = std::max(max_distance, p.getVector3fMap().norm());
+    Eigen::Affine3f scale (Eigen::Affine3f::Identity());
+    scale.scale(static_cast<float>(grid_half) / max_distance);
+    pcl::transformPointCloud (cloud, cloud, scale);
+    std::vector<float> hist;
+    this->voxelize9 (cloud);
+    this->computeSeededESF (cloud, hist);
+    this->cleanup9 (cloud);
+    output.points.resize (1);
+    output.width = 1;
+    output.height = 1;
+    for (size_t d = 0; d < hist.size (); ++d)
+      output.points[0].histogram[d] = hist[d];
+  }
+
+  void
+  SeededESFEstimation::computeSeededESF (PointCloudIn& pc, std::vector<float>& hist)
+  {
+    hist.assign (binsize * 10, 0.0f);
+    const int maxindex = static_cast<int> (pc.points.size ());
+    if (maxindex < 3)
+      return; //no triplet to sample
+    std::mt19937 rng (seed_);
+    std::vector<float> d2v, d3v, wt_d3;
+    std::vector<int> wt_d2;
+    d2v.reserve (sample_size * 3);
+    d3v.reserve (sample_size);
+    wt_d2.reserve (sample_size * 3);
+    wt_d3.reserve (sample_size);
+    float h_in[binsize] = {0}, h_out[binsize] = {0}, h_mix[binsize] = {0}, h_mix_ratio[binsize] = {0};
+    float h_a3_in[binsize] = {0}, h_a3_out[binsize] = {0}, h_a3_mix[binsize] = {0};
+    float h_d3_in[binsize] = {0}, h_d3_out[binsize] = {0}, h_d3_mix[binsize] = {0};
+    const float pih = static_cast<float>(M_PI) / 2.0f;
+    size_t sampled (0);
+    while (sampled < sample_size)
+    {
+      const int index1 = static_cast<int>(rng() % maxindex);
+      const int index2 = static_cast<int>(rng() % maxindex);
+      const int index3 = static_cast<int>(rng() % maxindex);
+      if (index1 == index2 || index1 == index3 || index2 == index3)
+        continue;
+      const Eigen::Vector4f p1 = pc.points[index1].getVector4fMap ();
+      const Eigen::Vector4f p2 = pc.points[index2].getVector4fMap ();
+      const Eigen::Vector4f p3 = pc.points[index3].getVector4fMap ();
+      //A3
+      Eigen::Vector4f v21 (p2 - p1), v31 (p3 - p1), v23 (p2 - p3);
+      const float a = v21.norm (), b = v31.norm (), c = v23.norm (), s = (a+b+c) * 0.5f;
+      if (s * (s-a) * (s-b) * (s-c) <= 0.001f)
+        continue;
+      v21.normalize ();
+      v31.normalize ();
+      v23.normalize ();
+      const int th1 = static_cast<int> (pcl_round (std::acos (std::fabs (v21.dot (v31))) / pih * (binsize-1)));
+      const int th2 = static_cast<int> (pcl_round (std::acos (std::fabs (v23.dot (v31))) / pih * (binsize-1)));
+      const int th3 = static_cast<int> (pcl_round (std::acos (std::fabs (v23.dot (v21))) / pih * (binsize-1)));
+      if (th1 < 0 || th1 >= binsize || th2 < 0 || th2 >= binsize || th3 < 0 || th3 >= binsize)
+        continue;
+      //D2
+      d2v.push_back (pcl::euclideanDistance (pc.points[index1], pc.points[index2]));
+      d2v.push_back (pcl::euclideanDistance (pc.points[index1], pc.points[index3]));
+      d2v.push_back (pcl::euclideanDistance (pc.points[index2], pc.points[index3]));
+      //IN, OUT, MIXED and ratio of the three lines, traced through the voxel grid
+      int vxlcnt_sum (0), p_cnt (0);
+      float ratio (0);
+      auto trace = [&](const Eigen::Vector4f& from, const Eigen::Vector4f& to, int& pcnt)
+      {
+        int vxlcnt (0);
+        wt_d2.push_back (this->lci (toVoxel(from[0]), toVoxel(from[1]), toVoxel(from[2]),
+              toVoxel(to[0]), toVoxel(to[1]), toVoxel(to[2]), ratio, vxlcnt, pcnt));
+        if (wt_d2.back () == 2)
+          h_mix_ratio[toBin(ratio)]++;
+        vxlcnt_sum += vxlcnt;
+        p_cnt += pcnt;
+      };
+      int pcnt1 (0), pcnt2 (0), pcnt3 (0);
+      trace (p1, p2, pcnt1);
+      trace (p1, p3, pcnt2);
+      trace (p2, p3, pcnt3);
+      //D3 (Heron's formula)
+      d3v.push_back (std::sqrt (std::sqrt (s * (s-a) * (s-b) * (s-c))));
+      if (vxlcnt_sum <= 21)
+      {
+        wt_d3.push_back (0);
+        h_a3_out[th1] += static_cast<float> (pcnt3) / 32.0f;
+        h_a3_out[th2] += static_cast<float> (pcnt1) / 32.0f;
+        h_a3_out[th3] += static_cast<float> (pcnt2) / 32.0f;
+      }
+      else if (p_cnt - vxlcnt_sum < 4)
+      {
+        h_a3_in[th1] += static_cast<float> (pcnt3) / 32.0f;
+        h_a3_in[th2] += static_cast<float> (pcnt1) / 32.0f;
+        h_a3_in[th3] += static_cast<float> (pcnt2) / 32.0f;
+        wt_d3.push_back (1);
+      }
+      else
+      {
+        h_a3_mix[th1] += static_cast<float> (pcnt3) / 32.0f;
+        h_a3_mix[th2] += static_cast<float> (pcnt1) / 32.0f;
+        h_a3_mix[th3] += static_cast<float> (pcnt2) / 32.0f;
+        wt_d3.push_back (static_cast<float> (vxlcnt_sum) / static_cast<float> (p_cnt));
+      }
+      ++sampled;
+    }
+    //normalize distances by their maximum and fill D2 and D3 histograms
+    const float maxd2 = *std::max_element (d2v.begin(), d2v.end());
+    const float maxd3 = *std::max_element (d3v.begin(), d3v.end());
+    for (size_t i = 0; i < sample_size; ++i)
+    {
+      const int index = toBin (d3v[i] / maxd3);
+      if (index < 0 || index >= binsize)
+        continue;
+      if (wt_d3[i] >= 0.999f)
+        h_d3_in[index]++;
+      else if (wt_d3[i] <= 0.001f)
+        h_d3_out[index]++;
+      else
+        h_d3_mix[index]++;
+    }
+    for (size_t i = 0; i < d2v.size(); ++i)
+    {
+      const int index = toBin (d2v[i] / maxd2);
+      if (wt_d2[i] == 0)
+        h_in[index]++;
+      else if (wt_d2[i] == 1)
+        h_out[index]++;
+      else if (wt_d2[i] == 2)
+        h_mix[index]++;
+    }
+    //same weights and order of sub histograms as pcl::ESFEstimation
+    const float weights[10] = {0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 1.0f, 1.0f, 2.0f, 2.0f, 2.0f};
+    const float* parts[10] = {h_a3_in, h_a3_out, h_a3_mix, h_d3_in, h_d3_out, h_d3_mix, h_in, h_out, h_mix, h_mix_ratio};
+    float sum (0);
+    for (int p = 0; p < 10; ++p)
+      for (int i = 0; i < binsize; ++i)
+      {
+        hist[p*binsize + i] = parts[p][i] * weights[p];
+        sum += hist[p*binsize + i];
+      }
+    for (auto& h : hist)
+      h /= sum;
+  }
+}
@@ -63,7 +63,12 @@ namespace pel
     params_["ourcvfh_axis_ratio"]=0.95;
     params_["ourcvfh_min_axis_value"]=0.01;
     params_["ourcvfh_refine_clusters"]=1;
+    params_["cascade"]=0;
+    params_["cascade_top"]=5;
+    params_["cascade_agreement"]=0.6;
+    params_["cascade_margin"]=0.1;
     size_of_valid_params_ = params_.size();
+    commit();
   }
 
   void
@@ -118,6 +123,51 @@ namespace pel
     checkAndFixMinParam("ourcvfh_axis_ratio", 0.0001);
     checkAndFixMinParam("ourcvfh_min_axis_value", 0.0001);
     checkAndFixMinMaxParam("ourcvfh_refine_clusters", 0, 1);
+    checkAndFixMinMaxParam("cascade", 0, 1);
+    checkAndFixMinParam("cascade_top", 1);
+    checkAndFixMinMaxParam("cascade_agreement", 0, 1);
+    checkAndFixMinMaxParam("cascade_margin", 0, 1);
+  }
+
+  void
+  ParamHandler::commit ()
+  {
+    fixParameters();
+    Config c;
+    c.verbosity = params_.at("verbosity");
+    c.use_vfh = params_.at("use_vfh") > 0;
+    c.use_esf = params_.at("use_esf") > 0;
+    c.use_cvfh = params_.at("use_cvfh") > 0;
+    c.use_ourcvfh = params_.at("use_ourcvfh") > 0;
+    c.filter = params_.at("filter") > 0;
+    c.filter_mean_k = params_.at("filter_mean_k");
+    c.filter_std_dev_mul_thresh = params_.at("filter_std_dev_mul_thresh");
+    c.upsamp = params_.at("upsamp") > 0;
+    c.upsamp_poly_order = params_.at("upsamp_poly_order");
+    c.upsamp_point_density = params_.at("upsamp_point_density");
+    c.upsamp_poly_fit = params_.at("upsamp_poly_fit") > 0;
+    c.upsamp_search_radius = params_.at("upsamp_search_radius");
+    c.downsamp = params_.at("downsamp") > 0;
+    c.downsamp_leaf_size = params_.at("downsamp_leaf_size");
+    c.lists_size = params_.at("lists_size");
+    c.normals_radius_search = params_.at("normals_radius_search");
+    c.cvfh_ang_thresh = params_.at("cvfh_ang_thresh");
+    c.cvfh_curv_thresh = params_.at("cvfh_curv_thresh");
+    c.cvfh_clus_tol = params_.at("cvfh_clus_tol");
+    c.cvfh_clus_min_points = params_.at("cvfh_clus_min_points");
+    c.ourcvfh_ang_thresh = params_.at("ourcvfh_ang_thresh");
+    c.ourcvfh_curv_thresh = params_.at("ourcvfh_curv_thresh");
+    c.ourcvfh_clus_tol = params_.at("ourcvfh_clus_tol");
+    c.ourcvfh_clus_min_points = params_.at("ourcvfh_clus_min_points");
+    c.ourcvfh_axis_ratio = params_.at("ourcvfh_axis_ratio");
+    c.ourcvfh_min_axis_value = params_.at("ourcvfh_min_axis_value");
+    c.ourcvfh_refine_clusters = params_.at("ourcvfh_refine_clusters");
+    c.cascade = params_.at("cascade") > 0;
+    c.cascade_top = params_.at("cascade_top");
+    c.cascade_agreement = params_.at("cascade_agreement");
+    c.cascade_margin = params_.at("cascade_margin");
+    config_ = c;
+    pending_ = false;
   }
 
   bool
@@ -142,6 +192,7 @@ namespace pel
     }
     else if (verb_level > 1)
       print_info("%*s]\tSetting parameter: %s=%g\n",20,__func__,key.c_str(),value);
+    pending_ = true;
     return true;
   }
 
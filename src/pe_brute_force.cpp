@@ -36,6 +36,11 @@
 #include <pcl/common/eigen.h>
 #include <pcl/common/common.h>
 #include <pcl/common/time.h>
+#include <atomic>
+#include <limits>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace pcl::console;
 
@@ -48,19 +53,57 @@ namespace pel
       te_dq_.reset(new pcl::registration::TransformationEstimationDualQuaternion<Pt,Pt,float>);
       te_lm_.reset(new pcl::registration::TransformationEstimationLM<Pt,Pt,float>);
       te_svd_.reset(new pcl::registration::TransformationEstimationSVD<Pt,Pt,float>);
+      te_ptp_.reset(new PointToPlaneEstimation);
       icp_.setUseReciprocalCorrespondences(true);
       icp_.setMaximumIterations (100);
       icp_.setTransformationEpsilon (1e-9);
       icp_.setEuclideanFitnessEpsilon (std::pow(0.005,2));
       icp_.setTransformationEstimation(te_dq_);
+      te_type_ = TransformationType::dq;
+      threads_ = 1;
       RMSE_thresh_ = 0.005;
     }
 
+    void
+    PEBruteForce::initWorkers (std::vector<PoseICP::Ptr>& workers, const int size) const
+    {
+      workers.resize(size);
+      //normals are only read by point to plane estimations, all workers share one copy
+      PointToPlaneEstimation::Normals::ConstPtr normals;
+      if (te_type_ == TransformationType::point_to_plane)
+        normals = target_normals.makeShared();
+      for (auto& w: workers)
+      {
+        w.reset(new PoseICP);
+        w->setUseReciprocalCorrespondences(icp_.getUseReciprocalCorrespondences());
+        w->setMaximumIterations(icp_.getMaximumIterations());
+        w->setTransformationEpsilon(icp_.getTransformationEpsilon());
+        w->setEuclideanFitnessEpsilon(icp_.getEuclideanFitnessEpsilon());
+        //transformation estimations keep internal state while aligning, they cannot be shared among threads
+        if (te_type_ == TransformationType::lm)
+          w->setTransformationEstimation(pcl::registration::TransformationEstimationLM<Pt,Pt,float>::Ptr
+              (new pcl::registration::TransformationEstimationLM<Pt,Pt,float>));
+        else if (te_type_ == TransformationType::svd)
+          w->setTransformationEstimation(pcl::registration::TransformationEstimationSVD<Pt,Pt,float>::Ptr
+              (new pcl::registration::TransformationEstimationSVD<Pt,Pt,float>));
+        else if (te_type_ == TransformationType::point_to_plane)
+          w->setTransformationEstimation(PointToPlaneEstimation::Ptr (new PointToPlaneEstimation (normals)));
+        else
+          w->setTransformationEstimation(pcl::registration::TransformationEstimationDualQuaternion<Pt,Pt,float>::Ptr
+              (new pcl::registration::TransformationEstimationDualQuaternion<Pt,Pt,float>));
+        //reciprocal correspondences search the cached trees of Database poses
+        w->setCorrespondenceEstimation(PoseCorrespondenceEstimation::Ptr (new PoseCorrespondenceEstimation));
+        w->setInputTarget(target_cloud_processed);
+        w->setSearchMethodTarget(target_tree, true); //target never moves, its tree is built once in initTarget
+      }
+    }
+
     void
     PEBruteForce::estimate(Candidate& estimation)
     {
       pcl::StopWatch timer;
       timer.reset();
+      stats_.clearEstimation();
       if (this->generateLists())
       {
         pcl::CentroidPoint<Pt> target_cen_est;
@@ -69,79 +112,120 @@ namespace pel
         Pt target_centroid;
         target_cen_est.get(target_centroid);
         //BruteForce Procedure
-        if (getParam("verbosity")>1)
-          print_info("%*s]\tStarting Brute Force...\n",20,__func__);
-        icp_.setInputTarget(target_cloud_processed);
-        for (auto& x: composite_list)
+        int threads = resolveNumberOfThreads(threads_);
+        if (config_.verbosity>1)
+          print_info("%*s]\tStarting Brute Force with %d thread(s)...\n",20,__func__,threads);
+        std::vector<PoseICP::Ptr> workers;
+        if (te_type_ == TransformationType::point_to_plane)
+          computeMissingNormals();
+        initWorkers(workers, threads);
+        const int size = composite_list.size();
+        //Index of the best ranked Candidate converged so far, Candidates ranked after it are cancelled
+        std::atomic<int> winner (size);
+        //ICP statistics of each Candidate, those skipped before aligning are left untried
+        std::vector<PipelineStats::CandidateICP> icp_stats (size);
+        std::vector<char> tried (size, 0);
+        pcl::StopWatch step_timer;
+        step_timer.reset();
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(threads) schedule(dynamic,1)
+#endif
+        for (int i=0; i<size; ++i)
         {
+          if (winner.load() < i)
+            continue; //a better ranked Candidate already converged, no need to try this one
+          pcl::StopWatch icp_timer;
+          icp_timer.reset();
+          tried[i] = 1;
+#ifdef _OPENMP
+          PoseICP& icp = *workers[omp_get_thread_num()];
+#else
+          PoseICP& icp = *workers[0];
+#endif
+          Candidate& x = composite_list[i];
           PtC::Ptr aligned (new PtC);
-          PtC::Ptr candidate (new PtC);
-          pcl::copyPointCloud(x.getCloud(), *candidate);
-          //icp align source over target, result in aligned
-          candidate->sensor_origin_.setZero();
-          candidate->sensor_orientation_.setIdentity();
-          //candidate cloud we want to try aligning over the target
-          icp_.setInputSource(candidate);
-          Eigen::Matrix4f T_kli, T_cen, guess;
-          pcl::CentroidPoint<Pt> cct;
-          Pt candidate_centroid;
-          Eigen::Matrix3f sensor_rotation( x.getCloud().sensor_orientation_ );
-          Eigen::Vector4f sensor_translation;
-          sensor_translation = x.getCloud().sensor_origin_;
-          //Transformation from local object reference frame to kinect frame (as it was during database acquisition)
-          T_kli << sensor_rotation(0,0), sensor_rotation(0,1), sensor_rotation(0,2), sensor_translation(0),
-                sensor_rotation(1,0), sensor_rotation(1,1), sensor_rotation(1,2), sensor_translation(1),
-                sensor_rotation(2,0), sensor_rotation(2,1), sensor_rotation(2,2), sensor_translation(2),
-                0,                    0,                    0,                    1;
-          PtC::Ptr cloud_in_k (new PtC);
-          pcl::transformPointCloud(x.getCloud(), *cloud_in_k, T_kli);
-          for (const auto x: cloud_in_k->points)
-            cct.add(x);
-          cct.get(candidate_centroid);
-          T_cen << 1,0,0, (target_centroid.x - candidate_centroid.x),
-                0,1,0, (target_centroid.y - candidate_centroid.y),
-                0,0,1, (target_centroid.z - candidate_centroid.z),
-                0,0,0, 1;
+          //candidate cloud we want to try aligning over the target, icp align source over target, result in aligned
+          setICPSource(icp, x);
           //initial guess for ICP
-          guess = T_cen*T_kli;
-          icp_.align(*aligned, guess);
-          x.setTransformation(icp_.getFinalTransformation());
-          x.setRMSE(sqrt(icp_.getFitnessScore()));
-          if (getParam("verbosity")>1)
+          const Eigen::Matrix4f guess = computeInitialGuess(x, target_centroid.getVector3fMap());
+          //After every iteration ICP checks if a better ranked Candidate converged, alignment is never restarted,
+          //so a Candidate that is not cancelled gets the same result with any number of threads
+          icp.setCancelCheck([&winner, i]() { return (winner.load() < i); });
+          PipelineStats::CandidateICP& st = icp_stats[i];
+          st.name = x.getName();
+          icp.align(*aligned, guess);
+          st.iterations = icp.getNumberOfIterations();
+          if (icp.isCancelled())
           {
-            print_info("%*s]\tCandidate: ",20,__func__);
-            print_value("%-15s",x.getName().c_str());
-            print_info(" just performed ICP alignment, its RMSE is: ");
-            print_value("%g\n",x.getRMSE());
+            //not aligned, its fitness score is not worth a correspondence search
+            st.cancelled = true;
+            st.rmse = std::numeric_limits<float>::quiet_NaN();
+            st.time = icp_timer.getTime();
+            continue;
           }
-          if (x.getRMSE() <= RMSE_thresh_)
+          x.setTransformation(icp.getFinalTransformation());
+          x.setRMSE(sqrt(icp.getFitnessScore()));
+          st.rmse = x.getRMSE();
+          st.time = icp_timer.getTime();
+          if (config_.verbosity>1)
           {
-            //convergence we have a winner
-            estimation = x;
-            if (getParam("verbosity")>1)
+#ifdef _OPENMP
+#pragma omp critical (pel_bf_print)
+#endif
             {
-              print_info("%*s]\tCandidate %s converged with RMSE %g\n",20,__func__,estimation.getName().c_str(), estimation.getRMSE());
-              print_info("%*s]\tFinal transformation is:\n",20,__func__);
-              std::cout<<estimation.getTransformation()<<std::endl;
-              print_info("%*s]\tTotal time elapsed for complete Pose Estimation: ",20,__func__);
-              print_value("%g",timer.getTime());
-              print_info(" ms\n");
+              print_info("%*s]\tCandidate: ",20,__func__);
+              print_value("%-15s",x.getName().c_str());
+              print_info(" just performed ICP alignment, its RMSE is: ");
+              print_value("%g\n",x.getRMSE());
             }
-            return;
           }
+          if (x.getRMSE() <= RMSE_thresh_)
+          {
+            //convergence, keep it only if no better ranked Candidate converged before
+            int best = winner.load();
+            while (i < best && !winner.compare_exchange_weak(best, i))
+              ;
+          }
+        }
+        //Brute Force is a single ICP step over the whole composite list
+        PipelineStats::ICPStep step;
+        step.candidates = size;
+        step.time = step_timer.getTime();
+        stats_.icp_steps.push_back(step);
+        for (int i=0; i<size; ++i)
+          if (tried[i])
+            stats_.icp.push_back(icp_stats[i]);
+        stats_.estimation = timer.getTime();
+        if (winner.load() < size)
+        {
+          //we have a winner: the best ranked Candidate that converged
+          stats_.success = true;
+          estimation = composite_list[winner.load()];
+          if (config_.verbosity>1)
+          {
+            print_info("%*s]\tCandidate %s converged with RMSE %g\n",20,__func__,estimation.getName().c_str(), estimation.getRMSE());
+            print_info("%*s]\tFinal transformation is:\n",20,__func__);
+            std::cout<<estimation.getTransformation()<<std::endl;
+            print_info("%*s]\tTotal time elapsed for complete Pose Estimation: ",20,__func__);
+            print_value("%g",timer.getTime());
+            print_info(" ms\n");
+          }
+          return;
         }
         //no candidate converged, pose estimation failed
-        if (getParam("verbosity")>0)
+        if (config_.verbosity>0)
           print_warn("%*s]\tCannot find a suitable candidate, try raising the RMSE threshold\n",20,__func__);
-        if (getParam("verbosity")>1)
+        if (config_.verbosity>1)
         {
           print_info("%*s]\tPose Estimation failed!",20,__func__);
           print_info("%*s]\tTotal time elapsed: ",20,__func__);
           print_value("%g",timer.getTime());
           print_info(" ms\n");
         }
+        return;
       }
       //failed to generate lists
+      stats_.estimation = timer.getTime();
       print_error("%*s]\tFailed to generate lists of Candidates. Aborting pose estimation...",20,__func__);
     }
   }//end of namespace
@@ -35,6 +35,10 @@
 #include <pcl/common/centroid.h>
 #include <pcl/common/common.h>
 #include <pcl/common/time.h>
+#include <pcl/filters/voxel_grid.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace pcl::console;
 
@@ -44,19 +48,51 @@ namespace pel
   {
     PEProgressiveBisection::PEProgressiveBisection ()
     {
-      list_size_ = getParam("lists_size") ;
+      list_size_ = config_.lists_size ;
       te_dq_.reset(new pcl::registration::TransformationEstimationDualQuaternion<Pt,Pt,float>);
       te_lm_.reset(new pcl::registration::TransformationEstimationLM<Pt,Pt,float>);
       te_svd_.reset(new pcl::registration::TransformationEstimationSVD<Pt,Pt,float>);
+      te_ptp_.reset(new PointToPlaneEstimation);
       icp_.setUseReciprocalCorrespondences(true);
       icp_.setMaximumIterations (5);
       icp_.setTransformationEpsilon (1e-9);
       icp_.setEuclideanFitnessEpsilon (1e-9);
       icp_.setTransformationEstimation(te_dq_);
+      te_type_ = TransformationType::dq;
+      threads_ = 1;
       success_on_size_one_ = true;
       bisection_fraction_ = 0.5;
       step_iterations_ = 5;
       RMSE_thresh_ = 0.005;
+      pyramid_levels_ = 0;
+      pyramid_leaf_ = 0.01;
+      target_levels_leaf_ = 0;
+    }
+
+    unsigned int
+    PEProgressiveBisection::getStepLevel (const int step) const
+    {
+      if (pyramid_levels_ == 0)
+        return 0;
+      if (pyramid_schedule_.empty())
+        return (step < static_cast<int>(pyramid_levels_) ? pyramid_levels_ - step : 0);
+      if (step < static_cast<int>(pyramid_schedule_.size()))
+        return (std::min(pyramid_schedule_[step], pyramid_levels_));
+      return 0;
+    }
+
+    void
+    PEProgressiveBisection::setWorkersLevel (std::vector<PoseICP::Ptr>& workers,
+        const std::vector<PtC::ConstPtr>& target_levels, const std::vector<SearchTreeCache::Tree::Ptr>& target_trees,
+        const std::vector<PointToPlaneEstimation::Normals::ConstPtr>& level_normals, const unsigned int level) const
+    {
+      for (auto& w: workers)
+      {
+        w->setInputTarget(target_levels[level]);
+        w->setSearchMethodTarget(target_trees[level], true);
+        if (te_type_ == TransformationType::point_to_plane)
+          w->setTransformationEstimation(PointToPlaneEstimation::Ptr (new PointToPlaneEstimation (level_normals[level])));
+      }
     }
 
     void
@@ -70,11 +106,100 @@ namespace pel
         bisection_fraction_ = fraction;
     }
 
+    void
+    PEProgressiveBisection::initWorkers (std::vector<PoseICP::Ptr>& workers, const int size) const
+    {
+      workers.resize(size);
+      //normals are only read by point to plane estimations, all workers share one copy
+      PointToPlaneEstimation::Normals::ConstPtr normals;
+      if (te_type_ == TransformationType::point_to_plane)
+        normals = target_normals.makeShared();
+      for (auto& w: workers)
+      {
+        w.reset(new PoseICP);
+        w->setUseReciprocalCorrespondences(icp_.getUseReciprocalCorrespondences());
+        w->setMaximumIterations(icp_.getMaximumIterations());
+        w->setTransformationEpsilon(icp_.getTransformationEpsilon());
+        w->setEuclideanFitnessEpsilon(icp_.getEuclideanFitnessEpsilon());
+        //transformation estimations keep internal state while aligning, they cannot be shared among threads
+        if (te_type_ == TransformationType::lm)
+          w->setTransformationEstimation(pcl::registration::TransformationEstimationLM<Pt,Pt,float>::Ptr
+              (new pcl::registration::TransformationEstimationLM<Pt,Pt,float>));
+        else if (te_type_ == TransformationType::svd)
+          w->setTransformationEstimation(pcl::registration::TransformationEstimationSVD<Pt,Pt,float>::Ptr
+              (new pcl::registration::TransformationEstimationSVD<Pt,Pt,float>));
+        else if (te_type_ == TransformationType::point_to_plane)
+          w->setTransformationEstimation(PointToPlaneEstimation::Ptr (new PointToPlaneEstimation (normals)));
+        else
+          w->setTransformationEstimation(pcl::registration::TransformationEstimationDualQuaternion<Pt,Pt,float>::Ptr
+              (new pcl::registration::TransformationEstimationDualQuaternion<Pt,Pt,float>));
+        //reciprocal correspondences search the cached trees of Database poses
+        w->setCorrespondenceEstimation(PoseCorrespondenceEstimation::Ptr (new PoseCorrespondenceEstimation));
+        w->setInputTarget(target_cloud_processed);
+        w->setSearchMethodTarget(target_tree, true); //target never moves, its tree is built once in initTarget
+      }
+    }
+
+    bool
+    PEProgressiveBisection::initTarget ()
+    {
+      //pyramid of previous target is no longer valid
+      target_levels_.clear();
+      target_level_trees_.clear();
+      target_level_normals_.clear();
+      if (!PoseEstimationBase::initTarget())
+        return false;
+      buildTargetPyramid();
+      return true;
+    }
+
+    void
+    PEProgressiveBisection::buildTargetPyramid ()
+    {
+      pcl::StopWatch t;
+      t.reset();
+      target_levels_.assign(1, target_cloud_processed);
+      target_level_trees_.assign(1, target_tree);
+      //level 0 normals are the target ones, set by estimate once they are computed
+      target_level_normals_.assign(1, PointToPlaneEstimation::Normals::ConstPtr ());
+      target_levels_leaf_ = pyramid_leaf_;
+      //point to plane needs normals of each level, coarse ones are estimated on a neighborhood of at least two voxels
+      const bool ptp (te_type_ == TransformationType::point_to_plane);
+      pcl::VoxelGrid<Pt> vg;
+      for (unsigned int l=1; l<=pyramid_levels_; ++l)
+      {
+        PtC::Ptr coarse (new PtC);
+        const float leaf = pyramid_leaf_ * (1 << (l-1));
+        vg.setInputCloud(target_levels_.back());
+        vg.setLeafSize(leaf, leaf, leaf);
+        vg.filter(*coarse);
+        SearchTreeCache::Tree::Ptr tree (new SearchTreeCache::Tree);
+        tree->setInputCloud(coarse);
+        target_levels_.push_back(coarse);
+        target_level_trees_.push_back(tree);
+        PointToPlaneEstimation::Normals::Ptr normals;
+        if (ptp)
+        {
+          normals.reset(new PointToPlaneEstimation::Normals);
+          pcl::NormalEstimationOMP<Pt, pcl::Normal> ne;
+          ne.setSearchMethod(tree);
+          ne.setRadiusSearch(std::max(config_.normals_radius_search, 2*leaf));
+          ne.setNumberOfThreads(0);
+          ne.setInputCloud(coarse);
+          ne.useSensorOriginAsViewPoint();
+          ne.compute(*normals);
+        }
+        target_level_normals_.push_back(normals);
+      }
+      stats_.pyramid = t.getTime();
+    }
+
     void
     PEProgressiveBisection::estimate (Candidate& estimation)
     {
       pcl::StopWatch timer;
       timer.reset();
+      stats_.clearEstimation();
       if (this->generateLists())
       {
         pcl::CentroidPoint<Pt> target_cen_est;
@@ -83,70 +208,108 @@ namespace pel
         Pt target_centroid;
         target_cen_est.get(target_centroid);
         //ProgressiveBisection
-        if (getParam("verbosity")>1)
+        if (config_.verbosity>1)
           print_info("%*s]\tStarting Progressive Bisection...\n",20,__func__);
         //make a temporary list to manipulate
         std::vector<Candidate> list = getCandidateList(ListType::composite);
-        icp_.setInputTarget(target_cloud_processed); //Target
+        int threads = resolveNumberOfThreads(threads_);
+        //one ICP for each thread, all of them aligning over target
+        std::vector<PoseICP::Ptr> workers;
+        if (te_type_ == TransformationType::point_to_plane)
+          computeMissingNormals();
+        initWorkers(workers, threads);
+        if (config_.verbosity>1)
+          print_info("%*s]\tAligning Candidates with %d thread(s)\n",20,__func__,threads);
+        //voxel pyramid of target was built by initTarget, again only if pyramid parameters changed since then
+        const bool ptp (te_type_ == TransformationType::point_to_plane);
+        bool pyramid_valid (target_levels_.size() == pyramid_levels_ + 1 && target_levels_leaf_ == pyramid_leaf_ &&
+            target_levels_.front() == target_cloud_processed);
+        for (size_t l=1; l<target_level_normals_.size() && ptp; ++l)
+          pyramid_valid = pyramid_valid && target_level_normals_[l];
+        if (!pyramid_valid)
+          buildTargetPyramid();
+        if (ptp)
+          target_level_normals_[0] = target_normals.makeShared();
+        if (pyramid_levels_ > 0)
+          setPyramidLeafSize(pyramid_leaf_);
+        pcl::StopWatch t;
         int steps (0);
+        unsigned int level (0);
         while (list.size() > 1 )
         {
-          for (auto& x: list)
+          const int size_before = list.size();
+          if (getStepLevel(steps) != level)
           {
+            level = getStepLevel(steps);
+            setWorkersLevel(workers, target_levels_, target_level_trees_, target_level_normals_, level);
+          }
+          std::vector<PipelineStats::CandidateICP> icp_stats (size_before);
+          t.reset();
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(threads) schedule(dynamic,1)
+#endif
+          for (int i=0; i<size_before; ++i)
+          {
+            pcl::StopWatch icp_timer;
+            icp_timer.reset();
+#ifdef _OPENMP
+            PoseICP& icp = *workers[omp_get_thread_num()];
+#else
+            PoseICP& icp = *workers[0];
+#endif
+            Candidate& x = list[i];
             PtC::Ptr aligned (new PtC);
-            PtC::Ptr candidate (new PtC);
-            pcl::copyPointCloud(x.getCloud(), *candidate);
-            candidate->sensor_origin_.setZero();
-            candidate->sensor_orientation_.setIdentity();
-            //icp align source over target, result in aligned
-            icp_.setInputSource(candidate); //the candidate
+            //icp align source over target, result in aligned, the tree of the candidate is built only once
+            setICPSource(icp, x, level);
             Eigen::Matrix4f guess;
             if (steps >0)
               guess = x.getTransformation();
             else
+              guess = computeInitialGuess(x, target_centroid.getVector3fMap());
+            icp.align(*aligned, guess); //initial gross estimation
+            x.setTransformation(icp.getFinalTransformation());
+            x.setRMSE(sqrt(icp.getFitnessScore()));
+            PipelineStats::CandidateICP& st = icp_stats[i];
+            st.name = x.getName();
+            st.step = steps;
+            st.level = level;
+            st.iterations = icp.getNumberOfIterations();
+            st.rmse = x.getRMSE();
+            st.time = icp_timer.getTime();
+            if (config_.verbosity>1)
             {
-              Eigen::Matrix4f T_kli, T_cen;
-              pcl::CentroidPoint<Pt> cct;
-              Pt candidate_centroid;
-              Eigen::Matrix3f R (x.getCloud().sensor_orientation_);
-              Eigen::Vector4f t (x.getCloud().sensor_origin_);
-              T_kli << R(0,0), R(0,1), R(0,2), t(0),
-                    R(1,0), R(1,1), R(1,2), t(1),
-                    R(2,0), R(2,1), R(2,2), t(2),
-                    0,      0,      0,      1;
-              PtC::Ptr cloud_in_k (new PtC);
-              pcl::transformPointCloud(*candidate, *cloud_in_k, T_kli);
-              for (const auto x: cloud_in_k->points)
-                cct.add(x);
-              cct.get(candidate_centroid);
-              T_cen << 1,0,0, (target_centroid.x - candidate_centroid.x),
-                    0,1,0, (target_centroid.y - candidate_centroid.y),
-                    0,0,1, (target_centroid.z - candidate_centroid.z),
-                    0,0,0, 1;
-              guess = T_cen*T_kli;
-            }
-            icp_.align(*aligned, guess); //initial gross estimation
-            x.setTransformation(icp_.getFinalTransformation());
-            x.setRMSE(sqrt(icp_.getFitnessScore()));
-            if (getParam("verbosity")>1)
-            {
-              print_info("%*s]\tCandidate: ",20,__func__);
-              print_value("%-15s",x.getName().c_str());
-              print_info(" just performed %d ICP iterations, its RMSE is: ", step_iterations_);
-              print_value("%g\n", x.getRMSE());
+#ifdef _OPENMP
+#pragma omp critical (pel_pb_print)
+#endif
+              {
+                print_info("%*s]\tCandidate: ",20,__func__);
+                print_value("%-15s",x.getName().c_str());
+                print_info(" just performed %d ICP iterations at pyramid level %d, its RMSE is: ", step_iterations_, level);
+                print_value("%g\n", x.getRMSE());
+              }
             }
           }
+          //all Candidates are aligned at this point (implicit barrier of the parallel loop)
+          PipelineStats::ICPStep step;
+          step.level = level;
+          step.candidates = size_before;
+          step.time = t.getTime();
+          stats_.icp_steps.push_back(step);
+          stats_.icp.insert(stats_.icp.end(), icp_stats.begin(), icp_stats.end());
           ++steps;
           //now resort list
           if (sortListByRMSE(list))
           {
             //check if candidate fell under rmse threshold, no need to check them all since list is now sorted with min rmse on top
-            if (list[0].getRMSE() <= RMSE_thresh_ )
+            //RMSE over coarse levels only ranks Candidates, convergence is decided at full resolution
+            if (level == 0 && list[0].getRMSE() <= RMSE_thresh_ )
             {
               //convergence
               estimation = list[0];
               estimation.setRank(1);
-              if (getParam("verbosity")>1)
+              stats_.estimation = timer.getTime();
+              stats_.success = true;
+              if (config_.verbosity>1)
               {
                 print_info("%*s]\tCandidate %s converged with RMSE %g\n",20,__func__,list[0].getName().c_str(), list[0].getRMSE());
                 print_info("%*s]\tFinal transformation is:\n",20,__func__);
@@ -164,7 +327,7 @@ namespace pel
               if (size < list.size())
               {
                 list.resize(size);
-                if (getParam("verbosity")>1)
+                if (config_.verbosity>1)
                   print_info("%*s]\tResizing composite list... Keeping %.2g%% of list at previous step\n",20,__func__,bisection_fraction_*100);
               }
               else
@@ -174,15 +337,58 @@ namespace pel
           else
           {
             print_error("%*s]\tFailed to resort composite list. Aborting...",20,__func__);
+            stats_.estimation = timer.getTime();
+            return;
+          }
+        }
+        if (level != 0)
+        {
+          //last survivor was aligned only over coarse levels, refine it at full resolution
+          setWorkersLevel(workers, target_levels_, target_level_trees_, target_level_normals_, 0);
+          PoseICP& icp = *workers[0];
+          PtC::Ptr aligned (new PtC);
+          t.reset();
+          setICPSource(icp, list[0]);
+          icp.align(*aligned, list[0].getTransformation());
+          list[0].setTransformation(icp.getFinalTransformation());
+          list[0].setRMSE(sqrt(icp.getFitnessScore()));
+          PipelineStats::CandidateICP st;
+          st.name = list[0].getName();
+          st.step = steps;
+          st.iterations = icp.getNumberOfIterations();
+          st.rmse = list[0].getRMSE();
+          st.time = t.getTime();
+          PipelineStats::ICPStep step;
+          step.candidates = 1;
+          step.time = st.time;
+          stats_.icp_steps.push_back(step);
+          stats_.icp.push_back(st);
+          if (list[0].getRMSE() <= RMSE_thresh_)
+          {
+            estimation = list[0];
+            estimation.setRank(1);
+            stats_.estimation = timer.getTime();
+            stats_.success = true;
+            if (config_.verbosity>1)
+            {
+              print_info("%*s]\tCandidate %s converged at full resolution with RMSE %g\n",20,__func__,list[0].getName().c_str(), list[0].getRMSE());
+              print_info("%*s]\tFinal transformation is:\n",20,__func__);
+              std::cout<<list[0].getTransformation()<<std::endl;
+              print_info("%*s]\tTotal time elapsed for complete Pose Estimation: ",20,__func__);
+              print_value("%g",timer.getTime());
+              print_info(" ms\n");
+            }
             return;
           }
         }
         //only one candidate remained
+        stats_.estimation = timer.getTime();
         if (success_on_size_one_)
         {
           estimation = list[0];
           estimation.setRank(1);
-          if (getParam("verbosity")>1)
+          stats_.success = true;
+          if (config_.verbosity>1)
           {
             print_info("%*s]\tCandidate %s survived progressive bisection with RMSE %g\n",20,__func__,estimation.getName().c_str(), estimation.getRMSE());
             print_info("%*s]\tFinal transformation is:\n",20,__func__);
@@ -195,9 +401,9 @@ namespace pel
         else
         {
           //User requested failure on list size 1
-          if (getParam("verbosity")>0)
+          if (config_.verbosity>0)
             print_warn("%*s]\tCannot find a suitable candidate, try raising the RMSE threshold\n",20,__func__);
-          if (getParam("verbosity")>1)
+          if (config_.verbosity>1)
           {
             print_info("%*s]\tPose Estimation failed!",20,__func__);
             print_info("%*s]\tTotal time elapsed: ",20,__func__);
@@ -208,6 +414,7 @@ namespace pel
         return;
       }
       //Failed to generate lists
+      stats_.estimation = timer.getTime();
       print_error("%*s]\tFailed to generate lists of Candidates. Aborting pose estimation...",20,__func__);
     }
   } //End of namespace
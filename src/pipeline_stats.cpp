@@ -0,0 +1,118 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *   Pose Estimation Library (PEL) - https://bitbucket.org/Tabjones/pose-estimation-library
+ *   Copyright (c) 2014-2015, Federico Spinelli (fspinelli@gmail.com)
+ *   All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of copyright holder(s) nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <pel/pipeline_stats.h>
+#include <sstream>
+#include <cstdio>
+#include <cmath>
+
+namespace pel
+{
+  namespace
+  {
+    ///Quote a string for JSON, escaping what needs it
+    std::string
+    quote (const std::string& s)
+    {
+      std::string q ("\"");
+      for (const char c: s)
+      {
+        if (c == '"' || c == '\\')
+        {
+          q += '\\';
+          q += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+          char buf[8];
+          std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+          q += buf;
+        }
+        else
+          q += c;
+      }
+      q += '"';
+      return (q);
+    }
+    ///JSON has no infinities, failed alignments can report an infinite RMSE
+    std::string
+    number (const double x)
+    {
+      if (!std::isfinite(x))
+        return ("null");
+      std::ostringstream n;
+      n.precision(6);
+      n << x;
+      return (n.str());
+    }
+  }
+
+  void
+  PipelineStats::clearEstimation ()
+  {
+    icp_steps.clear();
+    icp.clear();
+    estimation = 0;
+    success = false;
+  }
+
+  std::string
+  PipelineStats::toJSON () const
+  {
+    std::ostringstream js;
+    js.precision(6);
+    js << "{\"target\":{\"name\":" << quote(target_name)
+      << ",\"points\":{\"input\":" << points.input << ",\"filter\":" << points.filter
+      << ",\"upsampling\":" << points.upsampling << ",\"downsampling\":" << points.downsampling << "}"
+      << ",\"time\":{\"filter\":" << target.filter << ",\"upsampling\":" << target.upsampling
+      << ",\"downsampling\":" << target.downsampling << ",\"tree\":" << target.tree
+      << ",\"esf\":" << target.esf << ",\"normals\":" << target.normals << ",\"vfh\":" << target.vfh
+      << ",\"cvfh\":" << target.cvfh << ",\"ourcvfh\":" << target.ourcvfh
+      << ",\"composite\":" << target.composite << ",\"total\":" << target.total << "}}";
+    js << ",\"lists\":{\"vfh\":" << lists.vfh << ",\"esf\":" << lists.esf << ",\"cvfh\":" << lists.cvfh
+      << ",\"ourcvfh\":" << lists.ourcvfh << ",\"composite\":" << lists.composite << ",\"total\":" << lists.total
+      << ",\"cascade_exit\":" << (lists.cascade_exit ? "true" : "false") << "}";
+    js << ",\"estimation\":{\"time\":" << estimation << ",\"success\":" << (success ? "true" : "false")
+      << ",\"pyramid\":" << pyramid << ",\"steps\":[";
+    for (size_t i=0; i<icp_steps.size(); ++i)
+      js << (i ? "," : "") << "{\"level\":" << icp_steps[i].level << ",\"candidates\":" << icp_steps[i].candidates
+        << ",\"time\":" << icp_steps[i].time << "}";
+    js << "],\"icp\":[";
+    for (size_t i=0; i<icp.size(); ++i)
+      js << (i ? "," : "") << "{\"name\":" << quote(icp[i].name) << ",\"step\":" << icp[i].step
+        << ",\"level\":" << icp[i].level << ",\"iterations\":" << icp[i].iterations << ",\"rmse\":" << number(icp[i].rmse)
+        << ",\"time\":" << icp[i].time << ",\"cancelled\":" << (icp[i].cancelled ? "true" : "false") << "}";
+    js << "]}}";
+    return (js.str());
+  }
+}
@@ -35,16 +35,36 @@
 #include <pcl/common/angles.h>
 #include <pcl/common/transforms.h>
 #include <pel/database/database_io.h>
+#include <thread>
+#include <atomic>
+#include <unordered_set>
+#include <algorithm>
 
 using namespace pcl::console;
 
 namespace pel
 {
+  namespace
+  {
+    ///Whether two Configs generate the same Candidate lists from the same Target features
+    bool
+    sameListsConfig (const Config& a, const Config& b)
+    {
+      return (a.lists_size == b.lists_size && a.use_vfh == b.use_vfh && a.use_esf == b.use_esf &&
+          a.use_cvfh == b.use_cvfh && a.use_ourcvfh == b.use_ourcvfh && a.cascade == b.cascade &&
+          a.cascade_top == b.cascade_top && a.cascade_agreement == b.cascade_agreement &&
+          a.cascade_margin == b.cascade_margin);
+    }
+  }
+
   bool
   PoseEstimationBase::generateLists()
   {
-    int k = getParam("lists_size");
-    int verbosity = getParam("verbosity");
+    applyPendingParams();
+    int k = config_.lists_size;
+    int verbosity = config_.verbosity;
+    //statistics describe this call only, lists built while initializing the target are timed with their features
+    stats_.lists = PipelineStats::ListTimings();
     if (this->isEmpty())
     {
       //Database is Empty
@@ -56,21 +76,87 @@ namespace pel
       print_error("%*s]\tTarget is not set, set it first!\n",20,__func__);
       return false;
     }
-    if (k > this->names_.size())
+    if (k > this->names_.size() - this->removed_count_)
     {
       print_error("%*]\tNot enough candidates to select in database, lists_size param is bigger than database size, aborting...\n",20,__func__);
       return false;
     }
+    if (lists_ready_ && sameListsConfig(lists_config_, config_) && lists_poses_ == this->names_.size() &&
+        lists_removed_ == this->removed_count_)
+    {
+      //built while initializing the target, nothing changed since. Estimation may reorder lists, so they
+      //are handed out only once
+      lists_ready_ = false;
+      if (verbosity > 1)
+        print_info("%*s]\tCandidate lists were already generated during Target initialization\n",20,__func__);
+      return true;
+    }
     if (verbosity > 1)
       print_info("%*s]\tStarting Candidate lists generation...\n",20,__func__);
-    pcl::StopWatch timer,t;
+    pcl::StopWatch timer;
     timer.reset();
     vfh_list.clear();
     esf_list.clear();
     cvfh_list.clear();
     ourcvfh_list.clear();
     composite_list.clear();
-    if (getParam("use_vfh")>=1)
+    cascade_exit_ = false;
+    if (config_.use_vfh && !generateList(ListType::vfh, k))
+      return false;
+    if (config_.use_esf && !generateList(ListType::esf, k))
+      return false;
+    if (deferred_features_)
+    {
+      //Cascade: CVFH and OURCVFH were not computed yet, they are needed only if cheap lists are ambiguous
+      generateCompositeList(k);
+      if (isUnambiguous(k))
+        cascade_exit_ = true;
+      else
+      {
+        if (verbosity > 1)
+          print_info("%*s]\tCascade found an ambiguous Target, computing CVFH/OURCVFH...\n",20,__func__);
+        computeMissingNormals(); //target initialization computed them only for VFH
+        pcl::StopWatch t;
+        if (config_.use_cvfh)
+        {
+          t.reset();
+          computeCVFH();
+          stats_.target.cvfh = t.getTime();
+        }
+        if (config_.use_ourcvfh)
+        {
+          t.reset();
+          computeOURCVFH();
+          stats_.target.ourcvfh = t.getTime();
+        }
+        deferred_features_ = false;
+      }
+    }
+    if (!cascade_exit_)
+    {
+      if (config_.use_cvfh && !generateList(ListType::cvfh, k))
+        return false;
+      if (config_.use_ourcvfh && !generateList(ListType::ourcvfh, k))
+        return false;
+      generateCompositeList(k);
+    }
+    stats_.lists.cascade_exit = cascade_exit_;
+    stats_.lists.total = timer.getTime();
+    if (verbosity>1)
+    {
+      print_info("%*s]\tTotal time elapsed to generate list(s) of candidates: ",20,__func__);
+      print_value("%g",timer.getTime());
+      print_info(" ms\n");
+    }
+    return true;
+  }
+
+  bool
+  PoseEstimationBase::generateList(ListType type, const int k)
+  {
+    int verbosity = reportSteps() ? config_.verbosity : 0;
+    pcl::StopWatch t;
+    if (type == ListType::vfh)
     {
       if (verbosity >1)
         print_info("%*s]\tGenerating List of Candidates, based on VFH... ",20,__func__);
@@ -80,16 +166,23 @@ namespace pel
         flann::Matrix<float> vfh_query (new float[1*308],1,308);
         for (size_t j=0; j < 308; ++j)
           vfh_query[0][j]= target_vfh.points[0].histogram[j];
-        flann::Matrix<int> match_id (new int[1*k],1,k);
-        flann::Matrix<float> match_dist (new float[1*k],1,k);
-        vfh_idx_->knnSearch (vfh_query, match_id, match_dist, k, SearchParams(256));
+        //Removed poses are still in the index, ask for enough neighbours to skip them
+        const int kq = k + this->removed_count_;
+        flann::Matrix<int> match_id (new int[1*kq],1,kq);
+        flann::Matrix<float> match_dist (new float[1*kq],1,kq);
+        vfh_idx_->knnSearch (vfh_query, match_id, match_dist, kq, SearchParams(256));
+        std::vector<std::pair<float, int> > dists;
+        for (int i=0; i<kq && dists.size() < k; ++i)
+          if (!isRemoved(match_id[0][i]))
+            dists.push_back(std::make_pair(match_dist[0][i], match_id[0][i]));
+        const float range = dists[k-1].first - dists[0].first;
         for (size_t i=0; i<k; ++i)
         {
-          std::string name= names_[match_id[0][i]];
-          Candidate c(names_[match_id[0][i]],clouds_[match_id[0][i]].makeShared());
+          Candidate c(names_[dists[i].second],getDatabaseCloud(dists[i].second));
+          c.setPoseId(dists[i].second);
           c.setRank(i+1);
-          c.setDistance(match_dist[0][i]);
-          c.setNormalizedDistance( (match_dist[0][i] - match_dist[0][0])/(match_dist[0][k-1] - match_dist[0][0]));
+          c.setDistance(dists[i].first);
+          c.setNormalizedDistance( (range > 0) ? (dists[i].first - dists[0].first)/range : 0 );
           vfh_list.push_back(c);
         }
       }
@@ -98,13 +191,14 @@ namespace pel
         print_error("%*s]\tError Computing VFH list\n",20,__func__);
         return false;
       }
+      stats_.lists.vfh = t.getTime();
       if (verbosity > 1)
       {
         print_value("%g",t.getTime());
         print_info(" ms elapsed\n");
       }
     }
-    if (getParam("use_esf")>=1)
+    else if (type == ListType::esf)
     {
       if (verbosity >1)
         print_info("%*s]\tGenerating List of Candidates, based on ESF... ",20,__func__);
@@ -114,15 +208,23 @@ namespace pel
         flann::Matrix<float> esf_query (new float[1*640],1,640);
         for (size_t j=0; j < 640; ++j)
           esf_query[0][j]= target_esf.points[0].histogram[j];
-        flann::Matrix<int> match_id (new int[1*k],1,k);
-        flann::Matrix<float> match_dist (new float[1*k],1,k);
-        esf_idx_->knnSearch (esf_query, match_id, match_dist, k, SearchParams(256) );
+        //Removed poses are still in the index, ask for enough neighbours to skip them
+        const int kq = k + this->removed_count_;
+        flann::Matrix<int> match_id (new int[1*kq],1,kq);
+        flann::Matrix<float> match_dist (new float[1*kq],1,kq);
+        esf_idx_->knnSearch (esf_query, match_id, match_dist, kq, SearchParams(256) );
+        std::vector<std::pair<float, int> > dists;
+        for (int i=0; i<kq && dists.size() < k; ++i)
+          if (!isRemoved(match_id[0][i]))
+            dists.push_back(std::make_pair(match_dist[0][i], match_id[0][i]));
+        const float range = dists[k-1].first - dists[0].first;
         for (size_t i=0; i<k; ++i)
         {
-          Candidate c(names_[match_id[0][i]],clouds_[match_id[0][i]].makeShared());
+          Candidate c(names_[dists[i].second],getDatabaseCloud(dists[i].second));
+          c.setPoseId(dists[i].second);
           c.setRank(i+1);
-          c.setDistance(match_dist[0][i]);
-          c.setNormalizedDistance( (match_dist[0][i] - match_dist[0][0])/(match_dist[0][k-1] - match_dist[0][0]) );
+          c.setDistance(dists[i].first);
+          c.setNormalizedDistance( (range > 0) ? (dists[i].first - dists[0].first)/range : 0 );
           esf_list.push_back(c);
         }
       }
@@ -131,13 +233,14 @@ namespace pel
         print_error("%*s]\tError Computing ESF list\n",20,__func__);
         return false;
       }
+      stats_.lists.esf = t.getTime();
       if (verbosity > 1)
       {
         print_value("%g",t.getTime());
         print_info(" ms elapsed\n");
       }
     }
-    if (getParam ("use_cvfh") >=1)
+    else if (type == ListType::cvfh)
     {
       if (verbosity >1)
         print_info("%*s]\tGenerating List of Candidates, based on CVFH... ",20,__func__);
@@ -147,18 +250,31 @@ namespace pel
         std::vector<std::pair<float, int> > dists;
         if (computeDistFromClusters(target_cvfh.makeShared(), ListType::cvfh, dists))
         {
+          //removed poses and poses without clusters are infinitely far, they cannot be ranked nor normalized
+          dists.erase(std::remove_if(dists.begin(), dists.end(),
+                [this](std::pair<float, int> const& d)
+                {
+                return (!std::isfinite(d.first) || isRemoved(d.second));
+                }), dists.end());
+          if (dists.size() < k)
+          {
+            print_error("%*s]\tOnly %d poses have CVFH clusters, lists_size param is bigger than that\n",20,__func__,static_cast<int>(dists.size()));
+            return false;
+          }
           std::sort(dists.begin(), dists.end(),
               [](std::pair<float, int> const& a, std::pair<float, int> const& b)
               {
               return (a.first < b.first );
               });
           dists.resize(k);
+          const float range = dists[k-1].first - dists[0].first;
           for (int i=0; i<k ; ++i)
           {
-            Candidate c (names_[dists[i].second], clouds_[dists[i].second].makeShared());
+            Candidate c (names_[dists[i].second], getDatabaseCloud(dists[i].second));
+            c.setPoseId(dists[i].second);
             c.setRank(i+1);
             c.setDistance(dists[i].first);
-            c.setNormalizedDistance( (dists[i].first - dists[0].first)/(dists[k-1].first - dists[0].first) );
+            c.setNormalizedDistance( (range > 0) ? (dists[i].first - dists[0].first)/range : 0 );
             cvfh_list.push_back(c);
           }
         }
@@ -173,13 +289,14 @@ namespace pel
         print_error("%*s]\tError computing CVFH list\n",20,__func__);
         return false;
       }
+      stats_.lists.cvfh = t.getTime();
       if (verbosity>1)
       {
         print_value("%g",t.getTime());
         print_info(" ms elapsed\n");
       }
     }
-    if (getParam("use_ourcvfh")>=1)
+    else if (type == ListType::ourcvfh)
     {
       if (verbosity>1)
         print_info("%*s]\tGenerating List of Candidates, based on OURCVFH... ",20,__func__);
@@ -189,18 +306,31 @@ namespace pel
         std::vector<std::pair<float, int> > dists;
         if (computeDistFromClusters(target_ourcvfh.makeShared(), ListType::ourcvfh, dists) )
         {
+          //removed poses and poses without clusters are infinitely far, they cannot be ranked nor normalized
+          dists.erase(std::remove_if(dists.begin(), dists.end(),
+                [this](std::pair<float, int> const& d)
+                {
+                return (!std::isfinite(d.first) || isRemoved(d.second));
+                }), dists.end());
+          if (dists.size() < k)
+          {
+            print_error("%*s]\tOnly %d poses have OURCVFH clusters, lists_size param is bigger than that\n",20,__func__,static_cast<int>(dists.size()));
+            return false;
+          }
           std::sort(dists.begin(), dists.end(),
               [](std::pair<float, int> const& a, std::pair<float, int> const& b)
               {
               return (a.first < b.first );
               });
           dists.resize(k);
+          const float range = dists[k-1].first - dists[0].first;
           for (int i=0; i<k ; ++i)
           {
-            Candidate c (names_[dists[i].second], clouds_[dists[i].second].makeShared() );
+            Candidate c (names_[dists[i].second], getDatabaseCloud(dists[i].second) );
+            c.setPoseId(dists[i].second);
             c.setRank(i+1);
             c.setDistance(dists[i].first);
-            c.setNormalizedDistance( (dists[i].first - dists[0].first)/(dists[k-1].first - dists[0].first) );
+            c.setNormalizedDistance( (range > 0) ? (dists[i].first - dists[0].first)/range : 0 );
             ourcvfh_list.push_back(c);
           }
         }
@@ -215,182 +345,119 @@ namespace pel
         print_error("%*s]\tError computing OURCVFH list\n",20,__func__);
         return false;
       }
+      stats_.lists.ourcvfh = t.getTime();
       if (verbosity >1)
       {
         print_value("%g",t.getTime());
         print_info(" ms elapsed\n");
       }
     }
-    //Composite list generation
+    return true;
+  }
+
+  void
+  PoseEstimationBase::generateCompositeList(const int k)
+  {
+    int verbosity = config_.verbosity;
+    pcl::StopWatch t;
     if (verbosity>1)
       print_info("%*s]\tGenerating Composite List based on previous features... ",20,__func__);
     t.reset();
-    std::vector<Candidate> tmp_esf, tmp_cvfh, tmp_ourcvfh, tmp_vfh;
-    if(getParam("use_vfh")>0)
-    {
-      if (feature_count_ == 1)
-      {
-        boost::copy(vfh_list, back_inserter(composite_list) );
-        if (verbosity>1)
-        {
-          print_value("%g",t.getTime());
-          print_info(" ms elapsed\n");
-        }
-        return true;
-      }
-      boost::copy(vfh_list, back_inserter(tmp_vfh) );
-    }
-    if(getParam("use_esf")>0)
-    {
-      if (feature_count_ == 1)
-      {
-        boost::copy(esf_list, back_inserter(composite_list) );
-        if (verbosity>1)
-        {
-          print_value("%g",t.getTime());
-          print_info(" ms elapsed\n");
-        }
-        return true;
-      }
-      boost::copy(esf_list, back_inserter(tmp_esf) );
-    }
-    if(getParam("use_cvfh")>0)
-    {
-      if (feature_count_ == 1)
-      {
-        boost::copy(cvfh_list, back_inserter(composite_list) );
-        if (verbosity>1)
-        {
-          print_value("%g",t.getTime());
-          print_info(" ms elapsed\n");
-        }
-        return true;
-      }
-      boost::copy(cvfh_list, back_inserter(tmp_cvfh) );
-    }
-    if(getParam("use_ourcvfh")>0)
-    {
-      if (feature_count_ == 1)
-      {
-        boost::copy(ourcvfh_list, back_inserter(composite_list) );
-        if (verbosity >1)
-        {
-          print_value("%g",t.getTime());
-          print_info(" ms elapsed\n");
-        }
-        return true;
-      }
-      boost::copy(ourcvfh_list, back_inserter(tmp_ourcvfh) );
-    }
-    if (getParam("use_vfh") >0 && !tmp_vfh.empty())
-    {
-      for (auto& x : tmp_vfh)
-      {
-        float d_tmp;
-        float x_dist = x.getNormalizedDistance();
-        if (getParam("use_esf") >0)
-        {
-          if (findAndEraseCandidate(tmp_esf, x.getName(), d_tmp))
-            x_dist += d_tmp;
-          else
-            x_dist += 1;
-        }
-        if (getParam("use_cvfh")>0)
-        {
-          if (findAndEraseCandidate(tmp_cvfh, x.getName(), d_tmp))
-            x_dist += d_tmp;
-          else
-            x_dist += 1;
-        }
-        if (getParam("use_ourcvfh")>0)
-        {
-          if (findAndEraseCandidate(tmp_ourcvfh, x.getName(), d_tmp))
-            x_dist += d_tmp;
-          else
-            x_dist += 1;
-        }
-        x.setNormalizedDistance (x_dist / feature_count_);
-        composite_list.push_back(x);
-      }
-    }
-    //Still some candidates in ESF that were not in VFH
-    if (getParam("use_esf")>0 && !tmp_esf.empty())
-    {
-      for (auto& x : tmp_esf)
-      {
-        float d_tmp;
-        float x_dist = x.getNormalizedDistance();
-        if (getParam("use_cvfh")>0)
-        {
-          if (findAndEraseCandidate(tmp_cvfh, x.getName(), d_tmp))
-            x_dist += d_tmp;
-          else
-            x_dist += 1;
-        }
-        if (getParam("use_ourcvfh")>0)
-        {
-          if (findAndEraseCandidate(tmp_ourcvfh, x.getName(), d_tmp))
-            x_dist += d_tmp;
-          else
-            x_dist += 1;
-        }
-        if (getParam("use_vfh")>0)
-          x_dist += 1;
-        x.setNormalizedDistance (x_dist / feature_count_);
-        composite_list.push_back(x);
-      }
-    }
-    //Still some candidates in CVFH that were not in VFH and ESF
-    if (getParam("use_cvfh")>0 && !tmp_cvfh.empty())
-    {
-      for (auto& x: tmp_cvfh)
-      {
-        float d_tmp;
-        float x_dist = x.getNormalizedDistance();
-        if (getParam("use_ourcvfh")>0)
-        {
-          if (findAndEraseCandidate(tmp_ourcvfh, x.getName(), d_tmp))
-            x_dist += d_tmp;
-          else
-            x_dist += 1;
-        }
-        if (getParam("use_vfh")>0)
-          x_dist += 1;
-        if (getParam("use_esf")>0)
-          x_dist += 1;
-        x.setNormalizedDistance(x_dist / feature_count_);
-        composite_list.push_back(x);
-      }
-    }
-    //Still some candidates in OURCVFH that were not in other lists
-    if (getParam("use_ourcvfh")>0 && !tmp_ourcvfh.empty())
+    //fuse enabled lists that were generated, cascade may have skipped some of them
+    std::vector<const std::vector<Candidate>* > lists;
+    if(config_.use_vfh && !vfh_list.empty())
+      lists.push_back(&vfh_list);
+    if(config_.use_esf && !esf_list.empty())
+      lists.push_back(&esf_list);
+    if(config_.use_cvfh && !cvfh_list.empty())
+      lists.push_back(&cvfh_list);
+    if(config_.use_ourcvfh && !ourcvfh_list.empty())
+      lists.push_back(&ourcvfh_list);
+    composite_list.clear();
+    if (lists.size() == 1)
     {
-      for (auto& x:tmp_ourcvfh)
+      boost::copy(*lists[0], back_inserter(composite_list) );
+      stats_.lists.composite = t.getTime();
+      if (verbosity>1)
       {
-        float x_dist = x.getNormalizedDistance();
-        if (getParam("use_vfh")>0)
-          x_dist += 1;
-        if (getParam("use_esf")>0)
-          x_dist += 1;
-        if (getParam("use_cvfh")>0)
-          x_dist += 1;
-        x.setNormalizedDistance(x_dist / feature_count_);
-        composite_list.push_back(x);
+        print_value("%g",t.getTime());
+        print_info(" ms elapsed\n");
       }
+      return;
     }
+    fuseLists(lists, composite_list);
     sortListByNormalizedDistance(ListType::composite);
     composite_list.resize(k);
     for (std::vector<Candidate>::iterator it=composite_list.begin(); it!=composite_list.end(); ++it)
       it->setRank(it - composite_list.begin() +1); //write the rank of the candidate in the list
+    stats_.lists.composite = t.getTime();
     if (verbosity>1)
     {
       print_value("%g",t.getTime());
       print_info(" ms elapsed\n");
-      print_info("%*s]\tTotal time elapsed to generate list(s) of candidates: ",20,__func__);
-      print_value("%g",timer.getTime());
-      print_info(" ms\n");
     }
-    return true;
+  }
+  bool
+  PoseEstimationBase::isUnambiguous(const int k) const
+  {
+    const int top = std::min(config_.cascade_top, k);
+    //fraction of the first Candidates that VFH and ESF lists have in common, a single list always agrees
+    float agreement (1);
+    if (config_.use_vfh && config_.use_esf)
+    {
+      std::unordered_set<int> vfh_top;
+      for (int i=0; i<top; ++i)
+        vfh_top.insert(vfh_list[i].getPoseId());
+      int common (0);
+      for (int i=0; i<top; ++i)
+        if (vfh_top.count(esf_list[i].getPoseId()))
+          ++common;
+      agreement = static_cast<float>(common) / top;
+    }
+    //how much the best fused Candidate stands out from the runner-up
+    const float margin = composite_list.size() > 1 ?
+      composite_list[1].getNormalizedDistance() - composite_list[0].getNormalizedDistance() : 1;
+    const bool unambiguous = agreement >= config_.cascade_agreement && margin >= config_.cascade_margin;
+    if (config_.verbosity>1)
+      print_info("%*s]\tCascade agreement %g, margin %g: %s\n",20,__func__, agreement, margin,
+          unambiguous ? "skipping CVFH/OURCVFH" : "ambiguous");
+    return (unambiguous);
+  }
+
+
+  Eigen::Matrix4f
+  PoseEstimationBase::computeInitialGuess (const Candidate& c, const Eigen::Vector3f& target_centroid) const
+  {
+    Eigen::Matrix4f T_kli;
+    Eigen::Vector3f centroid;
+    //Transformation from local object reference frame to kinect frame (as it was during database acquisition)
+    if (c.getPoseId() >= 0 && c.getPoseId() < static_cast<int>(names_.size()))
+      getSensorFrame (c.getPoseId(), T_kli, centroid);
+    else
+      computeSensorFrame (c.getCloud(), T_kli, centroid);
+    //then translate it over target centroid
+    Eigen::Matrix4f guess (T_kli);
+    guess.topRightCorner<3,1>() += target_centroid - centroid;
+    return (guess);
+  }
+
+  void
+  PoseEstimationBase::setICPSource (pcl::IterativeClosestPoint<Pt, Pt, float>& icp, const Candidate& c,
+      const unsigned int level) const
+  {
+    const bool in_db (c.getPoseId() >= 0 && c.getPoseId() < static_cast<int>(names_.size()));
+    if (in_db && level > 0)
+    {
+      icp.setInputSource(getDatabasePyramidCloud(c.getPoseId(), level));
+      icp.setSearchMethodSource(getDatabaseSearchTree(c.getPoseId(), level), true);
+      return;
+    }
+    //Database clouds are immutable and ICP only reads its source, no need to copy it
+    icp.setInputSource(c.getCloudPtr());
+    if (in_db)
+      icp.setSearchMethodSource(getDatabaseSearchTree(c.getPoseId()), true);
+    else
+      icp.setSearchMethodSource(SearchTreeCache::Tree::Ptr (new SearchTreeCache::Tree));
   }
 
   bool
@@ -409,41 +476,192 @@ namespace pel
       print_error("%*s]\tError initializing a Target, uninitialized cloud pointer!\n",20,__func__);
       return false;
     }
-    if (getParam("filter")>0)
+    pcl::StopWatch timer, t;
+    timer.reset();
+    stats_ = PipelineStats();
+    stats_.target_name = target_name;
+    stats_.points.input = target_cloud->points.size();
+    lists_ready_ = false; //a new target invalidates lists
+    target_normals.clear(); //computed below only if some feature needs them
+    t.reset();
+    if (config_.filter)
       removeOutliers();
     else
       copyPointCloud(*target_cloud, *target_cloud_processed);
+    stats_.target.filter = t.getTime();
+    stats_.points.filter = target_cloud_processed->points.size();
 
-    if (getParam("upsamp")>0)
+    t.reset();
+    if (config_.upsamp)
       applyUpsampling();
+    stats_.target.upsampling = t.getTime();
+    stats_.points.upsampling = target_cloud_processed->points.size();
 
-    if (getParam("downsamp")>0)
+    t.reset();
+    if (config_.downsamp)
       applyDownsampling();
-    feature_count_ = 0;
-    if (getParam("use_esf")>0)
-    {
-      ++feature_count_;
-      computeESF();
-    }
-    if (getParam("use_vfh")>0 || getParam("use_cvfh")>0 || getParam("use_ourcvfh")>0)
-    {
-      computeNormals();
-      if (getParam("use_vfh")>0)
+    stats_.target.downsampling = t.getTime();
+    stats_.points.downsampling = target_cloud_processed->points.size();
+    //processed target does not change from now on, one search tree serves normals, features and ICP
+    t.reset();
+    target_tree.reset(new pcl::search::KdTree<Pt>);
+    target_tree->setInputCloud(target_cloud_processed);
+    stats_.target.tree = t.getTime();
+    const bool use_esf (config_.use_esf), use_vfh (config_.use_vfh);
+    const bool use_cvfh (config_.use_cvfh), use_ourcvfh (config_.use_ourcvfh);
+    feature_count_ = use_esf + use_vfh + use_cvfh + use_ourcvfh;
+    //Cascade defers CVFH and OURCVFH to generateLists, which computes them only for ambiguous targets
+    deferred_features_ = config_.cascade && (use_esf || use_vfh) && (use_cvfh || use_ourcvfh);
+    const bool run_cvfh (use_cvfh && !deferred_features_), run_ourcvfh (use_ourcvfh && !deferred_features_);
+    const int threads = resolveNumberOfThreads(init_threads_);
+    if (threads > 1)
+    {
+      //Task graph: ESF does not need normals, so it runs alongside normals and the VFH family. Normal estimation
+      //is parallel itself and would run serially inside an OpenMP region, hence ESF gets its own thread.
+      //If a Database is already set every feature also queries it as soon as its descriptor is ready, so
+      //retrieval overlaps with the descriptors still being computed; lists are fused at the end.
+      const int k = config_.lists_size;
+      const bool pipeline (!this->isEmpty() && k > 0 && k <= this->names_.size() - this->removed_count_ &&
+          !deferred_features_);
+      if (pipeline)
       {
-        ++feature_count_;
-        computeVFH();
+        vfh_list.clear();
+        esf_list.clear();
+        cvfh_list.clear();
+        ourcvfh_list.clear();
+        composite_list.clear();
       }
-      if (getParam("use_cvfh")>0)
+      std::atomic<bool> features_ok (true), lists_ok (pipeline);
+      //steps running concurrently stay quiet, their timings are reported once they joined
+      concurrent_init_ = true;
+      std::thread esf_task;
+      if (use_esf)
+        esf_task = std::thread ([&]()
+            {
+              pcl::StopWatch esf_timer;
+              esf_timer.reset();
+              try
+              {
+                computeESF();
+                if (pipeline && !generateList(ListType::esf, k))
+                  lists_ok = false;
+              }
+              catch (...)
+              {
+                features_ok = false;
+              }
+              stats_.target.esf = esf_timer.getTime();
+            });
+      if (use_vfh || run_cvfh || run_ourcvfh)
       {
-        ++feature_count_;
-        computeCVFH();
+        t.reset();
+        computeNormals();
+        stats_.target.normals = t.getTime();
+        //VFH, CVFH and OURCVFH only read normals, they fan out
+        struct Task
+        {
+          void (PoseEstimationBase::*compute)();
+          ListType list;
+          double* time;
+        };
+        std::vector<Task> tasks;
+        if (use_vfh)
+          tasks.push_back({&PoseEstimationBase::computeVFH, ListType::vfh, &stats_.target.vfh});
+        if (run_cvfh)
+          tasks.push_back({&PoseEstimationBase::computeCVFH, ListType::cvfh, &stats_.target.cvfh});
+        if (run_ourcvfh)
+          tasks.push_back({&PoseEstimationBase::computeOURCVFH, ListType::ourcvfh, &stats_.target.ourcvfh});
+        const int size = tasks.size();
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(std::min(threads, size)) schedule(dynamic,1)
+#endif
+        for (int i=0; i<size; ++i)
+        {
+          pcl::StopWatch task_timer;
+          task_timer.reset();
+          try
+          {
+            (this->*tasks[i].compute)();
+            if (pipeline && !generateList(tasks[i].list, k))
+              lists_ok = false;
+          }
+          catch (...)
+          {
+            features_ok = false;
+          }
+          *tasks[i].time = task_timer.getTime();
+        }
       }
-      if (getParam("use_ourcvfh")>0)
+      if (esf_task.joinable())
+        esf_task.join();
+      concurrent_init_ = false;
+      if (pipeline && config_.verbosity>1)
       {
-        ++feature_count_;
-        computeOURCVFH();
+        print_info("%*s]\tCandidate lists generated alongside features in ",20,__func__);
+        print_value("%g",stats_.lists.vfh + stats_.lists.esf + stats_.lists.cvfh + stats_.lists.ourcvfh);
+        print_info(" ms (VFH %g, ESF %g, CVFH %g, OURCVFH %g)\n",
+            stats_.lists.vfh, stats_.lists.esf, stats_.lists.cvfh, stats_.lists.ourcvfh);
+      }
+      if (!features_ok)
+      {
+        print_error("%*s]\tError initializing a Target, feature estimation failed!\n",20,__func__);
+        return false;
+      }
+      if (lists_ok && feature_count_ > 0)
+      {
+        t.reset();
+        generateCompositeList(k);
+        stats_.target.composite = t.getTime();
+        //remember what lists were built against, generateLists rebuilds them if parameters or Database changed meanwhile
+        lists_ready_ = true;
+        lists_config_ = config_;
+        lists_poses_ = this->names_.size();
+        lists_removed_ = this->removed_count_;
       }
     }
+    else
+    {
+      if (use_esf)
+      {
+        t.reset();
+        computeESF();
+        stats_.target.esf = t.getTime();
+      }
+      if (use_vfh || run_cvfh || run_ourcvfh)
+      {
+        t.reset();
+        computeNormals();
+        stats_.target.normals = t.getTime();
+        if (use_vfh)
+        {
+          t.reset();
+          computeVFH();
+          stats_.target.vfh = t.getTime();
+        }
+        if (run_cvfh)
+        {
+          t.reset();
+          computeCVFH();
+          stats_.target.cvfh = t.getTime();
+        }
+        if (run_ourcvfh)
+        {
+          t.reset();
+          computeOURCVFH();
+          stats_.target.ourcvfh = t.getTime();
+        }
+      }
+    }
+    stats_.target.total = timer.getTime();
+    if (config_.verbosity>1)
+    {
+      print_info("%*s]\tTarget initialized with %d thread(s) in ",20,__func__,threads);
+      print_value("%g",stats_.target.total);
+      print_info(" ms (filter %g, upsampling %g, downsampling %g, tree %g, ESF %g, normals %g, VFH %g, CVFH %g, OURCVFH %g, composite %g)\n",
+          stats_.target.filter, stats_.target.upsampling, stats_.target.downsampling, stats_.target.tree,
+          stats_.target.esf, stats_.target.normals, stats_.target.vfh, stats_.target.cvfh, stats_.target.ourcvfh,
+          stats_.target.composite);
+    }
     if (feature_count_ <= 0)
     {
       print_error("%*s]\tError initializing a Target, zero features chosen to estimate. Enable at least one!\n",20,__func__);
@@ -456,21 +674,21 @@ namespace pel
   PoseEstimationBase::removeOutliers()
   {
     pcl::StopWatch timer;
-    if (getParam("verbosity") >1)
+    if (config_.verbosity >1)
     {
       print_info("%*s]\tSetting Statistical Outlier Filter to preprocess target cloud...\n",20,__func__);
-      print_info("%*s]\tSetting mean K to %g\n",20,__func__, getParam("filter_mean_k"));
-      print_info("%*s]\tSetting Standard Deviation multiplier to %g\n",20,__func__, getParam("filter_std_dev_mul_thresh"));
+      print_info("%*s]\tSetting mean K to %d\n",20,__func__, config_.filter_mean_k);
+      print_info("%*s]\tSetting Standard Deviation multiplier to %g\n",20,__func__, config_.filter_std_dev_mul_thresh);
       timer.reset();
     }
     PtC::Ptr filtered (new PtC);
     pcl::StatisticalOutlierRemoval<Pt> fil;
-    fil.setMeanK (getParam("filter_mean_k"));
-    fil.setStddevMulThresh (getParam("filter_std_dev_mul_thresh"));
+    fil.setMeanK (config_.filter_mean_k);
+    fil.setStddevMulThresh (config_.filter_std_dev_mul_thresh);
     fil.setInputCloud(target_cloud);
     fil.filter(*filtered);
     copyPointCloud(*filtered, *target_cloud_processed);
-    if (getParam("verbosity")>1)
+    if (config_.verbosity>1)
     {
       print_info("%*s]\tTotal time elapsed during filter: ",20,__func__);
       print_value("%g", timer.getTime());
@@ -482,12 +700,12 @@ namespace pel
   PoseEstimationBase::applyUpsampling()
   {
     pcl::StopWatch timer;
-    float search_radius = getParam("upsamp_search_radius");
-    int point_density = getParam("upsamp_point_density");
-    std::string poly_fit_str = getParam("upsamp_poly_fit") ? "True" : "False";
-    int poly_fit = getParam("upsamp_poly_fit");
-    int poly_order = getParam("upsamp_poly_order");
-    if (getParam("verbosity") >1)
+    float search_radius = config_.upsamp_search_radius;
+    int point_density = config_.upsamp_point_density;
+    std::string poly_fit_str = config_.upsamp_poly_fit ? "True" : "False";
+    int poly_fit = config_.upsamp_poly_fit;
+    int poly_order = config_.upsamp_poly_order;
+    if (config_.verbosity >1)
     {
       print_info("%*s]\tSetting MLS with Random Uniform Density to preprocess target cloud...\n",20,__func__);
       print_info("%*s]\tSetting polynomial order to %d\n",20,__func__, poly_order);
@@ -497,6 +715,7 @@ namespace pel
       timer.reset();
     }
     PtC::Ptr upsampled (new PtC);
+    //MLS searches the cloud before downsampling, target_tree is not built yet
     pcl::search::KdTree<Pt>::Ptr tree (new pcl::search::KdTree<Pt>);
     pcl::MovingLeastSquares<Pt, Pt> mls;
     mls.setInputCloud(target_cloud_processed);
@@ -509,7 +728,7 @@ namespace pel
     mls.setPointDensity(point_density);
     mls.process(*upsampled);
     copyPointCloud(*upsampled, *target_cloud_processed);
-    if (getParam("verbosity") >1)
+    if (config_.verbosity >1)
     {
       print_info("%*s]\tTotal time elapsed during upsampling: ",20,__func__);
       print_value("%g", timer.getTime());
@@ -521,8 +740,8 @@ namespace pel
   PoseEstimationBase::applyDownsampling()
   {
     pcl::StopWatch timer;
-    float leaf_size = getParam("downsamp_leaf_size");
-    if (getParam("verbosity") >1)
+    float leaf_size = config_.downsamp_leaf_size;
+    if (config_.verbosity >1)
     {
       print_info("%*s]\tSetting Voxel Grid Filter to preprocess target cloud...\n",20,__func__);
       print_info("%*s]\tSetting Leaf Size to %g\n",20,__func__, leaf_size);
@@ -535,7 +754,7 @@ namespace pel
     vg.setDownsampleAllData (true);
     vg.filter(*downsampled);
     copyPointCloud(*downsampled, *target_cloud_processed);
-    if (getParam("verbosity") >1)
+    if (config_.verbosity >1)
     {
       print_info("%*s]\tTotal time elapsed during downsampling: ",20,__func__);
       print_value("%g", timer.getTime());
@@ -547,19 +766,18 @@ namespace pel
   PoseEstimationBase::computeVFH()
   {
     pcl::StopWatch timer;
-    if (getParam("verbosity")>1)
+    if (reportSteps())
     {
       print_info("%*s]\tEstimating VFH feature of target...\n",20,__func__);
       timer.reset();
     }
     pcl::VFHEstimation<Pt, pcl::Normal, pcl::VFHSignature308> vfhE;
-    pcl::search::KdTree<Pt>::Ptr tree (new pcl::search::KdTree<Pt>);
-    vfhE.setSearchMethod(tree);
+    vfhE.setSearchMethod(target_tree); //already built over target_cloud_processed
     vfhE.setInputCloud (target_cloud_processed);
     vfhE.setViewPoint (target_cloud_processed->sensor_origin_(0), target_cloud_processed->sensor_origin_(1), target_cloud_processed->sensor_origin_(2));
     vfhE.setInputNormals (target_normals.makeShared());
     vfhE.compute (target_vfh);
-    if (getParam("verbosity")>1)
+    if (reportSteps())
     {
       print_info("%*s]\tTotal time elapsed during VFH estimation: ",20,__func__);
       print_value("%g", timer.getTime());
@@ -571,17 +789,17 @@ namespace pel
   PoseEstimationBase::computeESF()
   {
     pcl::StopWatch timer;
-    if (getParam("verbosity")>1)
+    if (reportSteps())
     {
       print_info("%*s]\tEstimating ESF feature of target...\n",20,__func__);
       timer.reset();
     }
-    pcl::ESFEstimation<Pt, pcl::ESFSignature640> esfE;
-    pcl::search::KdTree<Pt>::Ptr tree (new pcl::search::KdTree<Pt>);
-    esfE.setSearchMethod(tree);
+    //sampled like Database poses, without touching rand() (ESF runs alongside other tasks)
+    SeededESFEstimation esfE;
+    esfE.setSearchMethod(target_tree); //already built over target_cloud_processed
     esfE.setInputCloud (target_cloud_processed);
     esfE.compute (target_esf);
-    if (getParam("verbosity")>1)
+    if (reportSteps())
     {
       print_info("%*s]\tTotal time elapsed during ESF estimation: ",20,__func__);
       print_value("%g", timer.getTime());
@@ -593,11 +811,11 @@ namespace pel
   PoseEstimationBase::computeCVFH()
   {
     pcl::StopWatch timer;
-    float ang_thresh = getParam("cvfh_ang_thresh");
-    float curv_thresh = getParam("cvfh_curv_thresh");
-    float clus_tol = getParam("cvfh_clus_tol");
-    int min_points = getParam("cvfh_clus_min_points");
-    if (getParam("verbosity")>1)
+    float ang_thresh = config_.cvfh_ang_thresh;
+    float curv_thresh = config_.cvfh_curv_thresh;
+    float clus_tol = config_.cvfh_clus_tol;
+    int min_points = config_.cvfh_clus_min_points;
+    if (reportSteps())
     {
       print_info("%*s]\tEstimating CVFH feature of target...\n",20,__func__);
       print_info("%*s]\tUsing Angle Threshold of %g degress for normal deviation\n",20,__func__, ang_thresh);
@@ -607,8 +825,7 @@ namespace pel
       timer.reset();
     }
     pcl::CVFHEstimation<Pt, pcl::Normal, pcl::VFHSignature308> cvfhE;
-    pcl::search::KdTree<Pt>::Ptr tree (new pcl::search::KdTree<Pt>);
-    cvfhE.setSearchMethod(tree);
+    cvfhE.setSearchMethod(target_tree); //already built over target_cloud_processed
     cvfhE.setInputCloud (target_cloud_processed);
     cvfhE.setViewPoint (target_cloud_processed->sensor_origin_(0), target_cloud_processed->sensor_origin_(1), target_cloud_processed->sensor_origin_(2));
     cvfhE.setInputNormals (target_normals.makeShared());
@@ -618,7 +835,7 @@ namespace pel
     cvfhE.setMinPoints(min_points);
     cvfhE.setNormalizeBins(false);
     cvfhE.compute (target_cvfh);
-    if (getParam("verbosity")>1)
+    if (reportSteps())
     {
       print_info("%*s]\tTotal of %d clusters were found on query\n",20,__func__, target_cvfh.points.size());
       print_info("%*s]\tTotal time elapsed during CVFH estimation: ",20,__func__);
@@ -631,14 +848,14 @@ namespace pel
   PoseEstimationBase::computeOURCVFH()
   {
     pcl::StopWatch timer;
-    float ang_thresh = getParam("ourcvfh_ang_thresh");
-    float curv_thresh = getParam("ourcvfh_curv_thresh");
-    float clus_tol = getParam("ourcvfh_clus_tol");
-    int min_points = getParam("ourcvfh_clus_min_points");
-    float axis_ratio = getParam("ourcvfh_axis_ratio");
-    float min_axis = getParam("ourcvfh_min_axis_value");
-    float refine = getParam("ourcvfh_refine_clusters");
-    if (getParam("verbosity")>1)
+    float ang_thresh = config_.ourcvfh_ang_thresh;
+    float curv_thresh = config_.ourcvfh_curv_thresh;
+    float clus_tol = config_.ourcvfh_clus_tol;
+    int min_points = config_.ourcvfh_clus_min_points;
+    float axis_ratio = config_.ourcvfh_axis_ratio;
+    float min_axis = config_.ourcvfh_min_axis_value;
+    float refine = config_.ourcvfh_refine_clusters;
+    if (reportSteps())
     {
       print_info("%*s]\tEstimating OURCVFH feature of target...\n",20,__func__);
       print_info("%*s]\tUsing Angle Threshold of %g degress for normal deviation\n",20,__func__,ang_thresh);
@@ -650,10 +867,9 @@ namespace pel
       timer.reset();
     }
     pcl::OURCVFHEstimation<Pt, pcl::Normal, pcl::VFHSignature308> ourcvfhE;
-    pcl::search::KdTree<Pt>::Ptr tree (new pcl::search::KdTree<Pt>);
     //PointCloud<Pt>::Ptr cloud (new PointCloud<Pt>);
     //copyPointCloud(*query_cloud_, *cloud);
-    ourcvfhE.setSearchMethod(tree);
+    ourcvfhE.setSearchMethod(target_tree); //already built over target_cloud_processed
     ourcvfhE.setInputCloud (target_cloud_processed);
     ourcvfhE.setViewPoint (target_cloud_processed->sensor_origin_(0), target_cloud_processed->sensor_origin_(1), target_cloud_processed->sensor_origin_(2));
     ourcvfhE.setInputNormals (target_normals.makeShared());
@@ -665,7 +881,7 @@ namespace pel
     ourcvfhE.setMinAxisValue(min_axis);
     ourcvfhE.setRefineClusters(refine);
     ourcvfhE.compute (target_ourcvfh);
-    if (getParam("verbosity")>1)
+    if (reportSteps())
     {
       print_info("%*s]\tTotal of %d clusters were found on target\n",20,__func__, target_ourcvfh.points.size());
       print_info("%*s]\tTotal time elapsed during OURCVFH estimation: ",20,__func__);
@@ -678,22 +894,21 @@ namespace pel
   PoseEstimationBase::computeNormals()
   {
     pcl::StopWatch timer;
-    float search_radius = getParam("normals_radius_search");
-    if (getParam("verbosity")>1)
+    float search_radius = config_.normals_radius_search;
+    if (reportSteps())
     {
       print_info("%*s]\tSetting normal estimation to calculate target normals...\n",20,__func__);
       print_info("%*s]\tSetting a neighborhood radius of %g\n",20,__func__, search_radius);
       timer.reset();
     }
     pcl::NormalEstimationOMP<Pt, pcl::Normal> ne;
-    pcl::search::KdTree<Pt>::Ptr tree (new pcl::search::KdTree<Pt>);
-    ne.setSearchMethod(tree);
+    ne.setSearchMethod(target_tree); //already built over target_cloud_processed
     ne.setRadiusSearch(search_radius);
     ne.setNumberOfThreads(0); //use pcl autoallocation
     ne.setInputCloud(target_cloud_processed);
     ne.useSensorOriginAsViewPoint();
     ne.compute(target_normals);
-    if (getParam("verbosity")>1)
+    if (reportSteps())
     {
       print_info("%*s]\tTotal time elapsed during normal estimation: ",20,__func__);
       print_value("%g", timer.getTime());
@@ -701,9 +916,22 @@ namespace pel
     }
   }
 
+  void
+  PoseEstimationBase::computeMissingNormals()
+  {
+    if (target_normals.points.size() != target_cloud_processed->points.size())
+    {
+      pcl::StopWatch t;
+      t.reset();
+      computeNormals();
+      stats_.target.normals += t.getTime();
+    }
+  }
+
   bool
   PoseEstimationBase::setTarget(PtC::Ptr target, std::string name)
   {
+    applyPendingParams();
     if (target)
     {
       //IF for some reason target is not in sensor frame, put it back on it. If it already is the transformation is identity
@@ -714,7 +942,7 @@ namespace pel
       target_cloud->sensor_origin_.setZero();
       target_cloud->sensor_orientation_.setIdentity();
     }
-    if (getParam("verbosity")>1)
+    if (config_.verbosity>1)
       print_info("%*s]\tSetting Target for Pose Estimation: %s with %d points.\n",20,__func__,name.c_str(),target_cloud->points.size());
     return (initTarget());
   }
@@ -742,81 +970,16 @@ namespace pel
   PoseEstimationBase&
   PoseEstimationBase::operator= (const Database& other)
   {
-    int rows = other.getDatabaseVFH()->rows;
-    int cols = other.getDatabaseVFH()->cols;
-    histograms vfh (new float[rows * cols], rows, cols);
-    for (size_t i=0; i<rows; ++i)
-      for (size_t j=0; j<cols; ++j)
-        vfh[i][j] = (*other.getDatabaseVFH())[i][j];
-    rows = other.getDatabaseESF()->rows;
-    cols = other.getDatabaseESF()->cols;
-    histograms esf (new float[rows * cols], rows, cols);
-    for (size_t i=0; i<rows; ++i)
-      for (size_t j=0; j<cols; ++j)
-        esf[i][j] = (*other.getDatabaseESF())[i][j];
-    rows = other.getDatabaseCVFH()->rows;
-    cols = other.getDatabaseCVFH()->cols;
-    histograms cvfh (new float[rows * cols], rows, cols);
-    for (size_t i=0; i<rows; ++i)
-      for (size_t j=0; j<cols; ++j)
-        cvfh[i][j] = (*other.getDatabaseCVFH())[i][j];
-    rows = other.getDatabaseOURCVFH()->rows;
-    cols = other.getDatabaseOURCVFH()->cols;
-    histograms ourcvfh (new float[rows * cols], rows, cols);
-    for (size_t i=0; i<rows; ++i)
-      for (size_t j=0; j<cols; ++j)
-        ourcvfh[i][j] = (*other.getDatabaseOURCVFH())[i][j];
-    std::vector<std::string> names;
-    boost::copy (other.getDatabaseNames(), back_inserter(names));
-    std::vector<std::string> names_cvfh;
-    boost::copy (other.getDatabaseNamesCVFH(), back_inserter(names_cvfh));
-    std::vector<std::string> names_ourcvfh;
-    boost::copy (other.getDatabaseNamesOURCVFH(), back_inserter(names_ourcvfh));
-    std::vector<PtC> clouds;
-    boost::copy (other.getDatabaseClouds(), back_inserter(clouds));
-    //only way to copy FLANN indexs that i'm aware of (save it to disk then load it)
-    other.getDatabaseIndexVFH()->save(".idx_v_tmp");
-    indexVFH idx_vfh (vfh, SavedIndexParams(".idx_v_tmp"));
-    boost::filesystem::remove(".idx_v_tmp"); //delete tmp file
-    //only way to copy indexs that i'm aware of (save it to disk then load it)
-    other.getDatabaseIndexESF()->save(".idx_e_tmp");
-    indexESF idx_esf (esf, SavedIndexParams(".idx_e_tmp"));
-    boost::filesystem::remove(".idx_e_tmp"); //delete tmp file
-    //save tmp db into this
-    this->vfh_ = boost::make_shared<histograms>(vfh);
-    this->esf_ = boost::make_shared<histograms>(esf);
-    this->cvfh_ = boost::make_shared<histograms>(cvfh);
-    this->ourcvfh_ = boost::make_shared<histograms>(ourcvfh);
-    this->vfh_idx_ = boost::make_shared<indexVFH>(idx_vfh);
-    this->vfh_idx_ -> buildIndex();
-    this->esf_idx_ = boost::make_shared<indexESF>(idx_esf);
-    this->esf_idx_ -> buildIndex();
-    this->names_.clear();
-    this->names_cvfh_.clear();
-    this->names_ourcvfh_.clear();
-    this->clouds_.clear();
-    boost::copy (names, back_inserter(this->names_));
-    boost::copy (names_ourcvfh, back_inserter(this->names_ourcvfh_));
-    boost::copy (clouds, back_inserter(this->clouds_));
-    boost::copy (names_cvfh, back_inserter(this->names_cvfh_));
-    this->db_path_ = other.getDatabasePath();
+    Database::operator= (other);
+    lists_ready_ = false;
     return *this;
   }
 
   PoseEstimationBase&
   PoseEstimationBase::operator= (Database&& other)
   {
-    this->vfh_ = std::move(other.getDatabaseVFH());
-    this->esf_ = std::move(other.getDatabaseESF());
-    this->cvfh_ = std::move(other.getDatabaseCVFH());
-    this->ourcvfh_ = std::move(other.getDatabaseOURCVFH());
-    this->names_ = std::move(other.getDatabaseNames());
-    this->names_cvfh_ = std::move(other.getDatabaseNamesCVFH());
-    this->names_ourcvfh_ = std::move(other.getDatabaseNamesOURCVFH());
-    this->db_path_= std::move(other.getDatabasePath());
-    this->clouds_ = std::move(other.getDatabaseClouds());
-    this->vfh_idx_ = std::move(other.getDatabaseIndexVFH());
-    this->esf_idx_ = std::move(other.getDatabaseIndexESF());
+    Database::operator= (std::move(other));
+    lists_ready_ = false;
     return *this;
   }
 } //End of namespace pel
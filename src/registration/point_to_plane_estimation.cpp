@@ -0,0 +1,134 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *   Pose Estimation Library (PEL) - https://bitbucket.org/Tabjones/pose-estimation-library
+ *   Copyright (c) 2014-2015, Federico Spinelli (fspinelli@gmail.com)
+ *   All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of copyright holder(s) nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <pel/registration/point_to_plane_estimation.h>
+#include <pcl/registration/transformation_estimation_svd.h>
+#include <Eigen/Geometry>
+
+namespace pel
+{
+  void
+  PointToPlaneEstimation::estimateRigidTransformation (const pcl::PointCloud<Pt>& cloud_src,
+      const pcl::PointCloud<Pt>& cloud_tgt, Matrix4& transformation_matrix) const
+  {
+    std::vector<std::pair<int, int> > pairs;
+    pairs.reserve(cloud_src.points.size());
+    for (size_t i=0; i<cloud_src.points.size() && i<cloud_tgt.points.size(); ++i)
+      pairs.push_back(std::make_pair(i, i));
+    estimate (cloud_src, cloud_tgt, pairs, transformation_matrix);
+  }
+
+  void
+  PointToPlaneEstimation::estimateRigidTransformation (const pcl::PointCloud<Pt>& cloud_src,
+      const std::vector<int>& indices_src, const pcl::PointCloud<Pt>& cloud_tgt, Matrix4& transformation_matrix) const
+  {
+    std::vector<std::pair<int, int> > pairs;
+    pairs.reserve(indices_src.size());
+    for (size_t i=0; i<indices_src.size() && i<cloud_tgt.points.size(); ++i)
+      pairs.push_back(std::make_pair(indices_src[i], i));
+    estimate (cloud_src, cloud_tgt, pairs, transformation_matrix);
+  }
+
+  void
+  PointToPlaneEstimation::estimateRigidTransformation (const pcl::PointCloud<Pt>& cloud_src,
+      const std::vector<int>& indices_src, const pcl::PointCloud<Pt>& cloud_tgt, const std::vector<int>& indices_tgt,
+      Matrix4& transformation_matrix) const
+  {
+    std::vector<std::pair<int, int> > pairs;
+    pairs.reserve(indices_src.size());
+    for (size_t i=0; i<indices_src.size() && i<indices_tgt.size(); ++i)
+      pairs.push_back(std::make_pair(indices_src[i], indices_tgt[i]));
+    estimate (cloud_src, cloud_tgt, pairs, transformation_matrix);
+  }
+
+  void
+  PointToPlaneEstimation::estimateRigidTransformation (const pcl::PointCloud<Pt>& cloud_src,
+      const pcl::PointCloud<Pt>& cloud_tgt, const pcl::Correspondences& correspondences,
+      Matrix4& transformation_matrix) const
+  {
+    std::vector<std::pair<int, int> > pairs;
+    pairs.reserve(correspondences.size());
+    for (const auto& c : correspondences)
+      pairs.push_back(std::make_pair(c.index_query, c.index_match));
+    estimate (cloud_src, cloud_tgt, pairs, transformation_matrix);
+  }
+
+  void
+  PointToPlaneEstimation::estimate (const pcl::PointCloud<Pt>& cloud_src, const pcl::PointCloud<Pt>& cloud_tgt,
+      const std::vector<std::pair<int, int> >& pairs, Matrix4& transformation_matrix) const
+  {
+    //Normal equations of the residuals n.(R*s + t - d), with R linearized around identity:
+    //unknowns are (alpha, beta, gamma, tx, ty, tz) and each row of A is (s x n, n)
+    Eigen::Matrix<double, 6, 6> ATA (Eigen::Matrix<double, 6, 6>::Zero());
+    Eigen::Matrix<double, 6, 1> ATb (Eigen::Matrix<double, 6, 1>::Zero());
+    size_t used (0);
+    if (normals_)
+      for (const auto& p : pairs)
+      {
+        if (p.second < 0 || p.second >= static_cast<int>(normals_->points.size()))
+          continue;
+        const pcl::Normal& nt = normals_->points[p.second];
+        if (!pcl_isfinite(nt.normal_x) || !pcl_isfinite(nt.normal_y) || !pcl_isfinite(nt.normal_z))
+          continue;
+        const Eigen::Vector3d s = cloud_src.points[p.first].getVector3fMap().cast<double>();
+        const Eigen::Vector3d d = cloud_tgt.points[p.second].getVector3fMap().cast<double>();
+        const Eigen::Vector3d n (nt.normal_x, nt.normal_y, nt.normal_z);
+        Eigen::Matrix<double, 6, 1> a;
+        a.head<3>() = s.cross(n);
+        a.tail<3>() = n;
+        ATA.noalias() += a * a.transpose();
+        ATb.noalias() += a * n.dot(d - s);
+        ++used;
+      }
+    if (used < 6)
+    {
+      //not enough constraints on the planes, fall back to point to point
+      pcl::registration::TransformationEstimationSVD<Pt, Pt, float> svd;
+      std::vector<int> src, tgt;
+      for (const auto& p : pairs)
+      {
+        src.push_back(p.first);
+        tgt.push_back(p.second);
+      }
+      svd.estimateRigidTransformation(cloud_src, src, cloud_tgt, tgt, transformation_matrix);
+      return;
+    }
+    const Eigen::Matrix<double, 6, 1> x = ATA.ldlt().solve(ATb);
+    Eigen::Matrix4d t (Eigen::Matrix4d::Identity());
+    t.topLeftCorner<3,3>() = (Eigen::AngleAxisd(x(2), Eigen::Vector3d::UnitZ()) *
+        Eigen::AngleAxisd(x(1), Eigen::Vector3d::UnitY()) *
+        Eigen::AngleAxisd(x(0), Eigen::Vector3d::UnitX())).toRotationMatrix();
+    t.topRightCorner<3,1>() = x.tail<3>();
+    transformation_matrix = t.cast<float>();
+  }
+}
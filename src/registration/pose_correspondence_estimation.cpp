@@ -0,0 +1,86 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *   Pose Estimation Library (PEL) - https://bitbucket.org/Tabjones/pose-estimation-library
+ *   Copyright (c) 2014-2015, Federico Spinelli (fspinelli@gmail.com)
+ *   All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of copyright holder(s) nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <pel/registration/pose_correspondence_estimation.h>
+#include <Eigen/Geometry>
+
+namespace pel
+{
+  void
+  PoseCorrespondenceEstimation::determineReciprocalCorrespondences (pcl::Correspondences& correspondences, double max_distance)
+  {
+    //the shared tree is used only if it is forced and it was built over a cloud that ICP just moved around
+    if (!force_no_recompute_reciprocal_ || !tree_reciprocal_ || !tree_reciprocal_->getInputCloud() ||
+        tree_reciprocal_->getInputCloud()->points.size() != input_->points.size() || !input_->is_dense)
+    {
+      if (force_no_recompute_reciprocal_)
+      {
+        //never rebuild a shared tree, search a private one instead
+        tree_reciprocal_.reset (new pcl::search::KdTree<Pt>);
+        force_no_recompute_reciprocal_ = false;
+      }
+      pcl::registration::CorrespondenceEstimation<Pt, Pt, float>::determineReciprocalCorrespondences (correspondences, max_distance);
+      return;
+    }
+    if (!initCompute())
+      return;
+    const PtC& original = *tree_reciprocal_->getInputCloud();
+    //source points are the original ones moved by a rigid transformation, recover it
+    Eigen::Matrix4f moved = Eigen::umeyama (original.getMatrixXfMap(3, 4, 0), input_->getMatrixXfMap(3, 4, 0), false);
+    const Eigen::Matrix3f R_back = moved.topLeftCorner<3,3>().transpose();
+    const Eigen::Vector3f t_back = -R_back * moved.topRightCorner<3,1>();
+    const double max_dist_sqr = max_distance * max_distance;
+    correspondences.resize (indices_->size());
+    std::vector<int> index (1), index_reciprocal (1);
+    std::vector<float> distance (1), distance_reciprocal (1);
+    size_t found (0);
+    for (const auto& idx: *indices_)
+    {
+      tree_->nearestKSearch (input_->points[idx], 1, index, distance);
+      if (distance[0] > max_dist_sqr)
+        continue;
+      //search the match back in source, expressed in the frame of the original cloud
+      Pt back;
+      back.getVector3fMap() = R_back * target_->points[index[0]].getVector3fMap() + t_back;
+      tree_reciprocal_->nearestKSearch (back, 1, index_reciprocal, distance_reciprocal);
+      if (distance_reciprocal[0] > max_dist_sqr || idx != index_reciprocal[0])
+        continue;
+      correspondences[found].index_query = idx;
+      correspondences[found].index_match = index[0];
+      correspondences[found].distance = distance[0];
+      ++found;
+    }
+    correspondences.resize (found);
+    deinitCompute ();
+  }
+}